@@ -23,6 +23,7 @@ OBJ_DIR := $(BUILD_ROOT)/tmp$(DEBUG_SUFFIX)$(NO_STRING_SUFFIX)$(UNICODE_SUFFIX)
 
 GLOBAL_DEP := $(SRC_ROOT)/include/dropt.h $(SRC_ROOT)/include/dropt_string.h
 GLOBALXX_DEP := $(GLOBAL_DEP) $(SRC_ROOT)/include/droptxx.hpp
+STATIC_DEP := $(GLOBALXX_DEP) $(SRC_ROOT)/include/dropt_static.hpp
 LIB_OBJ_FILES := $(OBJ_DIR)/dropt.o $(OBJ_DIR)/dropt_handlers.o $(OBJ_DIR)/dropt_string.o
 OBJ_FILES := $(LIB_OBJ_FILES) $(OBJ_DIR)/test_dropt.o
 OBJXX_FILES := $(OBJ_DIR)/droptxx.o
@@ -32,6 +33,7 @@ DROPTXX_LIB := $(OUT_DIR)/libdroptxx.a
 EXAMPLE_EXE := $(OBJ_DIR)/dropt_example
 EXAMPLEXX_EXE := $(OBJ_DIR)/droptxx_example
 TEST_EXE := $(OBJ_DIR)/test_dropt
+TEST_STATIC_EXE := $(OBJ_DIR)/test_dropt_static
 
 
 # Targets --------------------------------------------------------------
@@ -64,12 +66,17 @@ ifdef _UNICODE
 test:
 	@echo "(Skipping tests because _UNICODE was specified for gcc.)"
 else
-test: $(TEST_EXE)
+test: $(TEST_EXE) $(TEST_STATIC_EXE)
 	@echo "Running tests..."
 	$(TEST_EXE) $(TEST_DROPT_ARGS)
+	$(TEST_STATIC_EXE)
 	@echo "Tests passed."
 endif
 
+.PHONY: benchmark
+benchmark: $(TEST_STATIC_EXE)
+	$(TEST_STATIC_EXE) --benchmark
+
 
 $(DROPT_LIB) $(DROPTXX_LIB): $(LIB_OBJ_FILES)
 	-mkdir -p $(@D)
@@ -80,6 +87,9 @@ $(DROPTXX_LIB): $(OBJ_DIR)/droptxx.o
 $(EXAMPLEXX_EXE): $(OBJ_DIR)/%: $(OBJ_DIR)/%.o $(DROPTXX_LIB)
 	$(CXX) $(CFLAGS) $(CXXFLAGS) $< -L$(OUT_DIR) -ldroptxx -o $@
 
+$(TEST_STATIC_EXE): $(OBJ_DIR)/%: $(OBJ_DIR)/%.o $(DROPT_LIB)
+	$(CXX) $(CFLAGS) $(CXXFLAGS) $< -L$(OUT_DIR) -ldropt -o $@
+
 $(OBJ_DIR)/%: $(OBJ_DIR)/%.o $(DROPT_LIB)
 	$(CC) $(CFLAGS) $< -L$(OUT_DIR) -ldropt -o $@
 
@@ -99,6 +109,11 @@ $(OBJXX_FILES) $(OBJ_DIR)/droptxx_example.o:
 	$(CXX) -c -o $@ $(CFLAGS) $(CXXFLAGS) $<
 	@echo "$(<F)"
 
+$(OBJ_DIR)/test_dropt_static.o: $(SRC_ROOT)/src/test_dropt_static.cpp $(STATIC_DEP)
+	-mkdir -p $(@D)
+	$(CXX) -c -o $@ $(CFLAGS) $(CXXFLAGS) -std=c++14 $<
+	@echo "$(<F)"
+
 
 # Directories ----------------------------------------------------------
 
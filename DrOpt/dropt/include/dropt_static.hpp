@@ -0,0 +1,567 @@
+/** dropt_static.hpp
+  *
+  * Compile-time option tables for dropt.
+  *
+  * dropt_new_context allocates a context and dropt_parse sorts the options
+  * into heap-allocated lookup tables with qsort.  dropt::static_option_table
+  * sorts the options when it is constructed, which happens at compile time
+  * if the table is declared constexpr, and dropt::static_context parses
+  * with it without allocating any memory.
+  *
+  * The options must be constant expressions, so their handler data must
+  * have static storage duration.  Option handlers are called with a NULL
+  * context, which the stock dropt handlers don't use.
+  *
+  * This software is provided 'as-is', without any express or implied
+  * warranty.  In no event will the authors be held liable for any damages
+  * arising from the use of this software.
+  *
+  * Permission is granted to anyone to use this software for any purpose,
+  * including commercial applications, and to alter it and redistribute it
+  * freely, subject to the following restrictions:
+  *
+  * 1. The origin of this software must not be misrepresented; you must not
+  *    claim that you wrote the original software. If you use this software
+  *    in a product, an acknowledgment in the product documentation would be
+  *    appreciated but is not required.
+  *
+  * 2. Altered source versions must be plainly marked as such, and must not be
+  *    misrepresented as being the original software.
+  *
+  * 3. This notice may not be removed or altered from any source distribution.
+  */
+
+#ifndef DROPT_STATIC_HPP
+#define DROPT_STATIC_HPP
+
+#include <stddef.h>
+#include <stdlib.h>
+#include "droptxx.hpp"
+
+
+namespace dropt
+{
+
+
+namespace detail
+{
+
+
+/** Reports an invalid option table.  Not being constexpr, calling it
+  * while constructing a constexpr table fails the compilation.
+  */
+inline void invalid_option_table(const char* message)
+{
+    DROPT_MISUSE(message);
+}
+
+
+inline constexpr bool contains_equals_sign(const dropt_char* s)
+{
+    for (; s != nullptr && *s != DROPT_TEXT_LITERAL('\0'); s++)
+    {
+        if (*s == DROPT_TEXT_LITERAL('='))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/** Compares the long name s, which has the length len and might not be
+  * NUL-terminated, against the NUL-terminated long name t.
+  */
+inline constexpr int compare_long_names(const dropt_char* s, size_t len, const dropt_char* t)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (t[i] == DROPT_TEXT_LITERAL('\0'))
+        {
+            return +1;
+        }
+        if (s[i] != t[i])
+        {
+            return (s[i] < t[i]) ? -1 : +1;
+        }
+    }
+    return (t[len] == DROPT_TEXT_LITERAL('\0')) ? 0 : -1;
+}
+
+
+inline constexpr size_t string_length(const dropt_char* s)
+{
+    size_t len = 0;
+    while (s[len] != DROPT_TEXT_LITERAL('\0'))
+    {
+        len++;
+    }
+    return len;
+}
+
+
+} // namespace detail
+
+
+/** dropt::static_option_table holds a copy of N options followed by the
+  * terminating sentinel, and indices of the options with long and short
+  * names sorted by these names.
+  */
+template<size_t N>
+class static_option_table
+{
+public:
+    constexpr explicit static_option_table(const dropt_option (&options)[N])
+    : mOptions()
+    , mSortedByLong()
+    , mNumLong(0)
+    , mSortedByShort()
+    , mNumShort(0)
+    {
+        // assigned explicitly, GCC doesn't treat the value-initialized element as a constant
+        mOptions[N] = dropt_option();
+
+        for (size_t i = 0; i < N; i++)
+        {
+            const dropt_option& option = options[i];
+            if (   option.short_name == DROPT_TEXT_LITERAL('=')
+                || detail::contains_equals_sign(option.long_name))
+            {
+                detail::invalid_option_table("Invalid option list. '=' may not be used in an option name.");
+            }
+            mOptions[i] = option;
+
+            // insertion sort, the tables are small
+            if (option.long_name != nullptr)
+            {
+                size_t len = detail::string_length(option.long_name);
+                size_t j = mNumLong++;
+                for (; j > 0; j--)
+                {
+                    int cmp = detail::compare_long_names(option.long_name, len, options[mSortedByLong[j - 1]].long_name);
+                    if (cmp == 0)
+                    {
+                        detail::invalid_option_table("Invalid option list. Duplicate long option name.");
+                    }
+                    if (cmp > 0)
+                    {
+                        break;
+                    }
+                    mSortedByLong[j] = mSortedByLong[j - 1];
+                }
+                mSortedByLong[j] = i;
+            }
+
+            if (option.short_name != DROPT_TEXT_LITERAL('\0'))
+            {
+                size_t j = mNumShort++;
+                for (; j > 0; j--)
+                {
+                    dropt_char other = options[mSortedByShort[j - 1]].short_name;
+                    if (option.short_name == other)
+                    {
+                        detail::invalid_option_table("Invalid option list. Duplicate short option name.");
+                    }
+                    if (option.short_name > other)
+                    {
+                        break;
+                    }
+                    mSortedByShort[j] = mSortedByShort[j - 1];
+                }
+                mSortedByShort[j] = i;
+            }
+        }
+    }
+
+    /** The options followed by the sentinel, e.g. for dropt_new_context. */
+    constexpr const dropt_option* get_options() const
+    {
+        return mOptions;
+    }
+
+    constexpr size_t size() const
+    {
+        return N;
+    }
+
+    /** Finds an option by its long name, which might not be NUL-terminated.
+      * Returns NULL if not found.
+      */
+    const dropt_option* find_long(const dropt_char* longName, size_t len) const
+    {
+        size_t low = 0;
+        size_t high = mNumLong;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            const dropt_option* option = &mOptions[mSortedByLong[middle]];
+            int cmp = detail::compare_long_names(longName, len, option->long_name);
+            if (cmp == 0)
+            {
+                return option;
+            }
+            else if (cmp < 0)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+        return nullptr;
+    }
+
+    /** Finds an option by its short name.  Returns NULL if not found. */
+    const dropt_option* find_short(dropt_char shortName) const
+    {
+        size_t low = 0;
+        size_t high = mNumShort;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            const dropt_option* option = &mOptions[mSortedByShort[middle]];
+            if (shortName == option->short_name)
+            {
+                return option;
+            }
+            else if (shortName < option->short_name)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    dropt_option mOptions[N + 1];
+    size_t mSortedByLong[N];
+    size_t mNumLong;
+    size_t mSortedByShort[N];
+    size_t mNumShort;
+};
+
+
+/** Builds a table from options without the terminating sentinel. */
+template<size_t N>
+constexpr static_option_table<N> make_option_table(const dropt_option (&options)[N])
+{
+    return static_option_table<N>(options);
+}
+
+
+/** dropt::static_context parses the command line like dropt_parse, but
+  * looks up the options in a dropt::static_option_table and keeps its
+  * state on the stack.  Only generating an error message allocates.
+  */
+template<size_t N>
+class static_context
+{
+public:
+    explicit static_context(const static_option_table<N>& table)
+    : mTable(table)
+    , mAllowConcatenatedArgs(false)
+    , mError(dropt_error_none)
+    , mErrorOptionName(nullptr)
+    , mErrorOptionNameLength(0)
+    , mErrorOptionArgument(nullptr)
+    , mShortName()
+    {
+    }
+
+    // Use this only for backward compatibility purposes.
+    void allow_concatenated_arguments(bool allow = true)
+    {
+        mAllowConcatenatedArgs = allow;
+    }
+
+    /** Parses up to argc arguments, or up to the NULL sentinel if argc is
+      * -1.  Returns a pointer to the first unprocessed element in argv.
+      */
+    dropt_char** parse(int argc, dropt_char** argv)
+    {
+        dropt_char** argNext = argv;
+
+        if (argv == nullptr)
+        {
+            return argNext;
+        }
+
+        if (argc == -1)
+        {
+            argc = 0;
+            while (argv[argc] != nullptr) { argc++; }
+        }
+
+        int argsLeft = argc;
+        dropt_char* arg;
+        while (   argsLeft-- > 0
+               && (arg = *argNext) != nullptr
+               && arg[0] == DROPT_TEXT_LITERAL('-'))
+        {
+            if (arg[1] == DROPT_TEXT_LITERAL('\0'))
+            {
+                /* "-" is left for the caller, e.g. to mean stdin. */
+                break;
+            }
+
+            argNext++;
+
+            if (arg[1] == DROPT_TEXT_LITERAL('-'))
+            {
+                const dropt_char* longName = arg + 2;
+                if (longName[0] == DROPT_TEXT_LITERAL('\0'))
+                {
+                    /* "--" ends the option processing. */
+                    break;
+                }
+                else if (longName[0] == DROPT_TEXT_LITERAL('='))
+                {
+                    set_error(dropt_error_invalid_option, arg, detail::string_length(arg), nullptr);
+                    break;
+                }
+
+                const dropt_char* longNameEnd = longName;
+                while (*longNameEnd != DROPT_TEXT_LITERAL('\0') && *longNameEnd != DROPT_TEXT_LITERAL('='))
+                {
+                    longNameEnd++;
+                }
+                const dropt_char* optionArgument = (*longNameEnd == DROPT_TEXT_LITERAL('=')) ? longNameEnd + 1 : nullptr;
+
+                const dropt_option* option = mTable.find_long(longName, longNameEnd - longName);
+                if (option == nullptr)
+                {
+                    set_error(dropt_error_invalid_option, arg, longNameEnd - arg, nullptr);
+                    break;
+                }
+
+                dropt_error err = parse_option_arg(option, optionArgument, argNext, argsLeft);
+                if (err != dropt_error_none)
+                {
+                    set_error(err, arg, longNameEnd - arg, optionArgument);
+                    break;
+                }
+                if (option->attr & dropt_attr_halt)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                if (arg[1] == DROPT_TEXT_LITERAL('='))
+                {
+                    set_error(dropt_error_invalid_option, arg, detail::string_length(arg), nullptr);
+                    break;
+                }
+
+                size_t len = 0;
+                while (arg[len] != DROPT_TEXT_LITERAL('\0') && arg[len] != DROPT_TEXT_LITERAL('='))
+                {
+                    len++;
+                }
+                const dropt_char* optionArgument = (arg[len] == DROPT_TEXT_LITERAL('=')) ? &arg[len + 1] : nullptr;
+
+                if (!parse_short_options(arg, len, optionArgument, argNext, argsLeft))
+                {
+                    break;
+                }
+            }
+        }
+
+        return argNext;
+    }
+
+    dropt_error get_error() const
+    {
+        return mError;
+    }
+
+#ifndef DROPT_NO_STRING_BUFFERS
+    /** Formats the message with dropt_default_error_handler. */
+    const dropt_char* get_error_message()
+    {
+        if (mError == dropt_error_none)
+        {
+            return DROPT_TEXT_LITERAL("");
+        }
+        string optionName((mErrorOptionName == nullptr) ? mShortName : mErrorOptionName, mErrorOptionNameLength);
+        dropt_char* message = dropt_default_error_handler(mError, optionName.c_str(), mErrorOptionArgument);
+        mErrorMessage = (message == nullptr) ? string() : string(message);
+        free(message);
+        return mErrorMessage.c_str();
+    }
+#endif
+
+    void clear_error()
+    {
+        mError = dropt_error_none;
+        mErrorOptionName = nullptr;
+        mErrorOptionNameLength = 0;
+        mErrorOptionArgument = nullptr;
+    }
+
+private:
+    static dropt_error set_option_value(const dropt_option* option, const dropt_char* optionArgument)
+    {
+        if (option->handler == nullptr)
+        {
+            DROPT_MISUSE("No option handler specified.");
+            return dropt_error_bad_configuration;
+        }
+        return option->handler(nullptr, optionArgument, option->handler_data);
+    }
+
+    /** Calls the handler, consuming the next argument if the option takes
+      * one and none was given with '='.  Same as dropt's parse_option_arg.
+      */
+    static dropt_error parse_option_arg(const dropt_option* option, const dropt_char*& optionArgument,
+                                        dropt_char**& argNext, int& argsLeft)
+    {
+        bool consumeNextArg = false;
+
+        if (option->arg_description != nullptr && optionArgument == nullptr)
+        {
+            if (argsLeft > 0 && *argNext != nullptr)
+            {
+                consumeNextArg = true;
+                optionArgument = *argNext;
+            }
+            else if (!(option->attr & dropt_attr_optional_val))
+            {
+                return dropt_error_insufficient_arguments;
+            }
+        }
+
+        dropt_error err = set_option_value(option, optionArgument);
+
+        if (   err != dropt_error_none
+            && (option->attr & dropt_attr_optional_val)
+            && consumeNextArg
+            && optionArgument != nullptr)
+        {
+            /* The handler rejected the optional argument, try without it. */
+            consumeNextArg = false;
+            optionArgument = nullptr;
+            err = set_option_value(option, nullptr);
+        }
+
+        if (err == dropt_error_none && consumeNextArg)
+        {
+            argNext++;
+            argsLeft--;
+        }
+        return err;
+    }
+
+    /** Parses the condensed short options arg[1, len).  Returns false if
+      * parsing has to stop.
+      */
+    bool parse_short_options(const dropt_char* arg, size_t len, const dropt_char* optionArgument,
+                             dropt_char**& argNext, int& argsLeft)
+    {
+        for (size_t j = 1; j < len; j++)
+        {
+            const dropt_option* option = mTable.find_short(arg[j]);
+            dropt_error err;
+            if (option == nullptr)
+            {
+                set_short_error(dropt_error_invalid_option, arg[j], nullptr);
+                return false;
+            }
+            else if (j + 1 == len)
+            {
+                /* The last short option in a condensed list gets to use an argument. */
+                err = parse_option_arg(option, optionArgument, argNext, argsLeft);
+                if (err != dropt_error_none)
+                {
+                    set_short_error(err, arg[j], optionArgument);
+                    return false;
+                }
+            }
+            else if (   mAllowConcatenatedArgs
+                     && option->arg_description != nullptr
+                     && j == 1)
+            {
+                err = set_option_value(option, &arg[j + 1]);
+                if (err != dropt_error_none && (option->attr & dropt_attr_optional_val))
+                {
+                    err = set_option_value(option, nullptr);
+                }
+                if (err != dropt_error_none)
+                {
+                    set_short_error(err, arg[j], &arg[j + 1]);
+                    return false;
+                }
+                return !(option->attr & dropt_attr_halt);
+            }
+            else if (   option->arg_description != nullptr
+                     && !(option->attr & dropt_attr_optional_val))
+            {
+                /* Short options with required arguments can only be last in a condensed list. */
+                set_short_error(dropt_error_insufficient_arguments, arg[j], nullptr);
+                return false;
+            }
+            else
+            {
+                err = set_option_value(option, nullptr);
+                if (err != dropt_error_none)
+                {
+                    set_short_error(err, arg[j], nullptr);
+                    return false;
+                }
+            }
+
+            if (option->attr & dropt_attr_halt)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void set_error(dropt_error err, const dropt_char* optionName, size_t len, const dropt_char* optionArgument)
+    {
+        mError = err;
+        mErrorOptionName = optionName;
+        mErrorOptionNameLength = len;
+        mErrorOptionArgument = optionArgument;
+    }
+
+    void set_short_error(dropt_error err, dropt_char shortName, const dropt_char* optionArgument)
+    {
+        mShortName[0] = DROPT_TEXT_LITERAL('-');
+        mShortName[1] = shortName;
+        mShortName[2] = DROPT_TEXT_LITERAL('\0');
+        // NULL refers to mShortName, which moves along if the context is copied
+        set_error(err, nullptr, 2, optionArgument);
+    }
+
+    const static_option_table<N>& mTable;
+    bool mAllowConcatenatedArgs;
+
+    dropt_error mError;
+    const dropt_char* mErrorOptionName;
+    size_t mErrorOptionNameLength;
+    const dropt_char* mErrorOptionArgument;
+    dropt_char mShortName[3];
+#ifndef DROPT_NO_STRING_BUFFERS
+    string mErrorMessage;
+#endif
+};
+
+
+template<size_t N>
+static_context<N> make_static_context(const static_option_table<N>& table)
+{
+    return static_context<N>(table);
+}
+
+
+} // namespace dropt
+
+
+#endif // DROPT_STATIC_HPP
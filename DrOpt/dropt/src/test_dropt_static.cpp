@@ -0,0 +1,268 @@
+/** test_dropt_static.cpp
+  *
+  * Unit tests for dropt_static.hpp, and a benchmark comparing it with
+  * dropt_new_context and dropt_parse.
+  *
+  * This software is provided 'as-is', without any express or implied
+  * warranty.  In no event will the authors be held liable for any damages
+  * arising from the use of this software.
+  *
+  * Permission is granted to anyone to use this software for any purpose,
+  * including commercial applications, and to alter it and redistribute it
+  * freely, subject to the following restrictions:
+  *
+  * 1. The origin of this software must not be misrepresented; you must not
+  *    claim that you wrote the original software. If you use this software
+  *    in a product, an acknowledgment in the product documentation would be
+  *    appreciated but is not required.
+  * 2. Altered source versions must be plainly marked as such, and must not be
+  *    misrepresented as being the original software.
+  * 3. This notice may not be removed or altered from any source distribution.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "dropt_static.hpp"
+#include "dropt_string.h"
+
+/* For convenience. */
+#define T(s) DROPT_TEXT_LITERAL(s)
+
+#ifndef ARRAY_LENGTH
+#define ARRAY_LENGTH(array) (sizeof (array) / sizeof (array)[0])
+#endif
+
+
+static dropt_bool showHelp;
+static dropt_bool quiet;
+static dropt_bool normalFlag;
+static dropt_bool requiredArgFlag;
+static dropt_bool optionalFlag;
+static dropt_char* stringVal;
+static dropt_char* optionalString;
+static int intVal;
+
+
+static void
+init_option_defaults()
+{
+    showHelp = false;
+    quiet = false;
+    normalFlag = false;
+    requiredArgFlag = false;
+    optionalFlag = false;
+    stringVal = nullptr;
+    optionalString = nullptr;
+    intVal = 0;
+}
+
+
+/* Deliberately not in sorted order. */
+static constexpr dropt_option options[] = {
+    { T('h'),  T("help"), T("Shows help."), nullptr, dropt_handle_bool, &showHelp, dropt_attr_halt },
+    { T('?'),  nullptr, nullptr, nullptr, dropt_handle_bool, &showHelp, dropt_attr_halt | dropt_attr_hidden },
+    { T('q'),  T("quiet"), T("Quiet mode."), nullptr, dropt_handle_bool, &quiet, 0 },
+    { T('n'),  T("normalFlag"), T("A normal flag."), nullptr, dropt_handle_bool, &normalFlag, 0 },
+    { T('r'),  T("requiredArgFlag"), T("A flag with a required argument."), T("bool"), dropt_handle_verbose_bool, &requiredArgFlag, 0 },
+    { T('\0'), T("optional"), T("A flag with an optional argument."), nullptr, dropt_handle_bool, &optionalFlag, dropt_attr_optional_val },
+    { T('s'),  T("string"), T("Test string value."), T("value"), dropt_handle_string, &stringVal, 0 },
+    { T('\0'), T("optionalString"), T("Test optional string value."), T("value"), dropt_handle_string, &optionalString, dropt_attr_optional_val },
+    { T('i'),  T("int"), T("Test integer value."), T("value"), dropt_handle_int, &intVal, 0 },
+    { T('\0'), T("n"), T("A long option named like a short one."), nullptr, dropt_handle_bool, &quiet, 0 },
+};
+
+static constexpr dropt::static_option_table<ARRAY_LENGTH(options)> optionTable = dropt::make_option_table(options);
+
+static_assert(optionTable.get_options()[ARRAY_LENGTH(options)].long_name == nullptr, "The table is terminated by a sentinel.");
+
+
+#define VERIFY(expr) verify(expr, #expr, __LINE__)
+static bool
+verify(bool b, const char* s, unsigned int line)
+{
+    if (!b) { fprintf(stderr, "FAILED: %s (line: %u)\n", s, line); }
+    return b;
+}
+
+
+/** State after parsing, to compare dropt_parse with dropt::static_context. */
+struct parse_outcome
+{
+    dropt_error error;
+    ptrdiff_t rest;
+    dropt_bool showHelp;
+    dropt_bool quiet;
+    dropt_bool normalFlag;
+    dropt_bool requiredArgFlag;
+    dropt_bool optionalFlag;
+    dropt_char* stringVal;
+    dropt_char* optionalString;
+    int intVal;
+
+    bool operator==(const parse_outcome& other) const
+    {
+        return    error == other.error
+               && rest == other.rest
+               && showHelp == other.showHelp
+               && quiet == other.quiet
+               && normalFlag == other.normalFlag
+               && requiredArgFlag == other.requiredArgFlag
+               && optionalFlag == other.optionalFlag
+               && stringVal == other.stringVal
+               && optionalString == other.optionalString
+               && intVal == other.intVal;
+    }
+};
+
+
+static parse_outcome
+get_outcome(dropt_error error, dropt_char** args, dropt_char** rest)
+{
+    parse_outcome outcome = { error, rest - args, showHelp, quiet, normalFlag, requiredArgFlag,
+                              optionalFlag, stringVal, optionalString, intVal };
+    return outcome;
+}
+
+
+static bool
+test_matches_dropt_parse()
+{
+    bool success = true;
+
+    /* dropt doesn't modify the arguments. */
+    const dropt_char* argumentLists[][6] = {
+        { T("-n"), T("--quiet"), nullptr },
+        { T("-qn"), T("rest"), T("-r"), nullptr },
+        { T("-n=0"), T("--quiet=1"), nullptr },
+        { T("--n"), T("-n"), nullptr },
+        { T("-r"), T("yes"), T("-s"), T("value"), T("rest"), nullptr },
+        { T("-r"), nullptr },
+        { T("-rn"), T("true"), nullptr },
+        { T("-nr"), T("true"), nullptr },
+        { T("--requiredArgFlag=maybe"), nullptr },
+        { T("--string"), T("--"), T("rest"), nullptr },
+        { T("--string="), T("rest"), nullptr },
+        { T("--optional"), T("1"), nullptr },
+        { T("--optional=1"), T("rest"), nullptr },
+        { T("--optionalString"), nullptr },
+        { T("--optionalString"), T("value"), nullptr },
+        { T("--int"), T("-12"), T("-i=34"), nullptr },
+        { T("--int"), T("twelve"), nullptr },
+        { T("-i"), T("99999999999999999999"), nullptr },
+        { T("--unknown"), T("-n"), nullptr },
+        { T("--unknown=value"), nullptr },
+        { T("-x"), nullptr },
+        { T("--="), nullptr },
+        { T("-="), nullptr },
+        { T("--"), T("-n"), nullptr },
+        { T("-"), T("-n"), nullptr },
+        { T("-h"), T("-n"), nullptr },
+        { T("-n?"), T("-q"), nullptr },
+        { T("rest"), T("-n"), nullptr },
+        { nullptr },
+    };
+
+    dropt_context* context = dropt_new_context(optionTable.get_options());
+    if (context == nullptr)
+    {
+        fputs("Insufficient memory.\n", stderr);
+        return false;
+    }
+
+    for (size_t i = 0; i < ARRAY_LENGTH(argumentLists); i++)
+    {
+        dropt_char** args = const_cast<dropt_char**>(argumentLists[i]);
+
+        init_option_defaults();
+        dropt_char** rest = dropt_parse(context, -1, args);
+        parse_outcome expected = get_outcome(dropt_get_error(context), args, rest);
+        dropt::string expectedMessage = (expected.error == dropt_error_none) ? dropt::string() : dropt_get_error_message(context);
+        dropt_clear_error(context);
+
+        init_option_defaults();
+        dropt::static_context<ARRAY_LENGTH(options)> staticContext(optionTable);
+        rest = staticContext.parse(-1, args);
+        parse_outcome actual = get_outcome(staticContext.get_error(), args, rest);
+        dropt::string actualMessage = (actual.error == dropt_error_none) ? dropt::string() : staticContext.get_error_message();
+
+        if (!VERIFY(expected == actual) || !VERIFY(expectedMessage == actualMessage))
+        {
+            fprintf(stderr, "    argument list %u: %s\n", static_cast<unsigned int>(i), expectedMessage.c_str());
+            success = false;
+        }
+    }
+
+    dropt_free_context(context);
+    return success;
+}
+
+
+static bool
+test_lookup()
+{
+    bool success = true;
+
+    success &= VERIFY(optionTable.find_long(T("help"), 4) == &optionTable.get_options()[0]);
+    success &= VERIFY(optionTable.find_long(T("n"), 1) == &optionTable.get_options()[9]);
+    success &= VERIFY(optionTable.find_long(T("normalFlag=1"), 10) == &optionTable.get_options()[3]);
+    success &= VERIFY(optionTable.find_long(T("normal"), 6) == nullptr);
+    success &= VERIFY(optionTable.find_long(T("normalFlags"), 11) == nullptr);
+    success &= VERIFY(optionTable.find_long(T(""), 0) == nullptr);
+    success &= VERIFY(optionTable.find_short(T('?')) == &optionTable.get_options()[1]);
+    success &= VERIFY(optionTable.find_short(T('i')) == &optionTable.get_options()[8]);
+    success &= VERIFY(optionTable.find_short(T('x')) == nullptr);
+
+    return success;
+}
+
+
+/** Times setting up and parsing a typical command line, with a new
+  * dropt context per parse like a launcher does once per process.
+  */
+static void
+benchmark(unsigned int iterations)
+{
+    const dropt_char* constArgs[] = { T("-q"), T("--string"), T("value"), T("--int=12"), T("-r"), T("yes"), T("--"), T("rest"), nullptr };
+    dropt_char** args = const_cast<dropt_char**>(constArgs);
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        dropt_context* context = dropt_new_context(optionTable.get_options());
+        dropt_parse(context, -1, args);
+        dropt_free_context(context);
+    }
+    auto droptDuration = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        dropt::static_context<ARRAY_LENGTH(options)> context(optionTable);
+        context.parse(-1, args);
+    }
+    auto staticDuration = std::chrono::steady_clock::now() - start;
+
+    printf("dropt_new_context + dropt_parse: %.1f ns per parse\n",
+           std::chrono::duration<double, std::nano>(droptDuration).count() / iterations);
+    printf("dropt::static_context::parse:   %.1f ns per parse\n",
+           std::chrono::duration<double, std::nano>(staticDuration).count() / iterations);
+}
+
+
+int
+main(int argc, char** argv)
+{
+    bool success = test_lookup();
+    success &= test_matches_dropt_parse();
+
+    if (success && argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+    {
+        benchmark((argc > 2) ? static_cast<unsigned int>(atoi(argv[2])) : 1000000);
+    }
+
+    if (!success) { fputs("One or more tests failed.\n", stderr); }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -233,6 +233,17 @@ tasks.withType(Test::class).configureEach {
    useJUnitPlatform()
 }
 
+/**
+ * Compares decompressing a gzip file with commons-compress against ParallelGzipInputStream, building its index and using the cached index. Pass
+ * `-Pbenchmark.archive=<path>` to benchmark a .tar.gz JDK instead of generated data, and `-Pbenchmark.iterations=<count>` to change the number of runs.
+ */
+val benchmarkGzip: TaskProvider<JavaExec> = tasks.register<JavaExec>("benchmarkGzip") {
+   classpath = sourceSets["test"].runtimeClasspath
+   main = "com.badlogicgames.packr.GzipBenchmark"
+   maxHeapSize = "2g"
+   args((findProperty("benchmark.archive") as String?) ?: "", (findProperty("benchmark.iterations") as String?) ?: "5")
+}
+
 tasks.withType(ShadowJar::class).configureEach {
    dependsOn(createPackrLauncherConsolidatedDirectory)
 
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2020 See AUTHORS file
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.badlogicgames.packr;
+
+import org.apache.commons.compress.utils.IOUtils;
+
+import java.io.Closeable;
+import java.io.EOFException;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InterruptedIOException;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.Semaphore;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * Writes extracted archive entries on a pool of threads, while the thread reading the archive continues with the next entries.
+ * <p>
+ * Writes to the same path run in the order they were submitted, so the last of duplicate entries wins. Hard links and the modification times and permissions
+ * of directories are applied by {@link #flush()}, after all writes completed, because hard links need their targets, and writing into a directory changes its
+ * modification time.
+ */
+class ArchiveEntryWriter implements Closeable {
+	 /**
+	  * Entries up to this size are read into memory and written by the pool, larger entries are written by the reading thread.
+	  */
+	 static final int MAX_BUFFERED_ENTRY_SIZE = 4 * 1024 * 1024;
+
+	 /**
+	  * The most entry content held in memory while waiting to be written.
+	  */
+	 private static final int MAX_BUFFERED_SIZE = 64 * 1024 * 1024;
+
+	 private static final AtomicInteger THREAD_NUMBER = new AtomicInteger();
+
+	 private final ExecutorService executorService;
+	 private final Semaphore bufferedSize = new Semaphore(MAX_BUFFERED_SIZE);
+	 private final Map<Path, Future<?>> pendingWrites = new HashMap<>();
+	 private final List<EntryAction> deferredLinks = new ArrayList<>();
+	 private final List<EntryAction> deferredDirectoryAttributes = new ArrayList<>();
+
+	 /**
+	  * The first failure of a write on the pool, reported to the reading thread by the next call.
+	  */
+	 private volatile IOException writeFailure;
+
+	 /**
+	  * Creates a writer with a thread per available processor.
+	  */
+	 ArchiveEntryWriter () {
+		  this(Runtime.getRuntime().availableProcessors());
+	 }
+
+	 /**
+	  * @param threads the number of threads writing entries
+	  */
+	 ArchiveEntryWriter (int threads) {
+		  executorService = Executors.newFixedThreadPool(Math.max(1, threads), runnable -> {
+				Thread thread = new Thread(runnable, "packr-extract-" + THREAD_NUMBER.incrementAndGet());
+				thread.setDaemon(true);
+				return thread;
+		  });
+	 }
+
+	 /**
+	  * Writes an entry on the pool.
+	  *
+	  * @param path   the path the entry is extracted to
+	  * @param action writes the entry
+	  * @throws IOException if an earlier write failed
+	  */
+	 void write (Path path, EntryAction action) throws IOException {
+		  write(path, 0, action);
+	 }
+
+	 /**
+	  * Reads the content of an entry of at most {@link #MAX_BUFFERED_ENTRY_SIZE} bytes, and writes it on the pool.
+	  *
+	  * @param path        the path the entry is extracted to
+	  * @param inputStream the archive input stream positioned at the entry content
+	  * @param length      the length of the entry content
+	  * @param action      writes the entry content
+	  * @throws IOException if an IO error occurs, or an earlier write failed
+	  */
+	 void writeContent (Path path, InputStream inputStream, int length, ContentAction action) throws IOException {
+		  try {
+				bufferedSize.acquire(length);
+		  } catch (InterruptedException exception) {
+				Thread.currentThread().interrupt();
+				throw new InterruptedIOException("Interrupted while waiting for archive entries to be written");
+		  }
+		  final byte[] content = new byte[length];
+		  try {
+				if (IOUtils.readFully(inputStream, content) != length) {
+					 throw new EOFException("Archive ended within the entry for " + path);
+				}
+		  } catch (IOException exception) {
+				bufferedSize.release(length);
+				throw exception;
+		  }
+		  write(path, length, () -> action.write(content));
+	 }
+
+	 private void write (Path path, int bufferedLength, EntryAction action) throws IOException {
+		  checkWriteFailure();
+		  Future<?> previousWrite = pendingWrites.get(path);
+		  if (previousWrite != null) {
+				await(previousWrite);
+		  }
+		  pendingWrites.put(path, executorService.submit(() -> {
+				try {
+					 action.run();
+				} catch (IOException | RuntimeException exception) {
+					 synchronized (this) {
+						  if (writeFailure == null) {
+								writeFailure = exception instanceof IOException ? (IOException)exception : new IOException(exception);
+						  }
+					 }
+					 throw exception;
+				} finally {
+					 bufferedSize.release(bufferedLength);
+				}
+				return null;
+		  }));
+	 }
+
+	 /**
+	  * Writes an entry on the calling thread, after the writes of the same path that are still pending.
+	  *
+	  * @param path   the path the entry is extracted to
+	  * @param action writes the entry
+	  * @throws IOException if an IO error occurs, or an earlier write failed
+	  */
+	 void writeOnCallingThread (Path path, EntryAction action) throws IOException {
+		  checkWriteFailure();
+		  Future<?> previousWrite = pendingWrites.remove(path);
+		  if (previousWrite != null) {
+				await(previousWrite);
+		  }
+		  action.run();
+	 }
+
+	 /**
+	  * Creates a hard link once all writes completed.
+	  *
+	  * @param action creates the link
+	  */
+	 void deferLink (EntryAction action) {
+		  deferredLinks.add(action);
+	 }
+
+	 /**
+	  * Sets the modification time and permissions of a directory once all writes completed.
+	  *
+	  * @param action sets the attributes
+	  */
+	 void deferDirectoryAttributes (EntryAction action) {
+		  deferredDirectoryAttributes.add(action);
+	 }
+
+	 /**
+	  * Waits for all writes to complete, then creates the deferred hard links and sets the deferred directory attributes.
+	  *
+	  * @throws IOException if a write failed, or an IO error occurs
+	  */
+	 void flush () throws IOException {
+		  for (Future<?> pendingWrite : pendingWrites.values()) {
+				await(pendingWrite);
+		  }
+		  pendingWrites.clear();
+		  checkWriteFailure();
+
+		  for (EntryAction deferredLink : deferredLinks) {
+				deferredLink.run();
+		  }
+		  deferredLinks.clear();
+		  for (EntryAction deferredDirectoryAttribute : deferredDirectoryAttributes) {
+				deferredDirectoryAttribute.run();
+		  }
+		  deferredDirectoryAttributes.clear();
+	 }
+
+	 /**
+	  * Stops the threads, abandoning the writes that haven't started, and waits for the running writes.
+	  */
+	 @Override public void close () {
+		  executorService.shutdownNow();
+		  try {
+				executorService.awaitTermination(1, TimeUnit.MINUTES);
+		  } catch (InterruptedException exception) {
+				Thread.currentThread().interrupt();
+		  }
+	 }
+
+	 private void checkWriteFailure () throws IOException {
+		  if (writeFailure != null) {
+				throw writeFailure;
+		  }
+	 }
+
+	 private static void await (Future<?> write) throws IOException {
+		  try {
+				write.get();
+		  } catch (InterruptedException exception) {
+				Thread.currentThread().interrupt();
+				throw new InterruptedIOException("Interrupted while waiting for archive entries to be written");
+		  } catch (ExecutionException exception) {
+				if (exception.getCause() instanceof IOException) {
+					 throw (IOException)exception.getCause();
+				}
+				throw new IOException(exception.getCause());
+		  }
+	 }
+
+	 /**
+	  * Writes an entry, or applies its attributes.
+	  */
+	 interface EntryAction {
+		  void run () throws IOException;
+	 }
+
+	 /**
+	  * Writes an entry from its content read into memory.
+	  */
+	 interface ContentAction {
+		  void write (byte[] content) throws IOException;
+	 }
+}
@@ -40,8 +40,10 @@ import java.io.BufferedOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.io.OutputStream;
+import java.io.UncheckedIOException;
 import java.lang.invoke.MethodHandles;
 import java.nio.charset.StandardCharsets;
+import java.nio.file.DirectoryStream;
 import java.nio.file.FileVisitResult;
 import java.nio.file.Files;
 import java.nio.file.Path;
@@ -55,7 +57,10 @@ import java.nio.file.attribute.PosixFileAttributeView;
 import java.nio.file.attribute.PosixFilePermission;
 import java.util.Enumeration;
 import java.util.HashSet;
+import java.util.Queue;
 import java.util.Set;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.function.Predicate;
 
 import static java.nio.file.LinkOption.NOFOLLOW_LINKS;
 import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.LONGFILE_GNU;
@@ -98,6 +103,68 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 	  * @throws ArchiveException    if an archive exception occurs
 	  */
 	 public static void extractArchive (Path archivePath, Path extractToDirectory)
+		 throws IOException, CompressorException, ArchiveException {
+		  extractArchive(archivePath, entryName -> extractToDirectory.resolve(getEntryAsPath(entryName)), false);
+	 }
+
+	 /**
+	  * Extracts only the JRE contained in a JDK archive into {@code jreDirectory}, in a single pass over the archive.
+	  * <p>
+	  * The JRE root is the parent of the "lib" or "bin" directory holding the JVM shared library (jvm.dll, libjvm.so, or libjvm.dylib), found from the
+	  * archive entry names. Entries outside of the JRE root, and entries matching {@code isExcluded}, are never written. Zip archives are scanned for the JRE
+	  * root before extracting. Entries of streamed archives that precede the JVM shared library are extracted into a staging directory next to {@code
+	  * jreDirectory}, and moved into place once the JRE root is known.
+	  *
+	  * @param archivePath  the JDK archive to extract the JRE from
+	  * @param jreDirectory the directory to extract the contents of the JRE root into
+	  * @param isExcluded   tests paths relative to the JRE root, separated by forward slashes, that shouldn't be extracted
+	  * @return false if the archive doesn't contain a JVM shared library
+	  * @throws IOException         if an IO error occurs
+	  * @throws CompressorException if a compression exception occurs
+	  * @throws ArchiveException    if an archive exception occurs
+	  */
+	 public static boolean extractJre (Path archivePath, Path jreDirectory, Predicate<String> isExcluded)
+		 throws IOException, CompressorException, ArchiveException {
+		  return extractJre(archivePath, jreDirectory, isExcluded, false);
+	 }
+
+	 /**
+	  * Extracts only the JRE contained in a JDK archive into {@code jreDirectory}, like {@link #extractJre(Path, Path, Predicate)}.
+	  * <p>
+	  * Gzip compressed archives are decompressed on multiple threads if they have been indexed before. With {@code indexGzip}, an archive that isn't indexed
+	  * yet is indexed while extracting, and the index is cached next to it for the next time the same archive is extracted.
+	  *
+	  * @param archivePath  the JDK archive to extract the JRE from
+	  * @param jreDirectory the directory to extract the contents of the JRE root into
+	  * @param isExcluded   tests paths relative to the JRE root, separated by forward slashes, that shouldn't be extracted
+	  * @param indexGzip    whether to index a gzip compressed archive that isn't indexed yet
+	  * @return false if the archive doesn't contain a JVM shared library
+	  * @throws IOException         if an IO error occurs
+	  * @throws CompressorException if a compression exception occurs
+	  * @throws ArchiveException    if an archive exception occurs
+	  */
+	 public static boolean extractJre (Path archivePath, Path jreDirectory, Predicate<String> isExcluded, boolean indexGzip)
+		 throws IOException, CompressorException, ArchiveException {
+		  JreEntryPathMapper jreEntryPathMapper = new JreEntryPathMapper(jreDirectory, isExcluded);
+		  try {
+				extractArchive(archivePath, jreEntryPathMapper, indexGzip);
+		  } finally {
+				jreEntryPathMapper.deleteStagingDirectory();
+		  }
+		  return jreEntryPathMapper.jreRoot != null;
+	 }
+
+	 /**
+	  * Detects the compression and type of an archive and extracts it.
+	  *
+	  * @param archivePath     the archive to extract
+	  * @param entryPathMapper maps archive entry names to the paths they're extracted to
+	  * @param indexGzip       whether to index a gzip compressed archive that isn't indexed yet, see {@link ParallelGzipInputStream}
+	  * @throws IOException         if an IO error occurs
+	  * @throws CompressorException if a compression exception occurs
+	  * @throws ArchiveException    if an archive exception occurs
+	  */
+	 private static void extractArchive (Path archivePath, EntryPathMapper entryPathMapper, boolean indexGzip)
 		 throws IOException, CompressorException, ArchiveException {
 		  try (InputStream jdkInputStream = new BufferedInputStream(Files.newInputStream(archivePath))) {
 				String compressorType = null;
@@ -107,30 +174,40 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 					 LOG.debug("Didn't detect any compression for archive " + archivePath + ": " + exception.getMessage());
 				}
 				InputStream decompressedJdkInputStream = jdkInputStream;
-				if (compressorType != null) {
+				if (CompressorStreamFactory.GZIP.equals(compressorType)) {
+					 final InputStream gzipInputStream = ParallelGzipInputStream.open(archivePath, indexGzip);
+					 if (gzipInputStream != null) {
+						  decompressedJdkInputStream = new BufferedInputStream(gzipInputStream);
+					 }
+				}
+				if (compressorType != null && decompressedJdkInputStream == jdkInputStream) {
 					 decompressedJdkInputStream = new BufferedInputStream(
 						 CompressorStreamFactory.getSingleton().createCompressorInputStream(compressorType, jdkInputStream));
 				}
 
-				switch (ArchiveStreamFactory.detect(decompressedJdkInputStream)) {
-				case ArchiveStreamFactory.ZIP:
-					 if (compressorType != null) {
-						  LOG.error("Cannot extract Zip archives that are wrapped in additional compression");
-					 } else {
-						  extractZipArchive(archivePath, extractToDirectory);
+				try {
+					 switch (ArchiveStreamFactory.detect(decompressedJdkInputStream)) {
+					 case ArchiveStreamFactory.ZIP:
+						  if (compressorType != null) {
+								LOG.error("Cannot extract Zip archives that are wrapped in additional compression");
+						  } else {
+								extractZipArchive(archivePath, entryPathMapper);
+						  }
+						  break;
+					 case ArchiveStreamFactory.JAR:
+						  extractJarArchive(decompressedJdkInputStream, entryPathMapper);
+						  break;
+					 case ArchiveStreamFactory.TAR:
+						  extractTarArchive(decompressedJdkInputStream, entryPathMapper);
+						  break;
+					 default:
+						  LOG.error("No special handling for archive type " + archivePath
+							  + ". Permissions and links will not be properly handled.");
+						  extractGenericArchive(decompressedJdkInputStream, entryPathMapper);
+						  break;
 					 }
-					 break;
-				case ArchiveStreamFactory.JAR:
-					 extractJarArchive(decompressedJdkInputStream, extractToDirectory);
-					 break;
-				case ArchiveStreamFactory.TAR:
-					 extractTarArchive(decompressedJdkInputStream, extractToDirectory);
-					 break;
-				default:
-					 LOG.error("No special handling for archive type " + archivePath
-						 + ". Permissions and links will not be properly handled.");
-					 extractGenericArchive(decompressedJdkInputStream, extractToDirectory);
-					 break;
+				} finally {
+					 decompressedJdkInputStream.close();
 				}
 		  }
 	 }
@@ -139,12 +216,12 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 	  * Extracts an archive using {@link ArchiveStreamFactory#createArchiveInputStream(InputStream)} with no special handling of symbolic links or file
 	  * permissions.
 	  *
-	  * @param inputStream        the archive input stream
-	  * @param extractToDirectory the directory to extract the archive into
+	  * @param inputStream     the archive input stream
+	  * @param entryPathMapper maps archive entry names to the paths they're extracted to
 	  * @throws ArchiveException if an archive error occurs
 	  * @throws IOException      if an IO error occurs
 	  */
-	 private static void extractGenericArchive (InputStream inputStream, Path extractToDirectory)
+	 private static void extractGenericArchive (InputStream inputStream, EntryPathMapper entryPathMapper)
 		 throws ArchiveException, IOException {
 		  final ArchiveInputStream archiveInputStream = new ArchiveStreamFactory().createArchiveInputStream(inputStream);
 
@@ -155,7 +232,10 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 					 continue;
 				}
 
-				Path entryExtractPath = extractToDirectory.resolve(getEntryAsPath(entry));
+				Path entryExtractPath = entryPathMapper.map(entry.getName());
+				if (entryExtractPath == null) {
+					 continue;
+				}
 				if (entry.isDirectory()) {
 					 Files.createDirectories(entryExtractPath);
 				} else {
@@ -169,45 +249,97 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 	 /**
 	  * Extracts a TAR archive. If the current platform supports POSIX permissions, the archive entry permissions are applied to the create file or directory.
 	  * Symbolic and "hard" links are also support.
+	  * <p>
+	  * The calling thread decompresses and reads the archive, files are written by an {@link ArchiveEntryWriter}.
 	  *
-	  * @param inputStream        the archive input stream
-	  * @param extractToDirectory the directory to extract the archive into
+	  * @param inputStream     the archive input stream
+	  * @param entryPathMapper maps archive entry names to the paths they're extracted to
 	  * @throws IOException if an IO error occurs
 	  */
-	 private static void extractTarArchive (InputStream inputStream, Path extractToDirectory) throws IOException {
+	 private static void extractTarArchive (InputStream inputStream, EntryPathMapper entryPathMapper) throws IOException {
 		  final TarArchiveInputStream archiveInputStream = new TarArchiveInputStream(inputStream);
 
-		  TarArchiveEntry entry;
-		  while ((entry = archiveInputStream.getNextTarEntry()) != null) {
-				if (!archiveInputStream.canReadEntryData(entry)) {
-					 LOG.error("Failed to read archive entry " + entry);
-					 continue;
-				}
-
-				Path entryExtractPath = extractToDirectory.resolve(getEntryAsPath(entry));
+		  try (ArchiveEntryWriter entryWriter = new ArchiveEntryWriter()) {
+				TarArchiveEntry entry;
+				while ((entry = archiveInputStream.getNextTarEntry()) != null) {
+					 if (!archiveInputStream.canReadEntryData(entry)) {
+						  LOG.error("Failed to read archive entry " + entry);
+						  continue;
+					 }
 
-				if (entry.isLink()) {
-					 Path linkTarget = Paths.get(entry.getLinkName());
-					 Files.deleteIfExists(entryExtractPath);
-					 Files.createLink(entryExtractPath, linkTarget);
-				} else if (entry.isSymbolicLink()) {
-					 Path linkTarget = Paths.get(entry.getLinkName());
-					 Files.deleteIfExists(entryExtractPath);
-					 Files.createSymbolicLink(entryExtractPath, linkTarget);
-				} else {
-					 if (entry.isDirectory()) {
-						  Files.createDirectories(entryExtractPath);
+					 if (entryPathMapper.movesExtractedEntries(entry.getName())) {
+						  entryWriter.flush();
+					 }
+					 final Path entryExtractPath = entryPathMapper.map(entry.getName());
+					 if (entryExtractPath == null) {
+						  continue;
+					 }
+					 final String entryName = entry.getName();
+					 final FileTime lastModifiedTime = FileTime.fromMillis(entry.getLastModifiedDate().getTime());
+					 final Set<PosixFilePermission> permissions = getPosixFilePermissions(entry);
+
+					 if (entry.isLink()) {
+						  // hard links name another entry of the archive
+						  final String linkName = entry.getLinkName();
+						  final Path linkTarget = entryPathMapper.map(linkName);
+						  entryWriter.deferLink(() -> {
+								if (linkTarget == null || !Files.exists(linkTarget, NOFOLLOW_LINKS)) {
+									 LOG.error("Skipping archive entry " + entryName + ", its link target " + linkName + " wasn't extracted");
+									 return;
+								}
+								Files.createDirectories(entryExtractPath.getParent());
+								Files.deleteIfExists(entryExtractPath);
+								Files.createLink(entryExtractPath, linkTarget);
+								setLastModifiedTime(entryExtractPath, lastModifiedTime);
+								setPosixPermissions(entryExtractPath, permissions);
+						  });
+					 } else if (entry.isSymbolicLink()) {
+						  final Path linkTarget = Paths.get(entry.getLinkName());
+						  entryWriter.write(entryExtractPath, () -> {
+								Files.createDirectories(entryExtractPath.getParent());
+								Files.deleteIfExists(entryExtractPath);
+								Files.createSymbolicLink(entryExtractPath, linkTarget);
+						  });
+					 } else if (entry.isDirectory()) {
+						  extractDirectory(entryWriter, entryExtractPath, lastModifiedTime, permissions);
+					 } else if (entry.getSize() <= ArchiveEntryWriter.MAX_BUFFERED_ENTRY_SIZE) {
+						  entryWriter.writeContent(entryExtractPath, archiveInputStream, (int)entry.getSize(), content -> {
+								Files.createDirectories(entryExtractPath.getParent());
+								Files.write(entryExtractPath, content);
+								setLastModifiedTime(entryExtractPath, lastModifiedTime);
+								setPosixPermissions(entryExtractPath, permissions);
+						  });
 					 } else {
-						  Files.createDirectories(entryExtractPath.getParent());
-						  Files.copy(archiveInputStream, entryExtractPath, StandardCopyOption.REPLACE_EXISTING);
+						  entryWriter.writeOnCallingThread(entryExtractPath, () -> {
+								Files.createDirectories(entryExtractPath.getParent());
+								Files.copy(archiveInputStream, entryExtractPath, StandardCopyOption.REPLACE_EXISTING);
+								setLastModifiedTime(entryExtractPath, lastModifiedTime);
+								setPosixPermissions(entryExtractPath, permissions);
+						  });
 					 }
 				}
-				setLastModifiedTime(entryExtractPath, FileTime.fromMillis(entry.getLastModifiedDate().getTime()));
-				Set<PosixFilePermission> permissions = getPosixFilePermissions(entry);
-				setPosixPermissions(entryExtractPath, permissions);
+				entryWriter.flush();
 		  }
 	 }
 
+	 /**
+	  * Creates a directory for an archive entry. Its modification time and permissions are set once the files in it are written.
+	  *
+	  * @param entryWriter      the writer extracting the archive
+	  * @param entryExtractPath the directory to create
+	  * @param lastModifiedTime the modification time of the archive entry
+	  * @param permissions      the permissions of the archive entry
+	  * @throws IOException if an IO error occurs
+	  */
+	 private static void extractDirectory (ArchiveEntryWriter entryWriter, Path entryExtractPath, FileTime lastModifiedTime,
+		 Set<PosixFilePermission> permissions) throws IOException {
+		  Files.createDirectories(entryExtractPath);
+		  entryWriter.deferDirectoryAttributes(() -> {
+				setLastModifiedTime(entryExtractPath, lastModifiedTime);
+				setPosixPermissions(entryExtractPath, permissions);
+		  });
+	 }
+
 	 private static Set<PosixFilePermission> getPosixFilePermissions (final TarArchiveEntry entry) {
 		  int mode = entry.getMode();
 		  if (mode == 0) {
@@ -296,36 +428,46 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 	  * Extracts a JAR archive. If the current platform supports POSIX permissions, the archive entry permissions are applied to the created file or directory.
 	  * Symbolic links are also supported.
 	  *
-	  * @param inputStream        the archive input stream
-	  * @param extractToDirectory the directory to extract the archive into
+	  * @param inputStream     the archive input stream
+	  * @param entryPathMapper maps archive entry names to the paths they're extracted to
 	  * @throws IOException if an IO error occurs
 	  */
-	 private static void extractJarArchive (InputStream inputStream, Path extractToDirectory) throws IOException {
+	 private static void extractJarArchive (InputStream inputStream, EntryPathMapper entryPathMapper) throws IOException {
 		  final JarArchiveInputStream archiveInputStream = new JarArchiveInputStream(inputStream);
 
-		  JarArchiveEntry entry;
-		  while ((entry = archiveInputStream.getNextJarEntry()) != null) {
-				if (!archiveInputStream.canReadEntryData(entry)) {
-					 LOG.error("Failed to read archive entry " + entry);
-					 continue;
+		  try (ArchiveEntryWriter entryWriter = new ArchiveEntryWriter(1)) {
+				JarArchiveEntry entry;
+				while ((entry = archiveInputStream.getNextJarEntry()) != null) {
+					 if (!archiveInputStream.canReadEntryData(entry)) {
+						  LOG.error("Failed to read archive entry " + entry);
+						  continue;
+					 }
+					 final Path entryExtractPath = entryPathMapper.map(entry.getName());
+					 if (entryExtractPath == null) {
+						  continue;
+					 }
+					 if (entry.isDirectory()) {
+						  extractDirectory(entryWriter, entryExtractPath, entry.getLastModifiedTime(), getPosixFilePermissions(entry));
+					 } else {
+						  final JarArchiveEntry fileEntry = entry;
+						  entryWriter.writeOnCallingThread(entryExtractPath, () -> extractZipEntry(entryExtractPath, archiveInputStream, fileEntry));
+					 }
 				}
-				extractZipEntry(extractToDirectory, archiveInputStream, entry);
+				entryWriter.flush();
 		  }
 	 }
 
 	 /**
-	  * Extracts a {@link ZipArchiveEntry}, creating files and directories that match the date modified, POSIX permissions, and symbolic link properties of the
-	  * archive entry.
+	  * Extracts a file or symbolic link {@link ZipArchiveEntry}, creating files that match the date modified, POSIX permissions, and symbolic link properties
+	  * of the archive entry. Directories are extracted by {@link #extractDirectory(ArchiveEntryWriter, Path, FileTime, Set)}.
 	  *
-	  * @param extractToDirectory the directory to extract to
+	  * @param entryExtractPath   the path to extract to
 	  * @param archiveInputStream the archive input stream
 	  * @param entry              the entry to extract
 	  * @throws IOException if an IO error occurs
 	  */
-	 private static void extractZipEntry (Path extractToDirectory, InputStream archiveInputStream, ZipArchiveEntry entry)
-		 throws IOException {
-		  Path entryExtractPath = extractToDirectory.resolve(getEntryAsPath(entry));
-
+	 private static void extractZipEntry (Path entryExtractPath, InputStream archiveInputStream, ZipArchiveEntry entry) throws IOException {
+		  Files.createDirectories(entryExtractPath.getParent());
 		  if (entry.isUnixSymlink()) {
 				final byte[] contentBuffer = new byte[8192];
 				final int contentLength = IOUtils.readFully(archiveInputStream, contentBuffer);
@@ -333,12 +475,7 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 				Files.deleteIfExists(entryExtractPath);
 				Files.createSymbolicLink(entryExtractPath, linkTarget);
 		  } else {
-				if (entry.isDirectory()) {
-					 Files.createDirectories(entryExtractPath);
-				} else {
-					 Files.createDirectories(entryExtractPath.getParent());
-					 Files.copy(archiveInputStream, entryExtractPath, StandardCopyOption.REPLACE_EXISTING);
-				}
+				Files.copy(archiveInputStream, entryExtractPath, StandardCopyOption.REPLACE_EXISTING);
 		  }
 		  setLastModifiedTime(entryExtractPath, entry.getLastModifiedTime());
 		  Set<PosixFilePermission> permissions = getPosixFilePermissions(entry);
@@ -354,8 +491,8 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 		  pathAttributeView.setTimes(lastModifiedTime, fileAttributes.lastAccessTime(), fileAttributes.creationTime());
 	 }
 
-	 private static Path getEntryAsPath (ArchiveEntry entry) throws IOException {
-		  Path entryAsPath = Paths.get(entry.getName());
+	 private static Path getEntryAsPath (String entryName) throws IOException {
+		  Path entryAsPath = Paths.get(entryName);
 		  if (entryAsPath.isAbsolute()) {
 				throw new IOException("Archive contained an absolute path as an entry");
 		  }
@@ -365,19 +502,248 @@ import static org.apache.commons.compress.archivers.tar.TarArchiveOutputStream.L
 	 /**
 	  * Extracts a Zip archive. If the current platform supports POSIX permissions, the archive entry permissions are applied to the created file or directory.
 	  * Symbolic links are also supported.
+	  * <p>
+	  * Entries are decompressed and written by an {@link ArchiveEntryWriter}, each of its threads reading the archive through its own {@link ZipFile}.
 	  *
-	  * @param archivePath        the Zip archive path
-	  * @param extractToDirectory the directory to extract the archive into
+	  * @param archivePath     the Zip archive path
+	  * @param entryPathMapper maps archive entry names to the paths they're extracted to
 	  * @throws IOException if an IO error occurs
 	  */
-	 private static void extractZipArchive (Path archivePath, Path extractToDirectory) throws IOException {
-		  try (final ZipFile zipFile = new ZipFile(archivePath.toFile())) {
+	 private static void extractZipArchive (Path archivePath, EntryPathMapper entryPathMapper) throws IOException {
+		  final Queue<ZipFile> threadZipFiles = new ConcurrentLinkedQueue<>();
+		  final ThreadLocal<ZipFile> threadZipFile = ThreadLocal.withInitial(() -> {
+				try {
+					 ZipFile zipFile = new ZipFile(archivePath.toFile());
+					 threadZipFiles.add(zipFile);
+					 return zipFile;
+				} catch (IOException exception) {
+					 throw new UncheckedIOException(exception);
+				}
+		  });
+
+		  try (final ZipFile zipFile = new ZipFile(archivePath.toFile()); ArchiveEntryWriter entryWriter = new ArchiveEntryWriter()) {
+				// the central directory lists every entry name up front
 				Enumeration<ZipArchiveEntry> entries = zipFile.getEntries();
 				while (entries.hasMoreElements()) {
-					 ZipArchiveEntry entry = entries.nextElement();
-					 try (InputStream entryInputStream = zipFile.getInputStream(entry)) {
-						  extractZipEntry(extractToDirectory, entryInputStream, entry);
+					 entryPathMapper.scan(entries.nextElement().getName());
+				}
+
+				entries = zipFile.getEntries();
+				while (entries.hasMoreElements()) {
+					 final ZipArchiveEntry entry = entries.nextElement();
+					 final Path entryExtractPath = entryPathMapper.map(entry.getName());
+					 if (entryExtractPath == null) {
+						  continue;
+					 }
+					 if (entry.isDirectory()) {
+						  extractDirectory(entryWriter, entryExtractPath, entry.getLastModifiedTime(), getPosixFilePermissions(entry));
+						  continue;
+					 }
+					 // entries carry the offset of their data, so they can be read from any ZipFile of the archive
+					 entryWriter.write(entryExtractPath, () -> {
+						  try (InputStream entryInputStream = threadZipFile.get().getInputStream(entry)) {
+								extractZipEntry(entryExtractPath, entryInputStream, entry);
+						  } catch (UncheckedIOException exception) {
+								throw exception.getCause();
+						  }
+					 });
+				}
+				entryWriter.flush();
+		  } finally {
+				for (ZipFile zipFile : threadZipFiles) {
+					 ZipFile.closeQuietly(zipFile);
+				}
+		  }
+	 }
+
+	 /**
+	  * Maps archive entry names to the paths they're extracted to.
+	  */
+	 private interface EntryPathMapper {
+		  /**
+			* Offers an entry name before any entry is extracted, for archives that list all entries up front.
+			*
+			* @param entryName the name of an archive entry
+			* @throws IOException if an IO error occurs
+			*/
+		  default void scan (String entryName) throws IOException {
+		  }
+
+		  /**
+			* Checks whether mapping an entry name moves entries that were already extracted, which requires their writes to have completed.
+			*
+			* @param entryName the name of an archive entry
+			* @return true if {@link #map(String)} moves extracted entries for {@code entryName}
+			* @throws IOException if an IO error occurs
+			*/
+		  default boolean movesExtractedEntries (String entryName) throws IOException {
+				return false;
+		  }
+
+		  /**
+			* Maps an entry name to the path to extract it to.
+			*
+			* @param entryName the name of an archive entry, or the target of a hard link
+			* @return the path to extract the entry to, or null if the entry shouldn't be extracted
+			* @throws IOException if an IO error occurs
+			*/
+		  Path map (String entryName) throws IOException;
+	 }
+
+	 /**
+	  * Maps the entries of a JDK archive below the JRE root into a JRE directory.
+	  */
+	 private static class JreEntryPathMapper implements EntryPathMapper {
+		  private final Path jreDirectory;
+		  private final Path stagingDirectory;
+		  private final Predicate<String> isExcluded;
+
+		  /**
+			* The entry name prefix of the JRE root, empty if the archive root is the JRE root, or null until the JVM shared library is found.
+			*/
+		  private String jreRoot;
+
+		  /**
+			* Whether all entry names were scanned up front, so nothing needs staging while the JRE root is unknown.
+			*/
+		  private boolean scanned;
+
+		  JreEntryPathMapper (Path jreDirectory, Predicate<String> isExcluded) throws IOException {
+				this.jreDirectory = jreDirectory;
+				this.stagingDirectory = jreDirectory.resolveSibling(jreDirectory.getFileName() + ".tmp");
+				this.isExcluded = isExcluded;
+				deleteStagingDirectory();
+		  }
+
+		  @Override public void scan (String entryName) throws IOException {
+				scanned = true;
+				if (jreRoot == null) {
+					 jreRoot = findJreRoot(getEntryAsPath(entryName), entryName);
+				}
+		  }
+
+		  @Override public boolean movesExtractedEntries (String entryName) throws IOException {
+				return jreRoot == null && !scanned && findJreRoot(getEntryAsPath(entryName), entryName) != null;
+		  }
+
+		  @Override public Path map (String entryName) throws IOException {
+				Path entryAsPath = getEntryAsPath(entryName);
+				String name = entryName.startsWith("./") ? entryName.substring(2) : entryName;
+
+				if (jreRoot == null) {
+					 if (scanned) {
+						  return null;
+					 }
+					 jreRoot = findJreRoot(entryAsPath, name);
+					 if (jreRoot == null) {
+						  return stagingDirectory.resolve(entryAsPath);
 					 }
+					 moveStagedJreRoot();
+				}
+
+				if (!name.startsWith(jreRoot)) {
+					 return null;
+				}
+				String relativeName = name.substring(jreRoot.length());
+				if (relativeName.endsWith("/")) {
+					 relativeName = relativeName.substring(0, relativeName.length() - 1);
+				}
+				if (relativeName.isEmpty()) {
+					 return jreDirectory;
+				}
+				if (isExcluded.test(relativeName)) {
+					 return null;
+				}
+				return jreDirectory.resolve(relativeName);
+		  }
+
+		  /**
+			* Walks backwards from the JVM shared library searching for a "lib" or "bin" directory, the JRE root is its parent.
+			*
+			* @param entryAsPath the archive entry to check for the JVM shared library
+			* @param entryName   the name of the archive entry
+			* @return the entry name prefix of the JRE root, or null if {@code entryName} isn't the JVM shared library
+			*/
+		  private static String findJreRoot (Path entryAsPath, String entryName) {
+				final Path fileName = entryAsPath.getFileName();
+				if (fileName == null || entryName.endsWith("/")) {
+					 return null;
+				}
+				final String filename = fileName.toString();
+				if (!filename.equalsIgnoreCase("jvm.dll") && !filename.startsWith("libjvm")) {
+					 return null;
+				}
+				for (int index = entryAsPath.getNameCount() - 2; index >= 0; index--) {
+					 final String parentDirectoryName = entryAsPath.getName(index).toString();
+					 if (parentDirectoryName.equalsIgnoreCase("lib") || parentDirectoryName.equalsIgnoreCase("bin")) {
+						  StringBuilder jreRoot = new StringBuilder();
+						  for (int rootIndex = 0; rootIndex < index; rootIndex++) {
+								final String rootName = entryAsPath.getName(rootIndex).toString();
+								if (!rootName.equals(".")) {
+									 jreRoot.append(rootName).append('/');
+								}
+						  }
+						  return jreRoot.toString();
+					 }
+				}
+				return null;
+		  }
+
+		  /**
+			* Moves what was extracted below the JRE root into {@code jreDirectory}, then deletes the excluded paths among them.
+			*
+			* @throws IOException if an IO error occurs
+			*/
+		  private void moveStagedJreRoot () throws IOException {
+				LOG.debug("Found JRE root '" + jreRoot + "'");
+				Files.createDirectories(jreDirectory);
+				Path stagedJreRoot = stagingDirectory.resolve(jreRoot);
+				if (!Files.isDirectory(stagedJreRoot, NOFOLLOW_LINKS)) {
+					 return;
+				}
+				moveDirectoryContents(stagedJreRoot, jreDirectory);
+
+				Files.walkFileTree(jreDirectory, new SimpleFileVisitor<Path>() {
+					 @Override public FileVisitResult preVisitDirectory (Path dir, BasicFileAttributes attrs) throws IOException {
+						  if (!dir.equals(jreDirectory) && isExcluded.test(getRelativePathString(dir, jreDirectory))) {
+								PackrFileUtils.deleteDirectory(dir.toFile());
+								return FileVisitResult.SKIP_SUBTREE;
+						  }
+						  return FileVisitResult.CONTINUE;
+					 }
+
+					 @Override public FileVisitResult visitFile (Path file, BasicFileAttributes attrs) throws IOException {
+						  if (isExcluded.test(getRelativePathString(file, jreDirectory))) {
+								Files.delete(file);
+						  }
+						  return FileVisitResult.CONTINUE;
+					 }
+				});
+		  }
+
+		  /**
+			* Renames the contents of {@code sourceDirectory} into {@code targetDirectory}, merging directories that exist in both.
+			*
+			* @param sourceDirectory the directory to move the contents of
+			* @param targetDirectory the directory to move into
+			* @throws IOException if an IO error occurs
+			*/
+		  private static void moveDirectoryContents (Path sourceDirectory, Path targetDirectory) throws IOException {
+				try (DirectoryStream<Path> sources = Files.newDirectoryStream(sourceDirectory)) {
+					 for (Path source : sources) {
+						  Path target = targetDirectory.resolve(source.getFileName().toString());
+						  if (Files.isDirectory(source, NOFOLLOW_LINKS) && Files.isDirectory(target, NOFOLLOW_LINKS)) {
+								moveDirectoryContents(source, target);
+						  } else {
+								Files.move(source, target, StandardCopyOption.REPLACE_EXISTING);
+						  }
+					 }
+				}
+		  }
+
+		  private void deleteStagingDirectory () throws IOException {
+				if (Files.exists(stagingDirectory, NOFOLLOW_LINKS)) {
+					 PackrFileUtils.deleteDirectory(stagingDirectory.toFile());
 				}
 		  }
 	 }
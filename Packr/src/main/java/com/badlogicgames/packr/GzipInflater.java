@@ -0,0 +1,470 @@
+/*
+ * Copyright 2020 See AUTHORS file
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.badlogicgames.packr;
+
+import java.io.EOFException;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.Arrays;
+import java.util.zip.ZipException;
+
+/**
+ * Decodes the deflate data of gzip files, see RFC 1951 and RFC 1952.
+ * <p>
+ * Unlike {@link java.util.zip.Inflater}, decoding can start at any block boundary, given its bit offset in the file and the 32 KiB of data decoded before it.
+ * {@link ParallelGzipInputStream} uses this to decode chunks of a file on multiple threads. Decoding happens one block at a time, so callers can record the
+ * block boundaries.
+ */
+final class GzipInflater {
+	 /**
+	  * The most data a deflate stream refers back to.
+	  */
+	 static final int WINDOW_SIZE = 32768;
+
+	 private static final int INPUT_BUFFER_SIZE = 65536;
+
+	 private static final int[] LENGTH_BASE = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227,
+		 258};
+	 private static final int[] LENGTH_EXTRA_BITS = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	 private static final int[] DISTANCE_BASE = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+		 6145, 8193, 12289, 16385, 24577};
+	 private static final int[] DISTANCE_EXTRA_BITS = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+	 private static final int[] CODE_LENGTH_ORDER = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	 private static final HuffmanTable FIXED_LITERAL_TABLE;
+	 private static final HuffmanTable FIXED_DISTANCE_TABLE;
+
+	 static {
+		  int[] literalLengths = new int[288];
+		  Arrays.fill(literalLengths, 0, 144, 8);
+		  Arrays.fill(literalLengths, 144, 256, 9);
+		  Arrays.fill(literalLengths, 256, 280, 7);
+		  Arrays.fill(literalLengths, 280, 288, 8);
+		  int[] distanceLengths = new int[32];
+		  Arrays.fill(distanceLengths, 5);
+		  try {
+				FIXED_LITERAL_TABLE = new HuffmanTable(literalLengths, literalLengths.length);
+				FIXED_DISTANCE_TABLE = new HuffmanTable(distanceLengths, distanceLengths.length);
+		  } catch (ZipException exception) {
+				throw new IllegalStateException(exception);
+		  }
+	 }
+
+	 private enum State {
+		  BLOCK_HEADER, STORED_BLOCK, HUFFMAN_BLOCK, END_OF_MEMBER
+	 }
+
+	 private final FileChannel channel;
+	 private final byte[] input = new byte[INPUT_BUFFER_SIZE];
+
+	 /**
+	  * The offset in the file of {@code input[0]}.
+	  */
+	 private long inputOffset;
+	 private int inputPosition;
+	 private int inputLength;
+
+	 /**
+	  * Bits read from the input but not consumed yet, the next bit is the lowest.
+	  */
+	 private long bitBuffer;
+	 private int bitCount;
+
+	 private State state = State.BLOCK_HEADER;
+	 private boolean finalBlock;
+	 private int storedRemaining;
+	 private HuffmanTable literalTable;
+	 private HuffmanTable distanceTable;
+	 private int copyLength;
+	 private int copyDistance;
+
+	 /**
+	  * Creates an inflater reading {@code channel} from {@code bitOffset}, which has to be the start of a gzip member or of a deflate block.
+	  *
+	  * @param channel   the gzip file, only read with absolute positions so it can be shared between threads
+	  * @param bitOffset the offset in bits to start at
+	  * @throws IOException if an IO error occurs
+	  */
+	 GzipInflater (FileChannel channel, long bitOffset) throws IOException {
+		  this.channel = channel;
+		  inputOffset = bitOffset >>> 3;
+		  readBits((int)(bitOffset & 7));
+	 }
+
+	 /**
+	  * @return the offset in bits of the next unconsumed bit in the file
+	  */
+	 long getBitOffset () {
+		  return (inputOffset + inputPosition) * 8 - bitCount;
+	 }
+
+	 /**
+	  * @return true if the next call to {@link #inflate(byte[], int, int)} starts a new block
+	  */
+	 boolean isAtBlockBoundary () {
+		  return state == State.BLOCK_HEADER;
+	 }
+
+	 /**
+	  * @return true if the final block of the gzip member was decoded
+	  */
+	 boolean isEndOfMember () {
+		  return state == State.END_OF_MEMBER;
+	 }
+
+	 /**
+	  * @return true if there's input left after the consumed bits
+	  * @throws IOException if an IO error occurs
+	  */
+	 boolean hasRemainingInput () throws IOException {
+		  return bitCount >= 8 || inputOffset + inputPosition < channel.size();
+	 }
+
+	 /**
+	  * Reads the header of a gzip member and prepares for decoding its first block.
+	  *
+	  * @throws IOException if the header is invalid, or an IO error occurs
+	  */
+	 void readMemberHeader () throws IOException {
+		  alignToByte();
+		  if (readBits(8) != 0x1f || readBits(8) != 0x8b) {
+				throw new ZipException("Not in gzip format");
+		  }
+		  if (readBits(8) != 8) {
+				throw new ZipException("Unsupported gzip compression method");
+		  }
+		  final int flags = readBits(8);
+		  // modification time, extra flags, and operating system
+		  readBits(16);
+		  readBits(16);
+		  readBits(16);
+		  if ((flags & 4) != 0) {
+				for (int extraLength = readBits(16); extraLength > 0; extraLength--) {
+					 readBits(8);
+				}
+		  }
+		  if ((flags & 8) != 0) {
+				skipZeroTerminatedString();
+		  }
+		  if ((flags & 16) != 0) {
+				skipZeroTerminatedString();
+		  }
+		  if ((flags & 2) != 0) {
+				readBits(16);
+		  }
+		  state = State.BLOCK_HEADER;
+	 }
+
+	 /**
+	  * Reads the trailer of a gzip member after its final block.
+	  *
+	  * @return the CRC-32 of the decoded member in the lower 32 bits and its length modulo 2^32 in the upper 32 bits
+	  * @throws IOException if an IO error occurs
+	  */
+	 long readMemberTrailer () throws IOException {
+		  alignToByte();
+		  long crc = readBits(16) | (long)readBits(16) << 16;
+		  long length = readBits(16) | (long)readBits(16) << 16;
+		  return crc | length << 32;
+	 }
+
+	 /**
+	  * Decodes into {@code output} from {@code outputPosition} until the end of the current block or {@code outputLimit}. Starts a new block if
+	  * {@link #isAtBlockBoundary()}, and ends the block if it ends exactly at {@code outputLimit}. The {@link #WINDOW_SIZE} bytes before
+	  * {@code outputPosition} have to be the data decoded before.
+	  *
+	  * @param output         the array to decode into
+	  * @param outputPosition the position to decode to
+	  * @param outputLimit    the position to stop at
+	  * @return the position after the decoded data
+	  * @throws IOException if the data is invalid, or an IO error occurs
+	  */
+	 int inflate (byte[] output, int outputPosition, int outputLimit) throws IOException {
+		  if (state == State.BLOCK_HEADER) {
+				readBlockHeader();
+		  }
+		  if (state == State.STORED_BLOCK) {
+				while (storedRemaining > 0 && outputPosition < outputLimit) {
+					 output[outputPosition++] = (byte)readBits(8);
+					 storedRemaining--;
+				}
+				if (storedRemaining == 0) {
+					 endBlock();
+				}
+		  } else if (state == State.HUFFMAN_BLOCK) {
+				while (true) {
+					 if (copyLength > 0) {
+						  final int length = Math.min(copyLength, outputLimit - outputPosition);
+						  int from = outputPosition - copyDistance;
+						  for (int index = 0; index < length; index++) {
+								output[outputPosition++] = output[from++];
+						  }
+						  copyLength -= length;
+					 }
+					 if (outputPosition >= outputLimit) {
+						  if (copyLength == 0 && skipEndOfBlock()) {
+								endBlock();
+						  }
+						  break;
+					 }
+
+					 final int symbol = decodeSymbol(literalTable);
+					 if (symbol < 256) {
+						  output[outputPosition++] = (byte)symbol;
+					 } else if (symbol == 256) {
+						  endBlock();
+						  break;
+					 } else {
+						  final int lengthCode = symbol - 257;
+						  if (lengthCode >= LENGTH_BASE.length) {
+								throw new ZipException("Invalid deflate length code " + symbol);
+						  }
+						  copyLength = LENGTH_BASE[lengthCode] + readBits(LENGTH_EXTRA_BITS[lengthCode]);
+						  final int distanceCode = decodeSymbol(distanceTable);
+						  if (distanceCode >= DISTANCE_BASE.length) {
+								throw new ZipException("Invalid deflate distance code " + distanceCode);
+						  }
+						  copyDistance = DISTANCE_BASE[distanceCode] + readBits(DISTANCE_EXTRA_BITS[distanceCode]);
+						  if (copyDistance > outputPosition) {
+								throw new ZipException("Invalid deflate distance " + copyDistance);
+						  }
+					 }
+				}
+		  }
+		  return outputPosition;
+	 }
+
+	 private void endBlock () {
+		  state = finalBlock ? State.END_OF_MEMBER : State.BLOCK_HEADER;
+	 }
+
+	 private void readBlockHeader () throws IOException {
+		  finalBlock = readBits(1) == 1;
+		  switch (readBits(2)) {
+		  case 0:
+				alignToByte();
+				storedRemaining = readBits(16);
+				if ((storedRemaining ^ 0xffff) != readBits(16)) {
+					 throw new ZipException("Invalid deflate stored block length");
+				}
+				state = State.STORED_BLOCK;
+				if (storedRemaining == 0) {
+					 endBlock();
+				}
+				break;
+		  case 1:
+				literalTable = FIXED_LITERAL_TABLE;
+				distanceTable = FIXED_DISTANCE_TABLE;
+				state = State.HUFFMAN_BLOCK;
+				break;
+		  case 2:
+				readDynamicTables();
+				state = State.HUFFMAN_BLOCK;
+				break;
+		  default:
+				throw new ZipException("Invalid deflate block type");
+		  }
+	 }
+
+	 private void readDynamicTables () throws IOException {
+		  final int literalCount = readBits(5) + 257;
+		  final int distanceCount = readBits(5) + 1;
+		  final int codeLengthCount = readBits(4) + 4;
+
+		  int[] codeLengthLengths = new int[CODE_LENGTH_ORDER.length];
+		  for (int index = 0; index < codeLengthCount; index++) {
+				codeLengthLengths[CODE_LENGTH_ORDER[index]] = readBits(3);
+		  }
+		  final HuffmanTable codeLengthTable = new HuffmanTable(codeLengthLengths, codeLengthLengths.length);
+
+		  int[] lengths = new int[literalCount + distanceCount];
+		  int index = 0;
+		  while (index < lengths.length) {
+				final int symbol = decodeSymbol(codeLengthTable);
+				if (symbol < 16) {
+					 lengths[index++] = symbol;
+					 continue;
+				}
+				int length = 0;
+				int repeat;
+				if (symbol == 16) {
+					 if (index == 0) {
+						  throw new ZipException("Invalid deflate code length repeat");
+					 }
+					 length = lengths[index - 1];
+					 repeat = 3 + readBits(2);
+				} else if (symbol == 17) {
+					 repeat = 3 + readBits(3);
+				} else {
+					 repeat = 11 + readBits(7);
+				}
+				if (index + repeat > lengths.length) {
+					 throw new ZipException("Invalid deflate code length repeat");
+				}
+				Arrays.fill(lengths, index, index + repeat, length);
+				index += repeat;
+		  }
+		  if (lengths[256] == 0) {
+				throw new ZipException("Deflate block without end of block code");
+		  }
+
+		  literalTable = new HuffmanTable(lengths, literalCount);
+		  distanceTable = new HuffmanTable(Arrays.copyOfRange(lengths, literalCount, lengths.length), distanceCount);
+	 }
+
+	 /**
+	  * Consumes the end of block code if it's next, so a block that ends exactly at the output limit is reported as ended.
+	  */
+	 private boolean skipEndOfBlock () throws IOException {
+		  if (bitCount < HuffmanTable.MAX_CODE_LENGTH) {
+				refill();
+		  }
+		  final int entry = literalTable.entries[(int)bitBuffer & literalTable.mask];
+		  final int length = entry & 15;
+		  if (length == 0 || length > bitCount || entry >>> 4 != 256) {
+				return false;
+		  }
+		  bitBuffer >>>= length;
+		  bitCount -= length;
+		  return true;
+	 }
+
+	 private int decodeSymbol (HuffmanTable table) throws IOException {
+		  if (bitCount < HuffmanTable.MAX_CODE_LENGTH) {
+				refill();
+		  }
+		  final int entry = table.entries[(int)bitBuffer & table.mask];
+		  final int length = entry & 15;
+		  if (length == 0) {
+				throw new ZipException("Invalid deflate code");
+		  }
+		  if (length > bitCount) {
+				throw new EOFException("Unexpected end of gzip data");
+		  }
+		  bitBuffer >>>= length;
+		  bitCount -= length;
+		  return entry >>> 4;
+	 }
+
+	 private int readBits (int count) throws IOException {
+		  if (count == 0) {
+				return 0;
+		  }
+		  if (bitCount < count) {
+				refill();
+				if (bitCount < count) {
+					 throw new EOFException("Unexpected end of gzip data");
+				}
+		  }
+		  final int value = (int)(bitBuffer & ((1L << count) - 1));
+		  bitBuffer >>>= count;
+		  bitCount -= count;
+		  return value;
+	 }
+
+	 private void alignToByte () throws IOException {
+		  readBits(bitCount & 7);
+	 }
+
+	 private void skipZeroTerminatedString () throws IOException {
+		  while (readBits(8) != 0) {
+				// skipping
+		  }
+	 }
+
+	 /**
+	  * Fills the bit buffer from the input, as far as the input goes.
+	  */
+	 private void refill () throws IOException {
+		  while (bitCount <= 56) {
+				if (inputPosition == inputLength && !readInput()) {
+					 return;
+				}
+				bitBuffer |= (long)(input[inputPosition++] & 0xff) << bitCount;
+				bitCount += 8;
+		  }
+	 }
+
+	 private boolean readInput () throws IOException {
+		  inputOffset += inputLength;
+		  inputPosition = 0;
+		  inputLength = 0;
+		  final ByteBuffer inputBuffer = ByteBuffer.wrap(input);
+		  while (inputBuffer.hasRemaining()) {
+				if (channel.read(inputBuffer, inputOffset + inputBuffer.position()) < 0) {
+					 break;
+				}
+		  }
+		  inputLength = inputBuffer.position();
+		  return inputLength > 0;
+	 }
+
+	 /**
+	  * A lookup table of a canonical Huffman code, indexed by the next {@link #MAX_CODE_LENGTH} or fewer bits of the input.
+	  */
+	 private static final class HuffmanTable {
+		  static final int MAX_CODE_LENGTH = 15;
+
+		  /**
+			* The symbol shifted left by 4, or'ed with the code length.
+			*/
+		  final int[] entries;
+		  final int mask;
+
+		  HuffmanTable (int[] lengths, int count) throws ZipException {
+				int[] lengthCounts = new int[MAX_CODE_LENGTH + 1];
+				for (int symbol = 0; symbol < count; symbol++) {
+					 lengthCounts[lengths[symbol]]++;
+				}
+				lengthCounts[0] = 0;
+
+				int maxLength = 1;
+				int left = 1;
+				for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+					 left = (left << 1) - lengthCounts[length];
+					 if (left < 0) {
+						  throw new ZipException("Invalid deflate Huffman code");
+					 }
+					 if (lengthCounts[length] > 0) {
+						  maxLength = length;
+					 }
+				}
+
+				int[] nextCode = new int[MAX_CODE_LENGTH + 1];
+				int code = 0;
+				for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+					 code = (code + lengthCounts[length - 1]) << 1;
+					 nextCode[length] = code;
+				}
+
+				entries = new int[1 << maxLength];
+				mask = entries.length - 1;
+				for (int symbol = 0; symbol < count; symbol++) {
+					 final int length = lengths[symbol];
+					 if (length == 0) {
+						  continue;
+					 }
+					 // deflate stores codes starting with their highest bit, the table is indexed starting with the lowest
+					 final int reversedCode = Integer.reverse(nextCode[length]++) >>> (32 - length);
+					 for (int index = reversedCode; index < entries.length; index += 1 << length) {
+						  entries[index] = symbol << 4 | length;
+					 }
+				}
+		  }
+	 }
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020 See AUTHORS file
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.badlogicgames.packr;
+
+/**
+ * API of the packr launcher for the application. Compile against this class, e.g. with a compileOnly dependency on packr. When the application is
+ * started by a packr executable, the launcher defines its own class with this name and these methods in the application's class loader, and that one
+ * is used instead. Otherwise the methods of this class do nothing.
+ * <p>
+ * Phases show up in the launcher's {@code --trace} output and in the index of a {@code --profile} run.
+ */
+public final class Launcher {
+
+	 private Launcher () {
+	 }
+
+	 /**
+	  * @return true if the application was started by a packr executable
+	  */
+	 public static boolean isAvailable () {
+		  return false;
+	 }
+
+	 /**
+	  * Records that the application reached a phase, e.g. "assets-loaded". Whitespace in the name is replaced with "-".
+	  *
+	  * @param phase the name of the phase
+	  */
+	 public static void markPhase (String phase) {
+	 }
+
+	 /**
+	  * Records that the application is ready for the user, as the "ready" phase.
+	  */
+	 public static void markReady () {
+	 }
+
+	 /**
+	  * Returns when a phase was first reached. The launcher records "launcher-started", "arguments-parsed", "configuration-loaded",
+	  * "jvm-library-loaded", "jvm-created", "main-class-loaded", and "main-invoked", in addition to the phases of the application.
+	  *
+	  * @param phase the name of the phase
+	  *
+	  * @return the microseconds since the epoch, or -1 if the phase wasn't reached
+	  */
+	 public static long getPhaseTimeMicros (String phase) {
+		  return -1;
+	 }
+}
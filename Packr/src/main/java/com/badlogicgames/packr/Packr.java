@@ -16,6 +16,7 @@
 
 package com.badlogicgames.packr;
 
+import com.eclipsesource.json.JsonObject;
 import com.lexicalscope.jewel.cli.ArgumentValidationException;
 import com.lexicalscope.jewel.cli.CliFactory;
 import com.lexicalscope.jewel.cli.ValidationFailure;
@@ -24,6 +25,7 @@ import org.apache.commons.compress.compressors.CompressorException;
 import org.apache.commons.compress.utils.FileNameUtils;
 import org.apache.commons.compress.utils.IOUtils;
 
+import java.io.BufferedOutputStream;
 import java.io.File;
 import java.io.FileOutputStream;
 import java.io.FileWriter;
@@ -40,12 +42,21 @@ import java.nio.file.Files;
 import java.nio.file.Path;
 import java.nio.file.SimpleFileVisitor;
 import java.nio.file.StandardCopyOption;
+import java.nio.file.StandardOpenOption;
 import java.nio.file.attribute.BasicFileAttributes;
+import java.util.Enumeration;
 import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Locale;
 import java.util.Map;
+import java.util.Set;
 import java.util.function.Predicate;
+import java.util.stream.Stream;
+import java.util.zip.ZipEntry;
+import java.util.zip.ZipFile;
+import java.util.zip.ZipOutputStream;
 
-import static com.badlogicgames.packr.ArchiveUtils.extractArchive;
+import static com.badlogicgames.packr.ArchiveUtils.extractJre;
 
 /**
  * Takes a couple of parameters and a JRE and bundles them into a platform specific distributable (zip on Windows and Linux, app bundle on Mac OS X).
@@ -179,6 +190,10 @@ public class Packr {
 
 		  PackrReduce.removePlatformLibs(output, config, removePlatformLibsFileFilter);
 
+		  if (config.singleFile) {
+				appendSingleFilePayload(output, config);
+		  }
+
 		  System.out.println("Done!");
 	 }
 
@@ -301,6 +316,13 @@ public class Packr {
 					 System.err.println("Warning! Classpath not found: " + cpSrc);
 				}
 		  }
+
+		  if (config.preloadClassList != null) {
+				System.out.println("Copying preload class list ...");
+				Files.copy(config.preloadClassList.toPath(),
+					 new File(output.resourcesFolder, config.preloadClassList.getName()).toPath(),
+					 StandardCopyOption.COPY_ATTRIBUTES);
+		  }
 	 }
 
 	 /**
@@ -318,15 +340,126 @@ public class Packr {
        }
        builder.append("  \"classPath\": [");
 
-       String delimiter = "\n";
-       for (String f : config.classpath) {
-          builder.append(delimiter).append("    \"").append(new File(f).getName()).append("\"");
-          delimiter = ",\n";
+       if (config.singleFile) {
+          // the classpath is merged into a zip file appended to the executable
+          builder.append("\n    \"").append(config.executable).append("\"");
+       } else {
+          String delimiter = "\n";
+          for (String f : config.classpath) {
+             builder.append(delimiter).append("    \"").append(new File(f).getName()).append("\"");
+             delimiter = ",\n";
+          }
        }
        builder.append("\n  ],\n");
 
        builder.append("  \"mainClass\": \"").append(config.mainClass).append("\",\n");
 		  builder.append("  \"useZgcIfSupportedOs\": ").append(config.useZgcIfSupportedOs).append(",\n");
+		  builder.append("  \"supervise\": ").append(config.supervise).append(",\n");
+		  builder.append("  \"supervisorStandby\": ").append(config.supervisorStandby).append(",\n");
+		  builder.append("  \"argumentFiles\": ").append(config.argumentFiles).append(",\n");
+		  if (config.preloadClasses != null && !config.preloadClasses.isEmpty()) {
+				builder.append("  \"preloadClasses\": [");
+				String preloadClassDelimiter = "\n";
+				for (String preloadClass : config.preloadClasses) {
+					 builder.append(preloadClassDelimiter).append("    \"").append(preloadClass).append("\"");
+					 preloadClassDelimiter = ",\n";
+				}
+				builder.append("\n  ],\n");
+		  }
+		  if (config.preloadClassList != null) {
+				builder.append("  \"preloadClassList\": \"").append(config.preloadClassList.getName()).append("\",\n");
+		  }
+		  if (config.warmupEntryPoints != null && !config.warmupEntryPoints.isEmpty()) {
+				builder.append("  \"warmupEntryPoints\": [");
+				String warmupEntryPointDelimiter = "\n";
+				for (String warmupEntryPoint : config.warmupEntryPoints) {
+					 builder.append(warmupEntryPointDelimiter).append("    \"").append(warmupEntryPoint).append("\"");
+					 warmupEntryPointDelimiter = ",\n";
+				}
+				builder.append("\n  ],\n");
+		  }
+		  if (config.warmupThreads != null) {
+				builder.append("  \"warmupThreads\": ").append(config.warmupThreads).append(",\n");
+		  }
+		  if (config.warmupTimeBudgetMs != null) {
+				builder.append("  \"warmupTimeBudgetMs\": ").append(config.warmupTimeBudgetMs).append(",\n");
+		  }
+		  if (config.profile || config.profileDirectory != null || config.profileMaxRecordingSizeMb != null) {
+				JsonObject profile = new JsonObject().add("enabled", config.profile);
+				if (config.profileDirectory != null) {
+					 profile.add("directory", config.profileDirectory);
+				}
+				if (config.profileMaxRecordingSizeMb != null) {
+					 profile.add("maxRecordingSizeMb", config.profileMaxRecordingSizeMb);
+				}
+				builder.append("  \"profile\": ").append(profile.toString()).append(",\n");
+		  }
+		  if (config.controlSocket) {
+				builder.append("  \"controlSocket\": true,\n");
+		  }
+		  if (config.startupDeadlines != null && !config.startupDeadlines.isEmpty()) {
+				JsonObject startupDeadlines = new JsonObject();
+				for (Map.Entry<String, Integer> startupDeadline : config.startupDeadlines.entrySet()) {
+					 startupDeadlines.add(startupDeadline.getKey(), startupDeadline.getValue());
+				}
+				builder.append("  \"startupDeadlines\": ").append(startupDeadlines.toString()).append(",\n");
+		  }
+		  if (config.memoryPressure || config.memoryPressureHighPercent != null || config.memoryPressureLowPercent != null
+			  || config.memoryPressureSoftMaxHeapPercent != null) {
+				JsonObject memoryPressure = new JsonObject().add("enabled", config.memoryPressure);
+				if (config.memoryPressureHighPercent != null) {
+					 memoryPressure.add("highPercent", config.memoryPressureHighPercent);
+				}
+				if (config.memoryPressureLowPercent != null) {
+					 memoryPressure.add("lowPercent", config.memoryPressureLowPercent);
+				}
+				if (config.memoryPressureSoftMaxHeapPercent != null) {
+					 memoryPressure.add("softMaxHeapPercent", config.memoryPressureSoftMaxHeapPercent);
+				}
+				builder.append("  \"memoryPressure\": ").append(memoryPressure.toString()).append(",\n");
+		  }
+		  if (config.shutdownWaitMs != null || config.shutdownHaltAfterMs != null) {
+				JsonObject shutdownPolicy = new JsonObject();
+				if (config.shutdownWaitMs != null) {
+					 shutdownPolicy.add("waitMs", config.shutdownWaitMs);
+				}
+				if (config.shutdownHaltAfterMs != null) {
+					 shutdownPolicy.add("haltAfterMs", config.shutdownHaltAfterMs);
+				}
+				builder.append("  \"shutdownPolicy\": ").append(shutdownPolicy.toString()).append(",\n");
+		  }
+		  if (config.processNice != null || config.processScheduler != null || config.processIoClass != null || config.processIoPriority != null
+			  || config.processOomScoreAdjust != null) {
+				JsonObject processPriority = new JsonObject();
+				if (config.processNice != null) {
+					 processPriority.add("nice", config.processNice);
+				}
+				if (config.processScheduler != null) {
+					 processPriority.add("scheduler", config.processScheduler);
+				}
+				if (config.processIoClass != null) {
+					 processPriority.add("ioClass", config.processIoClass);
+				}
+				if (config.processIoPriority != null) {
+					 processPriority.add("ioPriority", config.processIoPriority);
+				}
+				if (config.processOomScoreAdjust != null) {
+					 processPriority.add("oomScoreAdjust", config.processOomScoreAdjust);
+				}
+				builder.append("  \"processPriority\": ").append(processPriority.toString()).append(",\n");
+		  }
+		  if (config.hugePageJvmText) {
+				builder.append("  \"hugePageJvmText\": true,\n");
+		  }
+		  if (config.jreVariants != null && !config.jreVariants.isEmpty()) {
+				builder.append("  \"jreVariants\": [");
+				String jreVariantDelimiter = "\n";
+				for (PackrConfig.JreVariant jreVariant : config.jreVariants) {
+					 builder.append(jreVariantDelimiter).append("    ").append(jreVariant.toJson().toString());
+					 jreVariantDelimiter = ",\n";
+				}
+				builder.append("\n  ],\n");
+		  }
 		  builder.append("  \"vmArgs\": [\n");
 
 		  for (int i = 0; i < config.vmArgs.size(); i++) {
@@ -351,7 +484,86 @@ public class Packr {
 	 }
 
 	 /**
-	  * Acquires the JDK specified and unpacks it if it's not a directory into a new temporary directory. The new temporary directory for the JDK is minimized.
+	  * Turns the output into a single file executable by appending the configuration and a zip file merging all classpath entries to the executable. The
+	  * configuration file and the classpath entries are removed from the output afterwards. The JVM reads classes directly from the executable because
+	  * a zip file is located from its end, the launcher finds the configuration through the trailer stored in the zip file comment.
+	  *
+	  * @param output the output containing the executable, configuration, and classpath
+	  * @param config the packr config naming the executable and classpath
+	  *
+	  * @throws IOException if an IO error occurs
+	  */
+	 void appendSingleFilePayload (PackrOutput output, PackrConfig config) throws IOException {
+		  System.out.println("Appending configuration and classpath to the executable ...");
+
+		  Path executablePath = output.executableFolder.toPath().resolve(config.executable);
+		  Path configPath = output.resourcesFolder.toPath().resolve(config.executable + ".json");
+		  byte[] configBytes = Files.readAllBytes(configPath);
+		  long configOffset = Files.size(executablePath);
+		  Set<String> entryNames = new HashSet<>();
+
+		  try (OutputStream executableOutput = new BufferedOutputStream(Files.newOutputStream(executablePath, StandardOpenOption.APPEND));
+				 ZipOutputStream zipOutput = new ZipOutputStream(executableOutput)) {
+				executableOutput.write(configBytes);
+
+				for (String classpath : config.classpath) {
+					 File classpathEntry = new File(output.resourcesFolder, new File(classpath).getName());
+					 if (config.verbose) {
+						  System.out.println("  # Merging '" + classpathEntry.getName() + "'");
+					 }
+					 if (classpathEntry.isDirectory()) {
+						  Path classpathDirectory = classpathEntry.toPath();
+						  try (Stream<Path> files = Files.walk(classpathDirectory)) {
+								for (Path file : (Iterable<Path>) files.filter(Files::isRegularFile)::iterator) {
+									 String entryName = classpathDirectory.relativize(file).toString().replace(File.separatorChar, '/');
+									 try (InputStream input = Files.newInputStream(file)) {
+										  addSingleFileZipEntry(zipOutput, entryNames, new ZipEntry(entryName), input);
+									 }
+								}
+						  }
+						  PackrFileUtils.deleteDirectory(classpathEntry);
+					 } else if (classpathEntry.isFile()) {
+						  try (ZipFile classpathZip = new ZipFile(classpathEntry)) {
+								Enumeration<? extends ZipEntry> entries = classpathZip.entries();
+								while (entries.hasMoreElements()) {
+									 ZipEntry entry = entries.nextElement();
+									 try (InputStream input = classpathZip.getInputStream(entry)) {
+										  addSingleFileZipEntry(zipOutput, entryNames, new ZipEntry(entry.getName()), input);
+									 }
+								}
+						  }
+						  Files.delete(classpathEntry.toPath());
+					 }
+				}
+
+				zipOutput.setComment(String.format(Locale.ROOT, "PACKR-PAYLOAD %020d %020d\n", configOffset, configBytes.length));
+		  }
+
+		  Files.delete(configPath);
+	 }
+
+	 /**
+	  * Adds an entry to the single file zip unless an earlier classpath entry already added one with the same name. Jar signatures are dropped because
+	  * they don't match the merged content.
+	  */
+	 private static void addSingleFileZipEntry (ZipOutputStream zipOutput, Set<String> entryNames, ZipEntry entry, InputStream input) throws IOException {
+		  String upperCaseName = entry.getName().toUpperCase(Locale.ROOT);
+		  if (upperCaseName.startsWith("META-INF/") && (upperCaseName.endsWith(".SF") || upperCaseName.endsWith(".RSA") || upperCaseName.endsWith(".DSA")
+				|| upperCaseName.endsWith(".EC"))) {
+				return;
+		  }
+		  if (!entryNames.add(entry.getName())) {
+				return;
+		  }
+		  zipOutput.putNextEntry(entry);
+		  if (!entry.isDirectory()) {
+				IOUtils.copy(input, zipOutput);
+		  }
+		  zipOutput.closeEntry();
+	 }
+
+	 /**
+	  * Acquires the JDK specified and unpacks the JRE it contains into the JRE path, or the JRE cache, which is then minimized.
 	  *
 	  * @param output the output for the minimized JDK
 	  * @param config the packr config for locating the JDK
@@ -402,35 +614,33 @@ public class Packr {
 					 }
 				}
 
-				// unpack JDK zip (or copy if it's a folder)
+				// unpack the JRE from the JDK zip (or copy it if it's a folder)
 				System.out.println("Unpacking JRE ...");
-				File tmp = new File(jreStoragePath, "tmp");
-				if (tmp.exists()) {
-					 PackrFileUtils.deleteDirectory(tmp);
-				}
-				Files.createDirectories(tmp.toPath());
+				File jreDirectory = new File(jreStoragePath, jrePath);
+				boolean removedWhileExtracting = false;
 
 				if (jdkFile.isDirectory()) {
-					 PackrFileUtils.copyDirectory(jdkFile, tmp);
-            } else {
-               extractArchive(jdkFile.toPath(), tmp.toPath());
-            }
-
-          // copy the JVM sub folder
-          File jre = findJvmDynamicLibraryBaseDirectory(tmp.toPath());
-          if (jre == null) {
-             throw new IOException("Couldn't find JRE in JDK, see '" + tmp.getAbsolutePath() + "'");
-          }
-
-          PackrFileUtils.copyDirectory(jre, new File(jreStoragePath, jrePath));
-          PackrFileUtils.deleteDirectory(tmp);
+					 File jre = findJvmDynamicLibraryBaseDirectory(jdkFile.toPath());
+					 if (jre == null) {
+						  throw new IOException("Couldn't find JRE in JDK, see '" + jdkFile.getAbsolutePath() + "'");
+					 }
+					 PackrFileUtils.copyDirectory(jre, jreDirectory);
+				} else {
+					 // write only the JRE, and skip what the minimize profile would remove afterwards, downloaded JDKs are deleted so they aren't indexed
+					 final Predicate<String> removeFilter = PackrReduce.createRemoveFilter(config);
+					 final String jrePathPrefix = jrePath.replace('\\', '/') + "/";
+					 if (!extractJre(jdkFile.toPath(), jreDirectory.toPath(), path -> removeFilter.test(jrePathPrefix + path), !fetchFromRemote)) {
+						  throw new IOException("Couldn't find JRE in JDK '" + jdkFile.getAbsolutePath() + "'");
+					 }
+					 removedWhileExtracting = true;
+				}
 
           if (fetchFromRemote) {
              Files.deleteIfExists(jdkFile.toPath());
           }
 
           // run minimize
-          PackrReduce.minimizeJre(jreStoragePath, config);
+          PackrReduce.minimizeJre(jreStoragePath, config, removedWhileExtracting);
        }
 
        if (extractToCache) {
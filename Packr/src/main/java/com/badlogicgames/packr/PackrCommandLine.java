@@ -74,6 +74,97 @@ public interface PackrCommandLine {
 
 	 @Option(description = "use ZGC if the operating system supports it", longName = "useZgcIfSupportedOs") boolean useZgcIfSupportedOs ();
 
+	 @Option(description = "classes the launcher loads on a background thread while the main method runs",
+		 longName = "preloadClasses",
+		 defaultToNull = true) List<String> preloadClasses ();
+
+	 @Option(description = "file with classes to preload, e.g. written by -XX:DumpLoadedClassList in a training run",
+		 longName = "preloadClassList",
+		 defaultToNull = true) File preloadClassList ();
+
+	 @Option(description = "static no-argument methods, e.g. com.my.App.warmup, the launcher invokes concurrently with the main method",
+		 longName = "warmupEntryPoints",
+		 defaultToNull = true) List<String> warmupEntryPoints ();
+
+	 @Option(description = "maximum number of threads invoking the warm-up entry points", longName = "warmupThreads", defaultToNull = true) Integer warmupThreads ();
+
+	 @Option(description = "milliseconds after which warm-up entry points that haven't started are skipped",
+		 longName = "warmupTimeBudgetMs",
+		 defaultToNull = true) Long warmupTimeBudgetMs ();
+
+	 @Option(description = "append the configuration and classpath to the executable instead of writing separate files (linux64 only)",
+		 longName = "singleFile") boolean singleFile ();
+
+	 @Option(description = "run Java in a child process that the launcher restarts if it crashes (Linux only)", longName = "supervise") boolean supervise ();
+
+	 @Option(description = "keep a started standby Java process that takes over after a crash, implies --supervise (Linux only)",
+		 longName = "supervisorStandby") boolean supervisorStandby ();
+
+	 @Option(description = "let the executable expand @file arguments to the arguments listed in the file",
+		 longName = "argumentFiles") boolean argumentFiles ();
+
+	 @Option(description = "let the executable record a diagnostics profile of every run, the executable's --profile option does this for a single run",
+		 longName = "profile") boolean profile ();
+
+	 @Option(description = "directory the executable writes diagnostics profiles to, by default packr-profiles in the temporary directory",
+		 longName = "profileDirectory",
+		 defaultToNull = true) String profileDirectory ();
+
+	 @Option(description = "maximum size in MB of the flight recording of a diagnostics profile",
+		 longName = "profileMaxRecordingSizeMb",
+		 defaultToNull = true) Integer profileMaxRecordingSizeMb ();
+
+	 @Option(description = "let the executable answer requests for metrics, thread dumps, and flight recordings on a Unix domain socket (Linux and macOS only)",
+		 longName = "controlSocket") boolean controlSocket ();
+
+	 @Option(description = "startup phases and the milliseconds the executable may take to reach them, e.g. jvm-created=2000, a missed deadline writes stacks to a diagnostics file",
+		 longName = "startupDeadlines",
+		 defaultToNull = true) List<String> startupDeadlines ();
+
+	 @Option(description = "let the executable shrink the Java heap while the system is under memory pressure (Linux only)",
+		 longName = "memoryPressure") boolean memoryPressure ();
+
+	 @Option(description = "percent of time tasks stall on memory at which the executable shrinks the Java heap, 10 by default",
+		 longName = "memoryPressureHighPercent",
+		 defaultToNull = true) Double memoryPressureHighPercent ();
+
+	 @Option(description = "percent of time tasks stall on memory at which the executable restores the Java heap, 2 by default",
+		 longName = "memoryPressureLowPercent",
+		 defaultToNull = true) Double memoryPressureLowPercent ();
+
+	 @Option(description = "soft maximum heap size under memory pressure, in percent of the maximum heap size, 50 by default",
+		 longName = "memoryPressureSoftMaxHeapPercent",
+		 defaultToNull = true) Integer memoryPressureSoftMaxHeapPercent ();
+
+	 @Option(description = "milliseconds the executable waits for non-daemon threads after the main method returned before it calls System.exit",
+		 longName = "shutdownWaitMs",
+		 defaultToNull = true) Integer shutdownWaitMs ();
+
+	 @Option(description = "milliseconds the shutdown hooks of a forced shutdown may run before the executable halts the JVM",
+		 longName = "shutdownHaltAfterMs",
+		 defaultToNull = true) Integer shutdownHaltAfterMs ();
+
+	 @Option(description = "nice value from -20 to 19 the executable runs Java with", longName = "processNice", defaultToNull = true) Integer processNice ();
+
+	 @Option(description = "scheduling policy the executable runs Java with: other, batch, or idle (Linux only)",
+		 longName = "processScheduler",
+		 defaultToNull = true) String processScheduler ();
+
+	 @Option(description = "I/O scheduling class the executable runs Java with: realtime, best-effort, or idle",
+		 longName = "processIoClass",
+		 defaultToNull = true) String processIoClass ();
+
+	 @Option(description = "I/O priority within the I/O scheduling class, from 0, the highest, to 7 (Linux only)",
+		 longName = "processIoPriority",
+		 defaultToNull = true) Integer processIoPriority ();
+
+	 @Option(description = "adjustment from -1000 to 1000 of the score the out of memory killer picks processes by (Linux only)",
+		 longName = "processOomScoreAdjust",
+		 defaultToNull = true) Integer processOomScoreAdjust ();
+
+	 @Option(description = "let the executable copy the code of libjvm.so onto transparent huge pages after loading it (Linux only)",
+		 longName = "hugePageJvmText") boolean hugePageJvmText ();
+
 	 @Option(description = "path to bundled JRE (path separator must be forward slash /)",
 			longName = "jrePath", defaultValue = "jre") String jrePath ();
 }
@@ -26,7 +26,10 @@ import java.io.IOException;
 import java.nio.charset.StandardCharsets;
 import java.nio.file.Files;
 import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.LinkedHashMap;
 import java.util.List;
+import java.util.Map;
 
 /**
  * The Packr configuration can be read from command line, read from a JSON config file, or created from Java code directly.
@@ -51,7 +54,34 @@ import java.util.List;
 	 public String bundleIdentifier;
 	 public boolean verbose;
 	 public boolean useZgcIfSupportedOs;
+	 public boolean supervise;
+	 public boolean supervisorStandby;
+	 public boolean argumentFiles;
+	 public boolean singleFile;
 	 public String jrePath;
+	 public List<JreVariant> jreVariants;
+	 public List<String> preloadClasses;
+	 public File preloadClassList;
+	 public List<String> warmupEntryPoints;
+	 public Integer warmupThreads;
+	 public Long warmupTimeBudgetMs;
+	 public boolean profile;
+	 public String profileDirectory;
+	 public Integer profileMaxRecordingSizeMb;
+	 public boolean controlSocket;
+	 public Map<String, Integer> startupDeadlines;
+	 public boolean memoryPressure;
+	 public Double memoryPressureHighPercent;
+	 public Double memoryPressureLowPercent;
+	 public Integer memoryPressureSoftMaxHeapPercent;
+	 public Integer shutdownWaitMs;
+	 public Integer shutdownHaltAfterMs;
+	 public Integer processNice;
+	 public String processScheduler;
+	 public String processIoClass;
+	 public Integer processIoPriority;
+	 public Integer processOomScoreAdjust;
+	 public boolean hugePageJvmText;
 
 	 @SuppressWarnings("unused") public PackrConfig () {
 		  super();
@@ -132,6 +162,116 @@ import java.util.List;
 				useZgcIfSupportedOs = true;
 		  }
 
+		  if (commandLine.singleFile()) {
+				singleFile = true;
+		  }
+
+		  if (commandLine.supervise()) {
+				supervise = true;
+		  }
+
+		  if (commandLine.supervisorStandby()) {
+				supervisorStandby = true;
+		  }
+
+		  if (commandLine.argumentFiles()) {
+				argumentFiles = true;
+		  }
+
+		  preloadClasses = appendTo(preloadClasses, commandLine.preloadClasses());
+
+		  if (commandLine.preloadClassList() != null) {
+				preloadClassList = commandLine.preloadClassList();
+		  }
+
+		  warmupEntryPoints = appendTo(warmupEntryPoints, commandLine.warmupEntryPoints());
+
+		  if (commandLine.warmupThreads() != null) {
+				warmupThreads = commandLine.warmupThreads();
+		  }
+
+		  if (commandLine.warmupTimeBudgetMs() != null) {
+				warmupTimeBudgetMs = commandLine.warmupTimeBudgetMs();
+		  }
+
+		  if (commandLine.profile()) {
+				profile = true;
+		  }
+
+		  if (commandLine.profileDirectory() != null) {
+				profileDirectory = commandLine.profileDirectory();
+		  }
+
+		  if (commandLine.profileMaxRecordingSizeMb() != null) {
+				profileMaxRecordingSizeMb = commandLine.profileMaxRecordingSizeMb();
+		  }
+
+		  if (commandLine.controlSocket()) {
+				controlSocket = true;
+		  }
+
+		  if (commandLine.startupDeadlines() != null) {
+				if (startupDeadlines == null) {
+					 startupDeadlines = new LinkedHashMap<>();
+				}
+				for (String startupDeadline : commandLine.startupDeadlines()) {
+					 int separator = startupDeadline.lastIndexOf('=');
+					 try {
+						  startupDeadlines.put(startupDeadline.substring(0, Math.max(0, separator)), Integer.parseInt(startupDeadline.substring(separator + 1)));
+					 } catch (NumberFormatException e) {
+						  throw new IOException("Startup deadline '" + startupDeadline + "' isn't a phase and milliseconds, e.g. jvm-created=2000.");
+					 }
+				}
+		  }
+
+		  if (commandLine.memoryPressure()) {
+				memoryPressure = true;
+		  }
+
+		  if (commandLine.memoryPressureHighPercent() != null) {
+				memoryPressureHighPercent = commandLine.memoryPressureHighPercent();
+		  }
+
+		  if (commandLine.memoryPressureLowPercent() != null) {
+				memoryPressureLowPercent = commandLine.memoryPressureLowPercent();
+		  }
+
+		  if (commandLine.memoryPressureSoftMaxHeapPercent() != null) {
+				memoryPressureSoftMaxHeapPercent = commandLine.memoryPressureSoftMaxHeapPercent();
+		  }
+
+		  if (commandLine.shutdownWaitMs() != null) {
+				shutdownWaitMs = commandLine.shutdownWaitMs();
+		  }
+
+		  if (commandLine.shutdownHaltAfterMs() != null) {
+				shutdownHaltAfterMs = commandLine.shutdownHaltAfterMs();
+		  }
+
+		  if (commandLine.processNice() != null) {
+				processNice = commandLine.processNice();
+		  }
+
+		  if (commandLine.processScheduler() != null) {
+				processScheduler = commandLine.processScheduler();
+		  }
+
+		  if (commandLine.processIoClass() != null) {
+				processIoClass = commandLine.processIoClass();
+		  }
+
+		  if (commandLine.processIoPriority() != null) {
+				processIoPriority = commandLine.processIoPriority();
+		  }
+
+		  if (commandLine.processOomScoreAdjust() != null) {
+				processOomScoreAdjust = commandLine.processOomScoreAdjust();
+		  }
+
+		  if (commandLine.hugePageJvmText()) {
+				hugePageJvmText = true;
+		  }
+
 		  jrePath = commandLine.jrePath();
 	 }
 
@@ -195,6 +335,94 @@ import java.util.List;
 		  if (json.get("useZgcIfSupportedOs") != null) {
 				useZgcIfSupportedOs = json.get("useZgcIfSupportedOs").asBoolean();
 		  }
+		  if (json.get("singleFile") != null) {
+				singleFile = json.get("singleFile").asBoolean();
+		  }
+		  if (json.get("supervise") != null) {
+				supervise = json.get("supervise").asBoolean();
+		  }
+		  if (json.get("supervisorStandby") != null) {
+				supervisorStandby = json.get("supervisorStandby").asBoolean();
+		  }
+		  if (json.get("argumentFiles") != null) {
+				argumentFiles = json.get("argumentFiles").asBoolean();
+		  }
+		  if (json.get("preloadClasses") != null) {
+				preloadClasses = toStringArray(json.get("preloadClasses").asArray());
+		  }
+		  if (json.get("preloadClassList") != null) {
+				preloadClassList = new File(json.get("preloadClassList").asString());
+		  }
+		  if (json.get("warmupEntryPoints") != null) {
+				warmupEntryPoints = toStringArray(json.get("warmupEntryPoints").asArray());
+		  }
+		  if (json.get("warmupThreads") != null) {
+				warmupThreads = json.get("warmupThreads").asInt();
+		  }
+		  if (json.get("warmupTimeBudgetMs") != null) {
+				warmupTimeBudgetMs = json.get("warmupTimeBudgetMs").asLong();
+		  }
+		  if (json.get("profile") != null) {
+				profile = json.get("profile").asBoolean();
+		  }
+		  if (json.get("profileDirectory") != null) {
+				profileDirectory = json.get("profileDirectory").asString();
+		  }
+		  if (json.get("profileMaxRecordingSizeMb") != null) {
+				profileMaxRecordingSizeMb = json.get("profileMaxRecordingSizeMb").asInt();
+		  }
+		  if (json.get("controlSocket") != null) {
+				controlSocket = json.get("controlSocket").asBoolean();
+		  }
+		  if (json.get("startupDeadlines") != null) {
+				JsonObject deadlines = json.get("startupDeadlines").asObject();
+				startupDeadlines = new LinkedHashMap<>();
+				for (String phase : deadlines.names()) {
+					 startupDeadlines.put(phase, deadlines.get(phase).asInt());
+				}
+		  }
+		  if (json.get("memoryPressure") != null) {
+				memoryPressure = json.get("memoryPressure").asBoolean();
+		  }
+		  if (json.get("memoryPressureHighPercent") != null) {
+				memoryPressureHighPercent = json.get("memoryPressureHighPercent").asDouble();
+		  }
+		  if (json.get("memoryPressureLowPercent") != null) {
+				memoryPressureLowPercent = json.get("memoryPressureLowPercent").asDouble();
+		  }
+		  if (json.get("memoryPressureSoftMaxHeapPercent") != null) {
+				memoryPressureSoftMaxHeapPercent = json.get("memoryPressureSoftMaxHeapPercent").asInt();
+		  }
+		  if (json.get("shutdownWaitMs") != null) {
+				shutdownWaitMs = json.get("shutdownWaitMs").asInt();
+		  }
+		  if (json.get("shutdownHaltAfterMs") != null) {
+				shutdownHaltAfterMs = json.get("shutdownHaltAfterMs").asInt();
+		  }
+		  if (json.get("processNice") != null) {
+				processNice = json.get("processNice").asInt();
+		  }
+		  if (json.get("processScheduler") != null) {
+				processScheduler = json.get("processScheduler").asString();
+		  }
+		  if (json.get("processIoClass") != null) {
+				processIoClass = json.get("processIoClass").asString();
+		  }
+		  if (json.get("processIoPriority") != null) {
+				processIoPriority = json.get("processIoPriority").asInt();
+		  }
+		  if (json.get("processOomScoreAdjust") != null) {
+				processOomScoreAdjust = json.get("processOomScoreAdjust").asInt();
+		  }
+		  if (json.get("hugePageJvmText") != null) {
+				hugePageJvmText = json.get("hugePageJvmText").asBoolean();
+		  }
+		  if (json.get("jreVariants") != null) {
+				jreVariants = new ArrayList<>();
+				for (JsonValue value : json.get("jreVariants").asArray()) {
+					 jreVariants.add(JreVariant.fromJson(value.asObject()));
+				}
+		  }
 	 }
 
 	 private <T> List<T> appendTo (List<T> list, List<T> append) {
@@ -258,6 +486,61 @@ import java.util.List;
 		  if (classpath.isEmpty()) {
 				throw new IOException("Empty class path. Please check your commandline or configuration.");
 		  }
+
+		  if (singleFile && platform != Platform.Linux64) {
+				throw new IOException("Single file executables are only supported for the linux64 platform.");
+		  }
+
+		  if (preloadClassList != null && !preloadClassList.isFile()) {
+				throw new IOException("Preload class list " + preloadClassList + " doesn't exist.");
+		  }
+
+		  if (profileMaxRecordingSizeMb != null && profileMaxRecordingSizeMb < 1) {
+				throw new IOException("The maximum size of the profile recording must be at least 1 MB.");
+		  }
+
+		  if (startupDeadlines != null) {
+				for (Map.Entry<String, Integer> startupDeadline : startupDeadlines.entrySet()) {
+					 if (startupDeadline.getKey().isEmpty() || startupDeadline.getValue() < 1) {
+						  throw new IOException("Startup deadline of phase '" + startupDeadline.getKey() + "' must name a phase and be at least 1 ms.");
+					 }
+				}
+		  }
+
+		  validatePercent(memoryPressureHighPercent, "memory pressure high percent");
+		  validatePercent(memoryPressureLowPercent, "memory pressure low percent");
+		  if (memoryPressureSoftMaxHeapPercent != null) {
+				validatePercent(memoryPressureSoftMaxHeapPercent.doubleValue(), "memory pressure soft maximum heap percent");
+		  }
+		  if (memoryPressureHighPercent != null && memoryPressureLowPercent != null && memoryPressureLowPercent > memoryPressureHighPercent) {
+				throw new IOException("The memory pressure low percent must not be above the high percent.");
+		  }
+
+		  if ((shutdownWaitMs != null && shutdownWaitMs < 0) || (shutdownHaltAfterMs != null && shutdownHaltAfterMs < 0)) {
+				throw new IOException("The shutdown wait and halt times must not be negative.");
+		  }
+
+		  if (processNice != null && (processNice < -20 || processNice > 19)) {
+				throw new IOException("The process nice value must be between -20 and 19.");
+		  }
+		  if (processScheduler != null && !Arrays.asList("other", "batch", "idle").contains(processScheduler)) {
+				throw new IOException("The process scheduler must be other, batch, or idle.");
+		  }
+		  if (processIoClass != null && !Arrays.asList("realtime", "best-effort", "idle").contains(processIoClass)) {
+				throw new IOException("The process I/O class must be realtime, best-effort, or idle.");
+		  }
+		  if (processIoPriority != null && (processIoPriority < 0 || processIoPriority > 7)) {
+				throw new IOException("The process I/O priority must be between 0 and 7.");
+		  }
+		  if (processOomScoreAdjust != null && (processOomScoreAdjust < -1000 || processOomScoreAdjust > 1000)) {
+				throw new IOException("The process OOM score adjustment must be between -1000 and 1000.");
+		  }
+
+		  if (jreVariants != null) {
+				for (JreVariant jreVariant : jreVariants) {
+					 validate(jreVariant.path, "JRE variant path");
+				}
+		  }
 	 }
 
 	 private <T> void validate (T parameter, String name) throws IOException {
@@ -266,6 +549,68 @@ import java.util.List;
 		  }
 	 }
 
+	 private void validatePercent (Double value, String name) throws IOException {
+		  if (value != null && (value < 0 || value > 100)) {
+				throw new IOException("The " + name + " must be between 0 and 100.");
+		  }
+	 }
+
+	 /**
+	  * A JRE directory bundled in addition to the main JRE, the launcher uses the first variant whose requirements the machine satisfies.
+	  */
+	 public static class JreVariant {
+		  /**
+		   * Path to the JRE directory relative to the executable, the directory is added to the output through {@link PackrConfig#resources}
+		   */
+		  public String path;
+		  /**
+		   * The VM to load from the JRE, e.g. "server" or "minimal"
+		   */
+		  public String vmType = "server";
+		  public int minCores;
+		  public long minMemoryMb;
+		  /**
+		   * CPU features that must be present, named like the flags in Linux /proc/cpuinfo, e.g. "avx2"
+		   */
+		  public List<String> cpuFeatures = new ArrayList<>();
+
+		  static JreVariant fromJson (JsonObject json) {
+				JreVariant jreVariant = new JreVariant();
+				if (json.get("path") != null) {
+					 jreVariant.path = json.get("path").asString();
+				}
+				if (json.get("vmType") != null) {
+					 jreVariant.vmType = json.get("vmType").asString();
+				}
+				if (json.get("minCores") != null) {
+					 jreVariant.minCores = json.get("minCores").asInt();
+				}
+				if (json.get("minMemoryMb") != null) {
+					 jreVariant.minMemoryMb = json.get("minMemoryMb").asLong();
+				}
+				if (json.get("cpuFeatures") != null) {
+					 for (JsonValue cpuFeature : json.get("cpuFeatures").asArray()) {
+						  jreVariant.cpuFeatures.add(cpuFeature.asString());
+					 }
+				}
+				return jreVariant;
+		  }
+
+		  JsonObject toJson () {
+				JsonObject json = new JsonObject();
+				json.add("path", path);
+				json.add("vmType", vmType);
+				json.add("minCores", minCores);
+				json.add("minMemoryMb", minMemoryMb);
+				JsonArray cpuFeaturesJson = new JsonArray();
+				for (String cpuFeature : cpuFeatures) {
+					 cpuFeaturesJson.add(cpuFeature);
+				}
+				json.add("cpuFeatures", cpuFeaturesJson);
+				return json;
+		  }
+	 }
+
 	 public enum Platform {
 		  Windows64("windows64"),
 		  Linux64("linux64"),
@@ -31,7 +31,9 @@ import java.nio.charset.StandardCharsets;
 import java.nio.file.Files;
 import java.nio.file.Paths;
 import java.nio.file.StandardCopyOption;
+import java.util.ArrayList;
 import java.util.HashSet;
+import java.util.List;
 import java.util.Set;
 import java.util.function.Predicate;
 
@@ -53,6 +55,22 @@ class PackrReduce {
 	  * @throws CompressorException if a compression error occurs
 	  */
 	 static void minimizeJre (File output, PackrConfig config) throws IOException, CompressorException, ArchiveException {
+		  minimizeJre(output, config, false);
+	 }
+
+	 /**
+	  * Tries to shrink the size of the JRE by deleting unused files and possibly removing items from the included jars of the JRE.
+	  *
+	  * @param output the directory to save the minimized JRE into
+	  * @param config the options for minimizing the JRE
+	  * @param removedWhileExtracting true if the profile's "remove" paths were skipped while extracting the JRE, see {@link #createRemoveFilter(PackrConfig)}
+	  *
+	  * @throws IOException if an IO error occurs
+	  * @throws ArchiveException if an archive error occurs
+	  * @throws CompressorException if a compression error occurs
+	  */
+	 static void minimizeJre (File output, PackrConfig config, boolean removedWhileExtracting)
+		 throws IOException, CompressorException, ArchiveException {
 		  if (config.minimizeJre == null) {
 				return;
 		  }
@@ -113,6 +131,10 @@ class PackrReduce {
 					 }
 				}
 
+				if (removedWhileExtracting) {
+					 return;
+				}
+
 				JsonArray removeArray = minimizeJson.get("remove").asArray();
 				for (JsonValue remove : removeArray) {
 					 String platform = remove.asObject().get("platform").asString();
@@ -129,6 +151,58 @@ class PackrReduce {
 		  }
 	 }
 
+	 /**
+	  * Creates a filter matching the paths that the "remove" section of the minimize profile deletes, so they can be skipped instead of written. A path matches
+	  * if it is, or is inside, a listed path, or if it is, or is inside, an entry directly in a wildcard path's directory whose name ends with the part after the
+	  * wildcard. This is the same set of paths that {@link #removeFileWildcard(File, String, PackrConfig)} deletes.
+	  *
+	  * @param config the options for minimizing the JRE
+	  *
+	  * @return a filter on paths relative to the directory the JRE is minimized in, separated by forward slashes
+	  *
+	  * @throws IOException if an IO error occurs
+	  */
+	 static Predicate<String> createRemoveFilter (PackrConfig config) throws IOException {
+		  if (config.minimizeJre == null) {
+				return path -> false;
+		  }
+
+		  JsonObject minimizeJson = readMinimizeProfile(config);
+		  if (minimizeJson == null) {
+				return path -> false;
+		  }
+
+		  List<String> removePaths = new ArrayList<>();
+		  for (JsonValue remove : minimizeJson.get("remove").asArray()) {
+				if (matchPlatformString(remove.asObject().get("platform").asString(), config)) {
+					 for (JsonValue removeFile : remove.asObject().get("paths").asArray()) {
+						  removePaths.add(removeFile.asString());
+					 }
+				}
+		  }
+
+		  return path -> {
+				for (String removePath : removePaths) {
+					 if (removePath.contains("*")) {
+						  String removeDirectory = removePath.substring(0, removePath.indexOf('*') - 1) + "/";
+						  String removeSuffix = removePath.substring(removePath.indexOf('*') + 1);
+						  if (path.startsWith(removeDirectory)) {
+								String name = path.substring(removeDirectory.length());
+								if (name.contains("/")) {
+									 name = name.substring(0, name.indexOf('/'));
+								}
+								if (name.endsWith(removeSuffix)) {
+									 return true;
+								}
+						  }
+					 } else if (path.equals(removePath) || path.startsWith(removePath + "/")) {
+						  return true;
+					 }
+				}
+				return false;
+		  };
+	 }
+
 	 /**
 	  * Creates a new zip file {@code zipFileOutput} from the directory {@code directoryToZipAndThenDelete}. After the Zip file is successfully created, {@code
 	  * directoryToZipAndThenDelete} is deleted.
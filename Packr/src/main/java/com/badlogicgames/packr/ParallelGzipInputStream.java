@@ -0,0 +1,480 @@
+/*
+ * Copyright 2020 See AUTHORS file
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.badlogicgames.packr;
+
+import org.slf4j.Logger;
+import org.slf4j.LoggerFactory;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InterruptedIOException;
+import java.lang.invoke.MethodHandles;
+import java.nio.channels.FileChannel;
+import java.nio.file.Files;
+import java.nio.file.NoSuchFileException;
+import java.nio.file.Path;
+import java.nio.file.StandardCopyOption;
+import java.nio.file.StandardOpenOption;
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Deque;
+import java.util.List;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.zip.CRC32;
+import java.util.zip.GZIPInputStream;
+import java.util.zip.GZIPOutputStream;
+import java.util.zip.ZipException;
+
+/**
+ * Decompresses a gzip file on multiple threads, using an index of deflate block boundaries that is cached next to the file.
+ * <p>
+ * Deflate data can only be decoded from the start, unless the bit offset of a block and the 32 KiB of data decoded before it are known. The first read of a
+ * file decodes it on the calling thread and records such checkpoints about every {@link #DEFAULT_CHECKPOINT_SPACING} bytes of decompressed data. Once the
+ * whole file was read, the checkpoints are written to {@link #getIndexPath(Path)}. Later reads decode the chunks between checkpoints on a thread per
+ * available processor. The index is only used while the size and modification time of the file match, and the decoded data is checked against the CRC-32
+ * and length recorded in it once it was read, or when the stream is closed within or just before the last chunk. A mismatch deletes the index and fails the
+ * read or the close.
+ */
+final class ParallelGzipInputStream extends InputStream {
+	 private static final Logger LOG = LoggerFactory.getLogger(MethodHandles.lookup().lookupClass());
+
+	 /**
+	  * Decompressed bytes between checkpoints of the index.
+	  */
+	 static final int DEFAULT_CHECKPOINT_SPACING = 4 * 1024 * 1024;
+
+	 /**
+	  * The largest chunk between two checkpoints, files with longer deflate blocks aren't indexed.
+	  */
+	 private static final int MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+	 /**
+	  * Decompressed bytes decoded on the calling thread at a time, while building the index.
+	  */
+	 private static final int SEQUENTIAL_BUFFER_SIZE = 1024 * 1024;
+
+	 /**
+	  * Closing the stream before the end of the file still finishes the index if at most this many compressed bytes are left, e.g. the padding after the end of
+	  * a tar archive.
+	  */
+	 private static final long MAX_DRAINED_SIZE = 1024 * 1024;
+
+	 private static final String INDEX_SUFFIX = ".packr-index";
+	 private static final int INDEX_MAGIC = 0x504b475a;
+	 private static final int INDEX_VERSION = 1;
+
+	 private static final AtomicInteger THREAD_NUMBER = new AtomicInteger();
+
+	 private final Path gzipPath;
+	 private final FileChannel channel;
+	 private final CRC32 crc = new CRC32();
+	 private long decodedSize;
+	 private boolean ended;
+
+	 /**
+	  * The decoded data returned by {@link #read()}, from {@code position} to {@code limit}.
+	  */
+	 private byte[] buffer;
+	 private int position;
+	 private int limit;
+
+	 // building the index
+	 private final GzipInflater inflater;
+	 private final int checkpointSpacing;
+	 private final List<Checkpoint> checkpoints = new ArrayList<>();
+	 private final CRC32 memberCrc = new CRC32();
+	 private long memberStart;
+	 private boolean indexable = true;
+
+	 // decoding with the index
+	 private final GzipIndex index;
+	 private final ExecutorService executorService;
+	 private final Deque<Future<byte[]>> pendingChunks = new ArrayDeque<>();
+	 private final int maxPendingChunks;
+	 private int nextChunk;
+
+	 /**
+	  * Opens a gzip file for parallel decompression.
+	  *
+	  * @param gzipPath   the gzip file
+	  * @param buildIndex whether to build and cache an index if the file isn't indexed yet
+	  * @return the decompressed data of all gzip members, or null if the file isn't indexed, and either {@code buildIndex} is false or the index can't be
+	  * written next to the file
+	  * @throws IOException if an IO error occurs
+	  */
+	 static InputStream open (Path gzipPath, boolean buildIndex) throws IOException {
+		  return open(gzipPath, buildIndex, DEFAULT_CHECKPOINT_SPACING);
+	 }
+
+	 /**
+	  * Opens a gzip file for parallel decompression, placing new checkpoints {@code checkpointSpacing} bytes apart.
+	  *
+	  * @see #open(Path, boolean)
+	  */
+	 static InputStream open (Path gzipPath, boolean buildIndex, int checkpointSpacing) throws IOException {
+		  final Path indexPath = getIndexPath(gzipPath);
+		  final GzipIndex index = readIndex(gzipPath, indexPath);
+		  if (index == null && !(buildIndex && Files.isWritable(indexPath.getParent()))) {
+				return null;
+		  }
+		  return new ParallelGzipInputStream(gzipPath, index, checkpointSpacing);
+	 }
+
+	 /**
+	  * @param gzipPath the gzip file
+	  * @return the path of the index cached for {@code gzipPath}
+	  */
+	 static Path getIndexPath (Path gzipPath) {
+		  final Path absolutePath = gzipPath.toAbsolutePath();
+		  return absolutePath.resolveSibling(absolutePath.getFileName() + INDEX_SUFFIX);
+	 }
+
+	 private ParallelGzipInputStream (Path gzipPath, GzipIndex index, int checkpointSpacing) throws IOException {
+		  this.gzipPath = gzipPath;
+		  this.index = index;
+		  this.checkpointSpacing = checkpointSpacing;
+		  channel = FileChannel.open(gzipPath, StandardOpenOption.READ);
+		  if (index == null) {
+				inflater = new GzipInflater(channel, 0);
+				buffer = new byte[GzipInflater.WINDOW_SIZE + SEQUENTIAL_BUFFER_SIZE];
+				position = limit = GzipInflater.WINDOW_SIZE;
+				executorService = null;
+				maxPendingChunks = 0;
+				try {
+					 inflater.readMemberHeader();
+				} catch (IOException exception) {
+					 channel.close();
+					 throw exception;
+				}
+		  } else {
+				inflater = null;
+				final int threads = Runtime.getRuntime().availableProcessors();
+				executorService = Executors.newFixedThreadPool(threads, runnable -> {
+					 Thread thread = new Thread(runnable, "packr-gunzip-" + THREAD_NUMBER.incrementAndGet());
+					 thread.setDaemon(true);
+					 return thread;
+				});
+				maxPendingChunks = threads * 2;
+		  }
+	 }
+
+	 @Override public int read () throws IOException {
+		  if (position == limit && !fill()) {
+				return -1;
+		  }
+		  return buffer[position++] & 0xff;
+	 }
+
+	 @Override public int read (byte[] bytes, int offset, int length) throws IOException {
+		  if (length == 0) {
+				return 0;
+		  }
+		  if (position == limit && !fill()) {
+				return -1;
+		  }
+		  final int count = Math.min(length, limit - position);
+		  System.arraycopy(buffer, position, bytes, offset, count);
+		  position += count;
+		  return count;
+	 }
+
+	 @Override public int available () {
+		  return limit - position;
+	 }
+
+	 @Override public void close () throws IOException {
+		  try {
+				if (executorService != null) {
+					 try {
+						  // check the CRC-32 and length if the reader stopped within or just before the last chunk, e.g. after the end of a tar archive
+						  if (!ended && channel.isOpen() && index.checkpoints.length - (nextChunk - pendingChunks.size()) <= 1) {
+								while (fill()) {
+									 position = limit;
+								}
+						  }
+					 } finally {
+						  executorService.shutdownNow();
+					 }
+				} else if (!ended && channel.isOpen() && channel.size() - inflater.getBitOffset() / 8 <= MAX_DRAINED_SIZE) {
+					 // finish the index if the reader stopped just before the end
+					 try {
+						  while (fill()) {
+								position = limit;
+						  }
+					 } catch (IOException exception) {
+						  LOG.debug("Couldn't finish the gzip index for " + gzipPath + ": " + exception.getMessage());
+					 }
+				}
+		  } finally {
+				channel.close();
+		  }
+	 }
+
+	 /**
+	  * Decodes the next decompressed data into {@link #buffer}.
+	  *
+	  * @return false at the end of the file
+	  */
+	 private boolean fill () throws IOException {
+		  if (ended) {
+				return false;
+		  }
+		  return index == null ? decodeSequentially() : decodeNextChunk();
+	 }
+
+	 private boolean decodeSequentially () throws IOException {
+		  while (true) {
+				if (inflater.isEndOfMember()) {
+					 final long trailer = inflater.readMemberTrailer();
+					 if ((int)trailer != (int)memberCrc.getValue() || (int)(trailer >>> 32) != (int)(decodedSize - memberStart)) {
+						  throw new ZipException("Corrupt gzip member in " + gzipPath + ", the CRC-32 or length doesn't match");
+					 }
+					 if (!inflater.hasRemainingInput()) {
+						  ended = true;
+						  if (indexable && checkpoints.size() > 1 && decodedSize - checkpoints.get(checkpoints.size() - 1).decodedOffset <= MAX_CHUNK_SIZE) {
+								writeIndex();
+						  }
+						  return false;
+					 }
+					 // concatenated gzip members, the index only supports a single one
+					 try {
+						  inflater.readMemberHeader();
+					 } catch (ZipException | EOFException exception) {
+						  LOG.debug("Ignoring data after the gzip members of " + gzipPath + ": " + exception.getMessage());
+						  ended = true;
+						  return false;
+					 }
+					 memberCrc.reset();
+					 memberStart = decodedSize;
+					 indexable = false;
+				}
+
+				if (limit == buffer.length) {
+					 System.arraycopy(buffer, limit - GzipInflater.WINDOW_SIZE, buffer, 0, GzipInflater.WINDOW_SIZE);
+					 position = limit = GzipInflater.WINDOW_SIZE;
+				}
+				if (indexable && inflater.isAtBlockBoundary()) {
+					 final long checkpointOffset = checkpoints.isEmpty() ? 0 : checkpoints.get(checkpoints.size() - 1).decodedOffset;
+					 if (decodedSize - checkpointOffset > MAX_CHUNK_SIZE) {
+						  indexable = false;
+					 } else if (checkpoints.isEmpty() || decodedSize - checkpointOffset >= checkpointSpacing) {
+						  checkpoints.add(new Checkpoint(inflater.getBitOffset(), decodedSize, Arrays.copyOfRange(buffer, limit - GzipInflater.WINDOW_SIZE, limit)));
+					 }
+				}
+
+				final int start = limit;
+				limit = inflater.inflate(buffer, limit, buffer.length);
+				if (limit > start) {
+					 crc.update(buffer, start, limit - start);
+					 memberCrc.update(buffer, start, limit - start);
+					 decodedSize += limit - start;
+					 position = start;
+					 return true;
+				}
+		  }
+	 }
+
+	 private boolean decodeNextChunk () throws IOException {
+		  while (pendingChunks.size() < maxPendingChunks && nextChunk < index.checkpoints.length) {
+				final int chunk = nextChunk++;
+				pendingChunks.add(executorService.submit(() -> decodeChunk(chunk)));
+		  }
+		  final Future<byte[]> pendingChunk = pendingChunks.poll();
+		  if (pendingChunk == null) {
+				ended = true;
+				if (decodedSize != index.decodedSize || (int)crc.getValue() != index.crc) {
+					 discardIndex();
+					 throw new ZipException("Decompressed " + gzipPath + " doesn't match its index, the index was deleted");
+				}
+				return false;
+		  }
+
+		  try {
+				buffer = pendingChunk.get();
+		  } catch (InterruptedException exception) {
+				Thread.currentThread().interrupt();
+				throw new InterruptedIOException("Interrupted while decompressing " + gzipPath);
+		  } catch (ExecutionException exception) {
+				discardIndex();
+				if (exception.getCause() instanceof IOException) {
+					 throw (IOException)exception.getCause();
+				}
+				throw new IOException(exception.getCause());
+		  }
+		  position = GzipInflater.WINDOW_SIZE;
+		  limit = buffer.length;
+		  crc.update(buffer, position, limit - position);
+		  decodedSize += limit - position;
+		  return true;
+	 }
+
+	 /**
+	  * Decodes the data from a checkpoint up to the next one, or the end of the file.
+	  *
+	  * @return the decoded data, after the window of the checkpoint
+	  */
+	 private byte[] decodeChunk (int chunk) throws IOException {
+		  final Checkpoint checkpoint = index.checkpoints[chunk];
+		  final boolean lastChunk = chunk == index.checkpoints.length - 1;
+		  final long endOffset = lastChunk ? index.decodedSize : index.checkpoints[chunk + 1].decodedOffset;
+		  final byte[] output = new byte[GzipInflater.WINDOW_SIZE + (int)(endOffset - checkpoint.decodedOffset)];
+		  System.arraycopy(checkpoint.window, 0, output, 0, GzipInflater.WINDOW_SIZE);
+
+		  final GzipInflater chunkInflater = new GzipInflater(channel, checkpoint.bitOffset);
+		  int outputPosition = GzipInflater.WINDOW_SIZE;
+		  while (outputPosition < output.length) {
+				if (chunkInflater.isEndOfMember()) {
+					 throw new ZipException("Gzip data of " + gzipPath + " ended before the end of chunk " + chunk + " of its index");
+				}
+				outputPosition = chunkInflater.inflate(output, outputPosition, output.length);
+		  }
+		  // empty blocks before the end of the file
+		  while (lastChunk && chunkInflater.isAtBlockBoundary()) {
+				chunkInflater.inflate(output, outputPosition, outputPosition);
+		  }
+		  if (lastChunk ? !chunkInflater.isEndOfMember() : !chunkInflater.isAtBlockBoundary()) {
+				throw new ZipException("Chunk " + chunk + " of the index of " + gzipPath + " doesn't end at a deflate block");
+		  }
+		  return output;
+	 }
+
+	 private void discardIndex () {
+		  try {
+				Files.deleteIfExists(getIndexPath(gzipPath));
+		  } catch (IOException exception) {
+				LOG.debug("Couldn't delete the gzip index of " + gzipPath + ": " + exception.getMessage());
+		  }
+	 }
+
+	 /**
+	  * Reads the cached index of a gzip file.
+	  *
+	  * @return the index, or null if there is none, or it doesn't match the file
+	  */
+	 private static GzipIndex readIndex (Path gzipPath, Path indexPath) {
+		  try (DataInputStream indexInputStream = new DataInputStream(
+			  new BufferedInputStream(new GZIPInputStream(Files.newInputStream(indexPath))))) {
+				if (indexInputStream.readInt() != INDEX_MAGIC || indexInputStream.readInt() != INDEX_VERSION
+					 || indexInputStream.readLong() != Files.size(gzipPath)
+					 || indexInputStream.readLong() != Files.getLastModifiedTime(gzipPath).toMillis()) {
+					 return null;
+				}
+				final long decodedSize = indexInputStream.readLong();
+				final int crc = indexInputStream.readInt();
+				final Checkpoint[] checkpoints = new Checkpoint[indexInputStream.readInt()];
+				for (int checkpoint = 0; checkpoint < checkpoints.length; checkpoint++) {
+					 final long bitOffset = indexInputStream.readLong();
+					 final long decodedOffset = indexInputStream.readLong();
+					 final long previousOffset = checkpoint == 0 ? 0 : checkpoints[checkpoint - 1].decodedOffset;
+					 if (checkpoint == 0 ? decodedOffset != 0 : decodedOffset <= previousOffset || decodedOffset - previousOffset > MAX_CHUNK_SIZE) {
+						  return null;
+					 }
+					 final byte[] window = new byte[GzipInflater.WINDOW_SIZE];
+					 indexInputStream.readFully(window);
+					 checkpoints[checkpoint] = new Checkpoint(bitOffset, decodedOffset, window);
+				}
+				if (checkpoints.length == 0 || decodedSize < checkpoints[checkpoints.length - 1].decodedOffset
+					 || decodedSize - checkpoints[checkpoints.length - 1].decodedOffset > MAX_CHUNK_SIZE) {
+					 return null;
+				}
+				return new GzipIndex(decodedSize, crc, checkpoints);
+		  } catch (NoSuchFileException exception) {
+				return null;
+		  } catch (IOException exception) {
+				LOG.debug("Ignoring the unreadable gzip index " + indexPath + ": " + exception.getMessage());
+				return null;
+		  }
+	 }
+
+	 /**
+	  * Writes the checkpoints recorded while decoding the whole file to its index. Failing to do so only means the next read isn't parallel.
+	  */
+	 private void writeIndex () {
+		  final Path indexPath = getIndexPath(gzipPath);
+		  Path temporaryIndexPath = null;
+		  try {
+				temporaryIndexPath = Files.createTempFile(indexPath.getParent(), indexPath.getFileName().toString(), ".tmp");
+				try (DataOutputStream indexOutputStream = new DataOutputStream(
+					 new BufferedOutputStream(new GZIPOutputStream(Files.newOutputStream(temporaryIndexPath))))) {
+					 indexOutputStream.writeInt(INDEX_MAGIC);
+					 indexOutputStream.writeInt(INDEX_VERSION);
+					 indexOutputStream.writeLong(Files.size(gzipPath));
+					 indexOutputStream.writeLong(Files.getLastModifiedTime(gzipPath).toMillis());
+					 indexOutputStream.writeLong(decodedSize);
+					 indexOutputStream.writeInt((int)crc.getValue());
+					 indexOutputStream.writeInt(checkpoints.size());
+					 for (Checkpoint checkpoint : checkpoints) {
+						  indexOutputStream.writeLong(checkpoint.bitOffset);
+						  indexOutputStream.writeLong(checkpoint.decodedOffset);
+						  indexOutputStream.write(checkpoint.window);
+					 }
+				}
+				Files.move(temporaryIndexPath, indexPath, StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE);
+				LOG.debug("Wrote gzip index " + indexPath + " with " + checkpoints.size() + " checkpoints");
+		  } catch (IOException exception) {
+				LOG.warn("Couldn't write gzip index " + indexPath + ": " + exception.getMessage());
+				if (temporaryIndexPath != null) {
+					 try {
+						  Files.deleteIfExists(temporaryIndexPath);
+					 } catch (IOException deleteException) {
+						  LOG.debug("Couldn't delete " + temporaryIndexPath + ": " + deleteException.getMessage());
+					 }
+				}
+		  }
+	 }
+
+	 /**
+	  * A deflate block boundary that decoding can start at.
+	  */
+	 private static final class Checkpoint {
+		  final long bitOffset;
+		  final long decodedOffset;
+
+		  /**
+			* The {@link GzipInflater#WINDOW_SIZE} bytes decoded before the checkpoint, zeros before the start of the file.
+			*/
+		  final byte[] window;
+
+		  Checkpoint (long bitOffset, long decodedOffset, byte[] window) {
+				this.bitOffset = bitOffset;
+				this.decodedOffset = decodedOffset;
+				this.window = window;
+		  }
+	 }
+
+	 private static final class GzipIndex {
+		  final long decodedSize;
+		  final int crc;
+		  final Checkpoint[] checkpoints;
+
+		  GzipIndex (long decodedSize, int crc, Checkpoint[] checkpoints) {
+				this.decodedSize = decodedSize;
+				this.crc = crc;
+				this.checkpoints = checkpoints;
+		  }
+	 }
+}
@@ -21,6 +21,8 @@ import org.apache.commons.compress.archivers.ArchiveEntry;
 import org.apache.commons.compress.archivers.ArchiveException;
 import org.apache.commons.compress.archivers.ArchiveOutputStream;
 import org.apache.commons.compress.archivers.ArchiveStreamFactory;
+import org.apache.commons.compress.archivers.tar.TarArchiveEntry;
+import org.apache.commons.compress.archivers.zip.ZipArchiveEntry;
 import org.apache.commons.compress.compressors.CompressorException;
 import org.junit.jupiter.api.Test;
 import org.junit.jupiter.api.io.TempDir;
@@ -38,11 +40,17 @@ import java.nio.file.LinkOption;
 import java.nio.file.Path;
 import java.nio.file.SimpleFileVisitor;
 import java.nio.file.attribute.BasicFileAttributes;
+import java.nio.file.attribute.FileTime;
 import java.nio.file.attribute.PosixFileAttributeView;
 import java.nio.file.attribute.PosixFilePermission;
 import java.util.Arrays;
+import java.util.Collections;
 import java.util.LinkedHashSet;
+import java.util.Random;
 import java.util.Set;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
+import java.util.zip.GZIPOutputStream;
 
 import static com.badlogicgames.packr.ArchiveUtils.ArchiveType.TAR;
 import static com.badlogicgames.packr.ArchiveUtils.ArchiveType.ZIP;
@@ -53,7 +61,10 @@ import static java.nio.file.attribute.PosixFilePermission.OTHERS_READ;
 import static java.nio.file.attribute.PosixFilePermission.OWNER_EXECUTE;
 import static java.nio.file.attribute.PosixFilePermission.OWNER_READ;
 import static java.nio.file.attribute.PosixFilePermission.OWNER_WRITE;
+import static org.junit.jupiter.api.Assertions.assertArrayEquals;
 import static org.junit.jupiter.api.Assertions.assertEquals;
+import static org.junit.jupiter.api.Assertions.assertFalse;
+import static org.junit.jupiter.api.Assertions.assertThrows;
 import static org.junit.jupiter.api.Assertions.assertTrue;
 import static org.junit.jupiter.api.Assumptions.assumeTrue;
 
@@ -277,6 +288,211 @@ class ArchiveUtilsTest {
 			  OTHERS_EXECUTE);
 	 }
 
+	 /**
+	  * Extracts a TAR archive with many entries, and verifies the contents and modification times of its files and directories.
+	  */
+	 @Test public void testManyEntriesTar (@TempDir Path tempDir) throws IOException, ArchiveException, CompressorException {
+		  createAndExtractManyEntries(tempDir, TAR);
+	 }
+
+	 /**
+	  * Extracts a Zip archive with many entries, and verifies the contents and modification times of its files and directories.
+	  */
+	 @Test public void testManyEntriesZip (@TempDir Path tempDir) throws IOException, ArchiveException, CompressorException {
+		  createAndExtractManyEntries(tempDir, ZIP);
+	 }
+
+	 private void createAndExtractManyEntries (Path tempDir, ArchiveType archiveType) throws IOException, ArchiveException, CompressorException {
+		  Path archiveDirectory = tempDir.resolve("archive-directory");
+		  for (int directoryIndex = 0; directoryIndex < 8; directoryIndex++) {
+				Path directory = Files.createDirectories(archiveDirectory.resolve("directory-" + directoryIndex).resolve("nested"));
+				for (int fileIndex = 0; fileIndex < 32; fileIndex++) {
+					 Files.write(directory.resolve("file-" + fileIndex + ".txt"), ("file " + directoryIndex + " " + fileIndex).getBytes(StandardCharsets.UTF_8));
+				}
+		  }
+		  // larger than the entries that are read into memory before writing
+		  byte[] largeContent = new byte[ArchiveEntryWriter.MAX_BUFFERED_ENTRY_SIZE + 1];
+		  new Random(0).nextBytes(largeContent);
+		  Files.write(archiveDirectory.resolve("large-file.bin"), largeContent);
+
+		  // even seconds survive the time resolution of Zip entries
+		  final FileTime lastModifiedTime = FileTime.fromMillis(1600000000000L);
+		  Files.walkFileTree(archiveDirectory, new SimpleFileVisitor<Path>() {
+				@Override public FileVisitResult visitFile (Path file, BasicFileAttributes attrs) throws IOException {
+					 Files.setLastModifiedTime(file, lastModifiedTime);
+					 return FileVisitResult.CONTINUE;
+				}
+
+				@Override public FileVisitResult postVisitDirectory (Path dir, IOException exc) throws IOException {
+					 Files.setLastModifiedTime(dir, lastModifiedTime);
+					 return FileVisitResult.CONTINUE;
+				}
+		  });
+
+		  Path archive = tempDir.resolve("archive");
+		  ArchiveUtils.createArchive(archiveType, archiveDirectory, archive);
+		  Path extractionDirectory = tempDir.resolve("extract");
+		  ArchiveUtils.extractArchive(archive, extractionDirectory);
+
+		  Files.walkFileTree(archiveDirectory, new SimpleFileVisitor<Path>() {
+				@Override public FileVisitResult visitFile (Path file, BasicFileAttributes attrs) throws IOException {
+					 Path extractedFile = extractionDirectory.resolve(archiveDirectory.relativize(file));
+					 assertArrayEquals(Files.readAllBytes(file), Files.readAllBytes(extractedFile), "Extracted file " + extractedFile + " should have matched original");
+					 assertEquals(lastModifiedTime.toMillis(), Files.getLastModifiedTime(extractedFile).toMillis(), "Modification time of " + extractedFile + " should have matched original");
+					 return FileVisitResult.CONTINUE;
+				}
+
+				@Override public FileVisitResult postVisitDirectory (Path dir, IOException exc) throws IOException {
+					 if (!dir.equals(archiveDirectory)) {
+						  Path extractedDirectory = extractionDirectory.resolve(archiveDirectory.relativize(dir));
+						  assertTrue(Files.isDirectory(extractedDirectory), extractedDirectory + " should have been extracted as a directory");
+						  assertEquals(lastModifiedTime.toMillis(), Files.getLastModifiedTime(extractedDirectory).toMillis(),
+							  "Modification time of " + extractedDirectory + " should have matched original");
+					 }
+					 return FileVisitResult.CONTINUE;
+				}
+		  });
+	 }
+
+	 /**
+	  * Extracts the JRE from a TAR of a JDK where entries precede the JVM shared library, and verifies only the JRE is written.
+	  */
+	 @Test public void testExtractJreTar (@TempDir Path tempDir) throws IOException, ArchiveException, CompressorException {
+		  createJdkArchiveAndExtractJre(tempDir, TAR);
+	 }
+
+	 /**
+	  * Extracts the JRE from a Zip of a JDK, and verifies only the JRE is written.
+	  */
+	 @Test public void testExtractJreZip (@TempDir Path tempDir) throws IOException, ArchiveException, CompressorException {
+		  createJdkArchiveAndExtractJre(tempDir, ZIP);
+	 }
+
+	 private void createJdkArchiveAndExtractJre (Path tempDir, ArchiveType archiveType)
+		 throws IOException, ArchiveException, CompressorException {
+		  Path archive = tempDir.resolve("jdk-archive");
+		  createArchiveOfEntryNames(archiveType, archive, "jdk/bin/javac", "jdk/jre/bin/java", "jdk/jre/lib/rhino.jar", "jdk/jre/lib/ext/nashorn.jar",
+			  "jdk/jre/lib/server/libjvm.so", "jdk/jre/lib/rt.jar", "jdk/jre/lib/ext/localedata.jar", "jdk/src.zip");
+
+		  Path outputDirectory = tempDir.resolve("output");
+		  Path jreDirectory = outputDirectory.resolve("jre");
+		  assertTrue(ArchiveUtils.extractJre(archive, jreDirectory, path -> path.equals("lib/rhino.jar") || path.startsWith("lib/ext")),
+			  "The JRE root should have been found in the archive");
+
+		  for (String extractedPath : new String[] {"bin/java", "lib/server/libjvm.so", "lib/rt.jar"}) {
+				assertEquals("jdk/jre/" + extractedPath, new String(Files.readAllBytes(jreDirectory.resolve(extractedPath)), StandardCharsets.UTF_8),
+					 "Extracted file " + extractedPath + " should have matched the archive entry");
+		  }
+		  for (String skippedPath : new String[] {"lib/rhino.jar", "lib/ext", "javac", "bin/javac", "src.zip"}) {
+				assertFalse(Files.exists(jreDirectory.resolve(skippedPath)), skippedPath + " shouldn't have been extracted");
+		  }
+		  try (Stream<Path> outputPaths = Files.list(outputDirectory)) {
+				assertEquals(Collections.singletonList(jreDirectory), outputPaths.collect(Collectors.toList()),
+					 "Only the JRE directory should have been left in the output directory");
+		  }
+	 }
+
+	 /**
+	  * Verifies that nothing is left behind when an archive doesn't contain a JRE.
+	  */
+	 @Test public void testExtractJreWithoutJvm (@TempDir Path tempDir) throws IOException, ArchiveException, CompressorException {
+		  Path archive = tempDir.resolve("archive");
+		  createArchiveOfEntryNames(TAR, archive, "jdk/bin/java", "jdk/lib/rt.jar");
+
+		  Path outputDirectory = Files.createDirectories(tempDir.resolve("output"));
+		  assertFalse(ArchiveUtils.extractJre(archive, outputDirectory.resolve("jre"), path -> false),
+			  "No JRE root should have been found in the archive");
+		  try (Stream<Path> outputPaths = Files.list(outputDirectory)) {
+				assertEquals(0, outputPaths.count(), "Nothing should have been left in the output directory");
+		  }
+	 }
+
+	 /**
+	  * Extracts the JRE from a gzip compressed TAR of a JDK twice, indexing the archive the first time and decompressing it in parallel the second time.
+	  */
+	 @Test public void testExtractJreTarGz (@TempDir Path tempDir) throws IOException, ArchiveException, CompressorException {
+		  Path archive = tempDir.resolve("jdk.tar.gz");
+		  createJdkTarGz(archive, ParallelGzipInputStreamTest.createContent(ParallelGzipInputStream.DEFAULT_CHECKPOINT_SPACING * 2));
+
+		  for (String extraction : new String[] {"first", "second"}) {
+				extractJreFromTarGz(archive, tempDir.resolve(extraction).resolve("jre"));
+				assertTrue(Files.exists(ParallelGzipInputStream.getIndexPath(archive)), "The archive should have been indexed by the first extraction");
+		  }
+	 }
+
+	 /**
+	  * Verifies that extracting a gzip compressed TAR with a corrupt index fails and deletes the index, even though the TAR reader stops before the end of the
+	  * decompressed data, and that the next extraction rebuilds the index.
+	  */
+	 @Test public void testExtractJreTarGzCorruptIndex (@TempDir Path tempDir) throws IOException, ArchiveException, CompressorException {
+		  // text refers back into the window of every checkpoint
+		  StringBuilder sources = new StringBuilder();
+		  for (int line = 0; sources.length() < ParallelGzipInputStream.DEFAULT_CHECKPOINT_SPACING * 2; line++) {
+				sources.append("line ").append(line).append(" of the JDK sources\n");
+		  }
+		  Path archive = tempDir.resolve("jdk.tar.gz");
+		  createJdkTarGz(archive, sources.toString().getBytes(StandardCharsets.UTF_8));
+		  Path indexPath = ParallelGzipInputStream.getIndexPath(archive);
+		  extractJreFromTarGz(archive, tempDir.resolve("first").resolve("jre"));
+		  assertTrue(Files.exists(indexPath), "The archive should have been indexed by the first extraction");
+
+		  ParallelGzipInputStreamTest.corruptIndexWindows(archive);
+		  assertThrows(IOException.class, () -> ArchiveUtils.extractJre(archive, tempDir.resolve("second").resolve("jre"), path -> false, true),
+			  "Extracting with a corrupt index should have failed");
+		  assertFalse(Files.exists(indexPath), "The corrupt index should have been deleted");
+
+		  extractJreFromTarGz(archive, tempDir.resolve("third").resolve("jre"));
+		  assertTrue(Files.exists(indexPath), "The archive should have been indexed again");
+	 }
+
+	 /**
+	  * Creates a gzip compressed TAR of a JDK whose last entry is large, so the archive is split into more than one chunk.
+	  */
+	 private void createJdkTarGz (Path archive, byte[] largeEntryContent) throws IOException, ArchiveException {
+		  try (OutputStream fileOutputStream = new GZIPOutputStream(new BufferedOutputStream(Files.newOutputStream(archive)));
+			  ArchiveOutputStream archiveOutputStream = new ArchiveStreamFactory().createArchiveOutputStream(ArchiveStreamFactory.TAR, fileOutputStream)) {
+				for (String entryName : new String[] {"jdk/bin/javac", "jdk/jre/bin/java", "jdk/jre/lib/server/libjvm.so", "jdk/jre/lib/rt.jar", "jdk/src.zip"}) {
+					 byte[] content = entryName.equals("jdk/src.zip") ? largeEntryContent : entryName.getBytes(StandardCharsets.UTF_8);
+					 TarArchiveEntry entry = new TarArchiveEntry(entryName);
+					 entry.setSize(content.length);
+					 archiveOutputStream.putArchiveEntry(entry);
+					 archiveOutputStream.write(content);
+					 archiveOutputStream.closeArchiveEntry();
+				}
+		  }
+	 }
+
+	 private void extractJreFromTarGz (Path archive, Path jreDirectory) throws IOException, ArchiveException, CompressorException {
+		  assertTrue(ArchiveUtils.extractJre(archive, jreDirectory, path -> false, true), "The JRE root should have been found in the archive");
+		  assertEquals("jdk/jre/lib/rt.jar", new String(Files.readAllBytes(jreDirectory.resolve("lib/rt.jar")), StandardCharsets.UTF_8),
+			  "Extracted file lib/rt.jar should have matched the archive entry");
+	 }
+
+	 /**
+	  * Creates an archive with a file entry for each name, in order, containing the entry name.
+	  */
+	 private void createArchiveOfEntryNames (ArchiveType archiveType, Path archive, String... entryNames) throws IOException, ArchiveException {
+		  try (OutputStream fileOutputStream = new BufferedOutputStream(Files.newOutputStream(archive));
+			  ArchiveOutputStream archiveOutputStream = new ArchiveStreamFactory()
+				  .createArchiveOutputStream(archiveType.getCommonsCompressName(), fileOutputStream)) {
+				for (String entryName : entryNames) {
+					 byte[] content = entryName.getBytes(StandardCharsets.UTF_8);
+					 if (archiveType == TAR) {
+						  TarArchiveEntry entry = new TarArchiveEntry(entryName);
+						  entry.setSize(content.length);
+						  archiveOutputStream.putArchiveEntry(entry);
+					 } else {
+						  ZipArchiveEntry entry = new ZipArchiveEntry(entryName);
+						  entry.setTime(System.currentTimeMillis());
+						  archiveOutputStream.putArchiveEntry(entry);
+					 }
+					 archiveOutputStream.write(content);
+					 archiveOutputStream.closeArchiveEntry();
+				}
+				archiveOutputStream.finish();
+		  }
+	 }
+
 	 private void assertPosixPermissions (Path path, PosixFilePermission... permissions) throws IOException {
 		  final PosixFileAttributeView fileAttributeView = Files
 			  .getFileAttributeView(path, PosixFileAttributeView.class, LinkOption.NOFOLLOW_LINKS);
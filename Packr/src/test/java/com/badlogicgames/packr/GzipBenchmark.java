@@ -0,0 +1,110 @@
+/*
+ * Copyright 2020 See AUTHORS file
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.badlogicgames.packr;
+
+import org.apache.commons.compress.compressors.gzip.GzipCompressorInputStream;
+
+import java.io.BufferedInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.util.Arrays;
+import java.util.Locale;
+import java.util.zip.Deflater;
+
+/**
+ * Compares decompressing a gzip file with commons-compress, as {@link ArchiveUtils} did before {@link ParallelGzipInputStream}, against building the
+ * index of {@link ParallelGzipInputStream} on the first read, and decompressing in parallel with the cached index.
+ * <p>
+ * Run with {@code ./gradlew :Packr:benchmarkGzip}, pass {@code -Pbenchmark.archive=<path to a .tar.gz JDK>} to benchmark a real JDK instead of generated
+ * data. Any existing index of the archive is deleted first.
+ */
+public class GzipBenchmark {
+	 public static void main (String[] args) throws IOException {
+		  final int iterations = args.length > 1 ? Integer.parseInt(args[1]) : 5;
+		  final Path gzipPath;
+		  if (args.length > 0 && !args[0].isEmpty()) {
+				gzipPath = Paths.get(args[0]);
+		  } else {
+				gzipPath = Files.createTempFile("packr-gzip-benchmark", ".gz");
+				gzipPath.toFile().deleteOnExit();
+				ParallelGzipInputStream.getIndexPath(gzipPath).toFile().deleteOnExit();
+				ParallelGzipInputStreamTest.writeGzip(gzipPath, ParallelGzipInputStreamTest.createContent(256 * 1024 * 1024), Deflater.DEFAULT_COMPRESSION,
+					 Deflater.DEFAULT_STRATEGY);
+		  }
+		  final Path indexPath = ParallelGzipInputStream.getIndexPath(gzipPath);
+		  System.out.println("Benchmarking " + gzipPath + " (" + Files.size(gzipPath) / 1024 / 1024 + " MiB) on " + Runtime.getRuntime().availableProcessors()
+			  + " processors, median of " + iterations + " iterations");
+
+		  final double[] commonsCompressTimes = new double[iterations];
+		  final double[] indexingTimes = new double[iterations];
+		  final double[] parallelTimes = new double[iterations];
+		  long decompressedSize = 0;
+		  for (int iteration = 0; iteration < iterations; iteration++) {
+				long start = System.nanoTime();
+				try (InputStream inputStream = new GzipCompressorInputStream(new BufferedInputStream(Files.newInputStream(gzipPath)), true)) {
+					 decompressedSize = consume(inputStream);
+				}
+				commonsCompressTimes[iteration] = (System.nanoTime() - start) / 1e9;
+
+				Files.deleteIfExists(indexPath);
+				start = System.nanoTime();
+				try (InputStream inputStream = ParallelGzipInputStream.open(gzipPath, true)) {
+					 checkSize(decompressedSize, consume(inputStream));
+				}
+				indexingTimes[iteration] = (System.nanoTime() - start) / 1e9;
+				if (!Files.exists(indexPath)) {
+					 throw new IllegalStateException(gzipPath + " wasn't indexed, it has to be a single gzip member of more than "
+						 + ParallelGzipInputStream.DEFAULT_CHECKPOINT_SPACING + " bytes decompressed");
+				}
+
+				start = System.nanoTime();
+				try (InputStream inputStream = ParallelGzipInputStream.open(gzipPath, false)) {
+					 checkSize(decompressedSize, consume(inputStream));
+				}
+				parallelTimes[iteration] = (System.nanoTime() - start) / 1e9;
+		  }
+
+		  report("commons-compress", decompressedSize, commonsCompressTimes);
+		  report("first read, building the index", decompressedSize, indexingTimes);
+		  report("parallel, with the cached index", decompressedSize, parallelTimes);
+		  Files.deleteIfExists(indexPath);
+	 }
+
+	 private static long consume (InputStream inputStream) throws IOException {
+		  final byte[] buffer = new byte[65536];
+		  long size = 0;
+		  for (int count; (count = inputStream.read(buffer)) != -1; ) {
+				size += count;
+		  }
+		  return size;
+	 }
+
+	 private static void checkSize (long expectedSize, long size) {
+		  if (size != expectedSize) {
+				throw new IllegalStateException("Decompressed " + size + " bytes instead of " + expectedSize);
+		  }
+	 }
+
+	 private static void report (String name, long decompressedSize, double[] times) {
+		  Arrays.sort(times);
+		  final double median = times[times.length / 2];
+		  System.out.println(String.format(Locale.ROOT, "%-32s %8.3f s %8.1f MiB/s", name, median, decompressedSize / median / 1024 / 1024));
+	 }
+}
@@ -19,13 +19,26 @@ package com.badlogicgames.packr;
 import org.junit.jupiter.api.Test;
 import org.junit.jupiter.api.io.TempDir;
 
+import java.io.ByteArrayOutputStream;
 import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
 import java.nio.charset.StandardCharsets;
 import java.nio.file.Files;
 import java.nio.file.Path;
+import java.util.Arrays;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
 import java.util.stream.Stream;
+import java.util.zip.ZipEntry;
+import java.util.zip.ZipFile;
+import java.util.zip.ZipOutputStream;
 
+import static org.junit.jupiter.api.Assertions.assertArrayEquals;
 import static org.junit.jupiter.api.Assertions.assertEquals;
+import static org.junit.jupiter.api.Assertions.assertFalse;
+import static org.junit.jupiter.api.Assertions.assertNotNull;
+import static org.junit.jupiter.api.Assertions.assertNull;
 import static org.junit.jupiter.api.Assertions.assertTrue;
 import static org.junit.jupiter.api.Assertions.fail;
 
@@ -80,4 +93,65 @@ class PackrTest {
 		  }
 		  fail("Should have thrown a not empty exception");
 	 }
+
+	 @Test void appendSingleFilePayload (@TempDir Path tempDirectoryPath) throws IOException {
+		  Path outputPath = tempDirectoryPath.resolve("output");
+		  Files.createDirectories(outputPath);
+		  byte[] executableBytes = "launcher".getBytes(StandardCharsets.UTF_8);
+		  Files.write(outputPath.resolve("myapp"), executableBytes);
+		  byte[] configBytes = "{ \"mainClass\": \"com.my.App\" }".getBytes(StandardCharsets.UTF_8);
+		  Files.write(outputPath.resolve("myapp.json"), configBytes);
+		  writeJar(outputPath.resolve("first.jar"), "META-INF/MANIFEST.MF", "first manifest", "com/my/App.class", "first", "META-INF/FIRST.SF", "signature");
+		  writeJar(outputPath.resolve("second.jar"), "META-INF/MANIFEST.MF", "second manifest", "com/my/App.class", "second", "com/my/Other.class", "other");
+
+		  PackrConfig config = new PackrConfig();
+		  config.executable = "myapp";
+		  config.classpath = Arrays.asList("libs/first.jar", "libs/second.jar");
+		  new Packr().appendSingleFilePayload(new PackrOutput(outputPath.toFile(), outputPath.toFile()), config);
+
+		  assertFalse(Files.exists(outputPath.resolve("myapp.json")));
+		  assertFalse(Files.exists(outputPath.resolve("first.jar")));
+		  assertFalse(Files.exists(outputPath.resolve("second.jar")));
+
+		  byte[] singleFileBytes = Files.readAllBytes(outputPath.resolve("myapp"));
+		  assertArrayEquals(executableBytes, Arrays.copyOf(singleFileBytes, executableBytes.length));
+		  String trailer = new String(singleFileBytes, singleFileBytes.length - 56, 56, StandardCharsets.US_ASCII);
+		  Matcher trailerMatcher = Pattern.compile("PACKR-PAYLOAD (\\d{20}) (\\d{20})\n").matcher(trailer);
+		  assertTrue(trailerMatcher.matches(), trailer);
+		  int configOffset = Integer.parseInt(trailerMatcher.group(1));
+		  int configLength = Integer.parseInt(trailerMatcher.group(2));
+		  assertEquals(executableBytes.length, configOffset);
+		  assertArrayEquals(configBytes, Arrays.copyOfRange(singleFileBytes, configOffset, configOffset + configLength));
+
+		  try (ZipFile zipFile = new ZipFile(outputPath.resolve("myapp").toFile())) {
+				assertEquals("first manifest", readEntry(zipFile, "META-INF/MANIFEST.MF"));
+				assertEquals("first", readEntry(zipFile, "com/my/App.class"));
+				assertEquals("other", readEntry(zipFile, "com/my/Other.class"));
+				assertNull(zipFile.getEntry("META-INF/FIRST.SF"));
+		  }
+	 }
+
+	 private static void writeJar (Path jarPath, String... namesAndContents) throws IOException {
+		  try (OutputStream outputStream = Files.newOutputStream(jarPath); ZipOutputStream zipOutputStream = new ZipOutputStream(outputStream)) {
+				for (int i = 0; i < namesAndContents.length; i += 2) {
+					 zipOutputStream.putNextEntry(new ZipEntry(namesAndContents[i]));
+					 zipOutputStream.write(namesAndContents[i + 1].getBytes(StandardCharsets.UTF_8));
+					 zipOutputStream.closeEntry();
+				}
+		  }
+	 }
+
+	 private static String readEntry (ZipFile zipFile, String name) throws IOException {
+		  ZipEntry entry = zipFile.getEntry(name);
+		  assertNotNull(entry, name);
+		  try (InputStream inputStream = zipFile.getInputStream(entry)) {
+				ByteArrayOutputStream content = new ByteArrayOutputStream();
+				byte[] buffer = new byte[1024];
+				int read;
+				while ((read = inputStream.read(buffer)) != -1) {
+					 content.write(buffer, 0, read);
+				}
+				return new String(content.toByteArray(), StandardCharsets.UTF_8);
+		  }
+	 }
 }
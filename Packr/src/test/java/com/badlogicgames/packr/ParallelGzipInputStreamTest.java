@@ -0,0 +1,238 @@
+/*
+ * Copyright 2020 See AUTHORS file
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.badlogicgames.packr;
+
+import org.apache.commons.compress.utils.IOUtils;
+import org.junit.jupiter.api.Test;
+import org.junit.jupiter.api.io.TempDir;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.attribute.FileTime;
+import java.util.Random;
+import java.util.zip.Deflater;
+import java.util.zip.GZIPInputStream;
+import java.util.zip.GZIPOutputStream;
+import java.util.zip.ZipException;
+
+import static org.junit.jupiter.api.Assertions.assertArrayEquals;
+import static org.junit.jupiter.api.Assertions.assertEquals;
+import static org.junit.jupiter.api.Assertions.assertFalse;
+import static org.junit.jupiter.api.Assertions.assertNotNull;
+import static org.junit.jupiter.api.Assertions.assertNull;
+import static org.junit.jupiter.api.Assertions.assertThrows;
+import static org.junit.jupiter.api.Assertions.assertTrue;
+
+/**
+ * Unit tests for {@link ParallelGzipInputStream} and {@link GzipInflater}.
+ */
+class ParallelGzipInputStreamTest {
+	 /**
+	  * Small enough to split the test data into many chunks.
+	  */
+	 private static final int CHECKPOINT_SPACING = 64 * 1024;
+
+	 /**
+	  * Decompresses files of every compression level and strategy, first building the index, then in parallel with the index.
+	  */
+	 @Test public void testIndexedDecompression (@TempDir Path tempDir) throws IOException {
+		  final byte[] content = createContent(3 * 1024 * 1024);
+		  final int[][] levelsAndStrategies = {{Deflater.NO_COMPRESSION, Deflater.DEFAULT_STRATEGY}, {Deflater.BEST_SPEED, Deflater.DEFAULT_STRATEGY},
+			  {Deflater.DEFAULT_COMPRESSION, Deflater.DEFAULT_STRATEGY}, {Deflater.BEST_COMPRESSION, Deflater.DEFAULT_STRATEGY},
+			  {Deflater.DEFAULT_COMPRESSION, Deflater.FILTERED}, {Deflater.DEFAULT_COMPRESSION, Deflater.HUFFMAN_ONLY}};
+		  for (int[] levelAndStrategy : levelsAndStrategies) {
+				final Path gzipPath = tempDir.resolve("content-" + levelAndStrategy[0] + "-" + levelAndStrategy[1] + ".gz");
+				writeGzip(gzipPath, content, levelAndStrategy[0], levelAndStrategy[1]);
+
+				assertArrayEquals(content, readGzip(gzipPath), "Decompressing while building the index should have matched the content");
+				assertTrue(Files.exists(ParallelGzipInputStream.getIndexPath(gzipPath)), "The index should have been written");
+				assertArrayEquals(content, readGzip(gzipPath), "Decompressing with the index should have matched the content");
+		  }
+	 }
+
+	 /**
+	  * Verifies that the index is written when the reader stops shortly before the end, like a tar reader after the end of archive entries.
+	  */
+	 @Test public void testIndexAfterClosingEarly (@TempDir Path tempDir) throws IOException {
+		  final byte[] content = createContent(1024 * 1024);
+		  final Path gzipPath = tempDir.resolve("content.gz");
+		  writeGzip(gzipPath, content, Deflater.DEFAULT_COMPRESSION, Deflater.DEFAULT_STRATEGY);
+
+		  try (InputStream inputStream = ParallelGzipInputStream.open(gzipPath, true, CHECKPOINT_SPACING)) {
+				assertNotNull(inputStream);
+				final byte[] start = new byte[content.length - 10000];
+				assertEquals(start.length, IOUtils.readFully(inputStream, start), "The start of the content should have been read");
+		  }
+		  assertTrue(Files.exists(ParallelGzipInputStream.getIndexPath(gzipPath)), "The index should have been written when closing");
+		  assertArrayEquals(content, readGzip(gzipPath), "Decompressing with the index should have matched the content");
+	 }
+
+	 /**
+	  * Decompresses concatenated gzip members, which aren't indexed.
+	  */
+	 @Test public void testConcatenatedMembers (@TempDir Path tempDir) throws IOException {
+		  final byte[] content = createContent(512 * 1024);
+		  final Path gzipPath = tempDir.resolve("content.gz");
+		  try (OutputStream outputStream = Files.newOutputStream(gzipPath)) {
+				outputStream.write(compress(content, 0, 200000, Deflater.DEFAULT_COMPRESSION, Deflater.DEFAULT_STRATEGY));
+				outputStream.write(compress(content, 200000, content.length - 200000, Deflater.BEST_SPEED, Deflater.DEFAULT_STRATEGY));
+		  }
+
+		  assertArrayEquals(content, readGzip(gzipPath), "Decompressing concatenated members should have matched the content");
+		  assertFalse(Files.exists(ParallelGzipInputStream.getIndexPath(gzipPath)), "Concatenated members shouldn't have been indexed");
+	 }
+
+	 /**
+	  * Verifies that an index that doesn't match the file is rebuilt, and that files are only indexed when asked to.
+	  */
+	 @Test public void testStaleIndex (@TempDir Path tempDir) throws IOException {
+		  final Path gzipPath = tempDir.resolve("content.gz");
+		  final Path indexPath = ParallelGzipInputStream.getIndexPath(gzipPath);
+		  writeGzip(gzipPath, createContent(1024 * 1024), Deflater.DEFAULT_COMPRESSION, Deflater.DEFAULT_STRATEGY);
+		  assertNull(ParallelGzipInputStream.open(gzipPath, false, CHECKPOINT_SPACING), "Without an index, the file should only be opened to index it");
+		  readGzip(gzipPath);
+
+		  final byte[] changedContent = createContent(1536 * 1024);
+		  changedContent[0] = 'x';
+		  writeGzip(gzipPath, changedContent, Deflater.BEST_SPEED, Deflater.DEFAULT_STRATEGY);
+		  Files.setLastModifiedTime(gzipPath, FileTime.fromMillis(1600000000000L));
+		  assertArrayEquals(changedContent, readGzip(gzipPath), "The index of the previous file shouldn't have been used");
+		  assertArrayEquals(changedContent, readGzip(gzipPath), "Decompressing with the rebuilt index should have matched the content");
+
+		  Files.write(indexPath, "not an index".getBytes(StandardCharsets.UTF_8));
+		  assertArrayEquals(changedContent, readGzip(gzipPath), "The corrupt index should have been ignored");
+		  assertArrayEquals(changedContent, readGzip(gzipPath), "Decompressing with the rebuilt index should have matched the content");
+	 }
+
+	 /**
+	  * Verifies that decoding with wrong windows in the index fails and deletes the index, both when reading to the end and when closing within the last chunk.
+	  */
+	 @Test public void testCorruptIndexWindow (@TempDir Path tempDir) throws IOException {
+		  final byte[] content = createContent(1024 * 1024);
+		  final Path gzipPath = tempDir.resolve("content.gz");
+		  final Path indexPath = ParallelGzipInputStream.getIndexPath(gzipPath);
+		  writeGzip(gzipPath, content, Deflater.DEFAULT_COMPRESSION, Deflater.DEFAULT_STRATEGY);
+		  readGzip(gzipPath);
+
+		  corruptIndexWindows(gzipPath);
+		  assertThrows(ZipException.class, () -> readGzip(gzipPath), "Reading with a corrupt index should have failed");
+		  assertFalse(Files.exists(indexPath), "The corrupt index should have been deleted after reading");
+
+		  assertArrayEquals(content, readGzip(gzipPath), "Decompressing while rebuilding the index should have matched the content");
+		  corruptIndexWindows(gzipPath);
+		  final InputStream inputStream = ParallelGzipInputStream.open(gzipPath, false, CHECKPOINT_SPACING);
+		  assertNotNull(inputStream, "The gzip file should have been opened with its index");
+		  final byte[] start = new byte[content.length - 1000];
+		  assertEquals(start.length, IOUtils.readFully(inputStream, start), "The start of the content should have been read");
+		  assertThrows(ZipException.class, inputStream::close, "Closing within the last chunk with a corrupt index should have failed");
+		  assertFalse(Files.exists(indexPath), "The corrupt index should have been deleted when closing");
+	 }
+
+	 /**
+	  * Flips the bits of the windows of all checkpoints but the first in the index of a gzip file, which doesn't change the structure of the deflate data
+	  * decoded from them.
+	  */
+	 static void corruptIndexWindows (Path gzipPath) throws IOException {
+		  final Path indexPath = ParallelGzipInputStream.getIndexPath(gzipPath);
+		  final byte[] index;
+		  try (InputStream indexInputStream = new GZIPInputStream(Files.newInputStream(indexPath))) {
+				index = IOUtils.toByteArray(indexInputStream);
+		  }
+		  // a 40 byte header ending with the checkpoint count, then the bit offset, decompressed offset, and window of each checkpoint
+		  final int checkpointCount = ByteBuffer.wrap(index, 36, 4).getInt();
+		  assertTrue(checkpointCount > 1, "The index should have had more than one checkpoint");
+		  for (int checkpoint = 1; checkpoint < checkpointCount; checkpoint++) {
+				final int windowOffset = 40 + checkpoint * (16 + GzipInflater.WINDOW_SIZE) + 16;
+				for (int offset = windowOffset; offset < windowOffset + GzipInflater.WINDOW_SIZE; offset++) {
+					 index[offset] ^= 0xff;
+				}
+		  }
+		  try (OutputStream indexOutputStream = new GZIPOutputStream(Files.newOutputStream(indexPath))) {
+				indexOutputStream.write(index);
+		  }
+	 }
+
+	 /**
+	  * Creates text, random, and repeated data, which deflate stores, compresses with fixed or dynamic Huffman codes, and refers back to over the whole
+	  * window.
+	  */
+	 static byte[] createContent (int length) {
+		  final Random random = new Random(length);
+		  final byte[] content = new byte[length];
+		  int position = 0;
+		  int line = 0;
+		  while (position < length) {
+				switch (random.nextInt(4)) {
+				case 0:
+					 for (int lines = random.nextInt(2000); lines > 0 && position < length; lines--) {
+						  final byte[] text = ("line " + line++ + " of the test content " + random.nextInt(1000) + "\n").getBytes(StandardCharsets.UTF_8);
+						  final int count = Math.min(text.length, length - position);
+						  System.arraycopy(text, 0, content, position, count);
+						  position += count;
+					 }
+					 break;
+				case 1:
+					 final byte[] randomBytes = new byte[Math.min(random.nextInt(100000), length - position)];
+					 random.nextBytes(randomBytes);
+					 System.arraycopy(randomBytes, 0, content, position, randomBytes.length);
+					 position += randomBytes.length;
+					 break;
+				case 2:
+					 // zeros
+					 position += Math.min(random.nextInt(300000), length - position);
+					 break;
+				default:
+					 final int from = Math.max(0, position - 1 - random.nextInt(GzipInflater.WINDOW_SIZE));
+					 final int count = Math.min(Math.min(position - from, random.nextInt(50000)), length - position);
+					 System.arraycopy(content, from, content, position, count);
+					 position += count;
+					 break;
+				}
+		  }
+		  return content;
+	 }
+
+	 static void writeGzip (Path gzipPath, byte[] content, int level, int strategy) throws IOException {
+		  Files.write(gzipPath, compress(content, 0, content.length, level, strategy));
+	 }
+
+	 private static byte[] compress (byte[] content, int offset, int length, int level, int strategy) throws IOException {
+		  final ByteArrayOutputStream compressed = new ByteArrayOutputStream();
+		  try (GZIPOutputStream gzipOutputStream = new GZIPOutputStream(compressed) {
+				{
+					 def.setLevel(level);
+					 def.setStrategy(strategy);
+				}
+		  }) {
+				gzipOutputStream.write(content, offset, length);
+		  }
+		  return compressed.toByteArray();
+	 }
+
+	 private static byte[] readGzip (Path gzipPath) throws IOException {
+		  try (InputStream inputStream = ParallelGzipInputStream.open(gzipPath, true, CHECKPOINT_SPACING)) {
+				assertNotNull(inputStream, "The gzip file should have been opened");
+				return IOUtils.toByteArray(inputStream);
+		  }
+	 }
+}
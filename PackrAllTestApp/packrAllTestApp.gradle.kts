@@ -28,6 +28,8 @@ import java.nio.file.Path
 import java.nio.file.Paths
 import java.nio.file.SimpleFileVisitor
 import java.nio.file.attribute.BasicFileAttributes
+import java.time.Instant
+import java.time.temporal.ChronoUnit
 import java.util.*
 import java.util.concurrent.CopyOnWriteArrayList
 
@@ -236,6 +238,240 @@ tasks.named("check") {
    dependsOn(createTestDirectory)
 }
 
+/**
+ * Number of times each bundle is launched per mode by [benchmarkLaunchLatency]
+ */
+val benchmarkIterations: Int = (findProperty("benchmark.iterations") as String?)?.toInt() ?: 20
+
+/**
+ * Allowed slowdown relative to the stored baseline before [benchmarkLaunchLatency] fails, 0.25 means 25% slower
+ */
+val benchmarkTolerance: Double = (findProperty("benchmark.tolerance") as String?)?.toDouble() ?: 0.25
+
+/**
+ * Stored launch latency baseline that [benchmarkLaunchLatency] compares against
+ */
+val benchmarkBaselineFile: File = file(findProperty("benchmark.baseline") as String? ?: "launch-latency-baseline.properties")
+
+/**
+ * Launches every Linux bundle created by [createTestDirectory] repeatedly, with a warm and a cold page cache, and reports time-to-main and time-to-exit
+ * percentiles per JDK. Results are compared against [benchmarkBaselineFile], pass `-Pbenchmark.updateBaseline=true` to store the current results as the
+ * new baseline.
+ */
+val benchmarkLaunchLatency: TaskProvider<Task> = tasks.register("benchmarkLaunchLatency") {
+   dependsOn(createTestDirectory)
+   onlyIf { isFamily(FAMILY_UNIX) && !isFamily(FAMILY_MAC) }
+
+   val reportFile = buildDir.toPath().resolve("reports").resolve("launch-latency").resolve("report.txt")
+   outputs.upToDateWhen { false }
+
+   doLast {
+      val results = Properties()
+      val report = StringBuilder()
+      Files.list(buildDir.toPath().resolve("testApp")).use { bundleStream ->
+         bundleStream.filter { Files.isDirectory(it) && it.fileName.toString().contains("linux") }.sorted().forEach { bundleDirectory ->
+            val jdkName = bundleDirectory.fileName.toString().removeSuffix("Ä")
+            for (cold in listOf(false, true)) {
+               val mode = if (cold) "cold" else "warm"
+               val timesToMain = mutableListOf<Double>()
+               val timesToExit = mutableListOf<Double>()
+               // the first warm launch only populates the page cache
+               if (!cold) {
+                  launchAndMeasureBundle(bundleDirectory)
+               }
+               for (iteration in 1..benchmarkIterations) {
+                  if (cold) {
+                     dropBundleFromPageCache(bundleDirectory)
+                  }
+                  val (timeToMain, timeToExit) = launchAndMeasureBundle(bundleDirectory)
+                  timesToMain.add(timeToMain)
+                  timesToExit.add(timeToExit)
+               }
+               for ((metric, times) in listOf("timeToMain" to timesToMain, "timeToExit" to timesToExit)) {
+                  for (percentile in listOf(50, 90, 99)) {
+                     results.setProperty("$jdkName.$mode.$metric.p$percentile", String.format(Locale.ROOT, "%.1f", percentile(times, percentile)))
+                  }
+                  report.append(String.format(Locale.ROOT,
+                        "%-40s %-5s %-11s p50=%8.1f ms p90=%8.1f ms p99=%8.1f ms%n",
+                        jdkName,
+                        mode,
+                        metric,
+                        percentile(times, 50),
+                        percentile(times, 90),
+                        percentile(times, 99)))
+               }
+            }
+         }
+      }
+      logger.lifecycle("Launch latency over $benchmarkIterations launches:\n$report")
+      Files.createDirectories(reportFile.parent)
+      Files.write(reportFile, report.toString().toByteArray(Charsets.UTF_8))
+
+      if (findProperty("benchmark.updateBaseline")?.toString()?.toBoolean() == true) {
+         benchmarkBaselineFile.outputStream().use { results.store(it, "packr launch latency baseline in milliseconds") }
+         logger.lifecycle("Stored launch latency baseline in $benchmarkBaselineFile")
+         return@doLast
+      }
+      if (!benchmarkBaselineFile.exists()) {
+         logger.warn("No launch latency baseline $benchmarkBaselineFile, run with -Pbenchmark.updateBaseline=true to create one")
+         return@doLast
+      }
+
+      val baseline = Properties()
+      benchmarkBaselineFile.inputStream().use { baseline.load(it) }
+      val regressions = mutableListOf<String>()
+      for (key in baseline.stringPropertyNames().sorted()) {
+         // p99 is too noisy with a few dozen launches to fail the build on
+         if (key.endsWith(".p99")) continue
+         val current = results.getProperty(key)?.toDouble() ?: continue
+         val expected = baseline.getProperty(key).toDouble()
+         if (current > expected * (1.0 + benchmarkTolerance)) {
+            regressions.add(String.format(Locale.ROOT, "%s: %.1f ms, baseline %.1f ms", key, current, expected))
+         }
+      }
+      if (regressions.isNotEmpty()) {
+         throw GradleException("Launch latency regressed by more than ${(benchmarkTolerance * 100).toInt()}%:\n${regressions.joinToString("\n")}")
+      }
+   }
+}
+
+/**
+ * Launches the packr bundle in [bundleDirectory] with startup tracing enabled.
+ * @return the milliseconds from spawning the process until the Java main method was invoked, and until the process exited
+ */
+fun launchAndMeasureBundle(bundleDirectory: Path): Pair<Double, Double> {
+   val processBuilder = ProcessBuilder(bundleDirectory.resolve("PackrAllTestAppÄ").toAbsolutePath().toString(), "-c", "--trace", "--")
+   processBuilder.directory(bundleDirectory.toFile())
+   processBuilder.environment()["PATH"] = ""
+   processBuilder.environment()["LD_LIBRARY_PATH"] = ""
+   processBuilder.redirectError(File("/dev/null"))
+
+   val spawnEpochMicros = ChronoUnit.MICROS.between(Instant.EPOCH, Instant.now())
+   val spawnNanos = System.nanoTime()
+   val process = processBuilder.start()
+   val output = process.inputStream.readBytes().toString(Charsets.UTF_8)
+   process.waitFor()
+   val timeToExit = (System.nanoTime() - spawnNanos) / 1_000_000.0
+
+   // packr-trace <phase> <microseconds since launcher start> <microseconds since epoch>
+   val mainInvokedLine = output.lineSequence().firstOrNull { it.startsWith("packr-trace main-invoked ") }
+         ?: throw GradleException("Packr bundle in $bundleDirectory didn't print a main-invoked trace marker, output:\n$output")
+   val timeToMain = (mainInvokedLine.split(' ')[3].toLong() - spawnEpochMicros) / 1000.0
+   return Pair(timeToMain, timeToExit)
+}
+
+/**
+ * Drops every file in [bundleDirectory] from the page cache. GNU dd with `iflag=nocache count=0` calls `posix_fadvise(POSIX_FADV_DONTNEED)` for the whole
+ * file.
+ */
+fun dropBundleFromPageCache(bundleDirectory: Path) {
+   exec {
+      commandLine("find", bundleDirectory.toAbsolutePath().toString(), "-type", "f", "-exec", "dd", "if={}", "iflag=nocache", "count=0", "status=none", ";")
+   }
+}
+
+/**
+ * Nearest rank percentile of [values].
+ */
+fun percentile(values: List<Double>, percentile: Int): Double {
+   val sorted = values.sorted()
+   val rank = Math.ceil(percentile / 100.0 * sorted.size).toInt().coerceIn(1, sorted.size)
+   return sorted[rank - 1]
+}
+
+/**
+ * Launches every Linux bundle created by [createTestDirectory] under `perf stat`, with and without the launcher's `--hugePageJvmText` option, and reports
+ * the median instruction TLB loads and misses per JDK. The task is skipped with a warning if `perf` isn't installed or the CPU doesn't count iTLB events.
+ */
+val benchmarkHugePageJvmText: TaskProvider<Task> = tasks.register("benchmarkHugePageJvmText") {
+   dependsOn(createTestDirectory)
+   onlyIf { isFamily(FAMILY_UNIX) && !isFamily(FAMILY_MAC) }
+
+   val reportFile = buildDir.toPath().resolve("reports").resolve("huge-page-jvm-text").resolve("report.txt")
+   outputs.upToDateWhen { false }
+
+   doLast {
+      val report = StringBuilder()
+      var countsInstructionTlbEvents = true
+      Files.list(buildDir.toPath().resolve("testApp")).use { bundleStream ->
+         bundleStream.filter { Files.isDirectory(it) && it.fileName.toString().contains("linux") }.sorted().forEach { bundleDirectory ->
+            val jdkName = bundleDirectory.fileName.toString().removeSuffix("Ä")
+            for (hugePages in listOf(false, true)) {
+               if (!countsInstructionTlbEvents) break
+               val loads = mutableListOf<Double>()
+               val misses = mutableListOf<Double>()
+               for (iteration in 1..benchmarkIterations) {
+                  val counts = countInstructionTlbEvents(bundleDirectory, hugePages)
+                  if (counts == null) {
+                     countsInstructionTlbEvents = false
+                     break
+                  }
+                  loads.add(counts.first)
+                  misses.add(counts.second)
+               }
+               if (!countsInstructionTlbEvents) break
+               val medianLoads = percentile(loads, 50)
+               val medianMisses = percentile(misses, 50)
+               report.append(String.format(Locale.ROOT,
+                     "%-40s %-16s iTLB-loads=%12.0f iTLB-load-misses=%10.0f miss rate=%6.3f%%%n",
+                     jdkName,
+                     if (hugePages) "hugePageJvmText" else "regular pages",
+                     medianLoads,
+                     medianMisses,
+                     if (medianLoads > 0) medianMisses / medianLoads * 100.0 else 0.0))
+            }
+         }
+      }
+      if (!countsInstructionTlbEvents) {
+         logger.warn("perf stat can't count iTLB-loads and iTLB-load-misses on this machine, skipping the benchmark")
+         return@doLast
+      }
+      logger.lifecycle("Median instruction TLB events over $benchmarkIterations launches:\n$report")
+      Files.createDirectories(reportFile.parent)
+      Files.write(reportFile, report.toString().toByteArray(Charsets.UTF_8))
+   }
+}
+
+/**
+ * Launches the packr bundle in [bundleDirectory] under `perf stat`.
+ * @return the iTLB-loads and iTLB-load-misses of the process and its threads, or null if perf isn't installed or can't count them
+ */
+fun countInstructionTlbEvents(bundleDirectory: Path, hugePageJvmText: Boolean): Pair<Double, Double>? {
+   val command = mutableListOf("perf", "stat", "-x", ",", "-e", "iTLB-loads,iTLB-load-misses", "--",
+         bundleDirectory.resolve("PackrAllTestAppÄ").toAbsolutePath().toString(), "-c")
+   if (hugePageJvmText) {
+      command.add("--hugePageJvmText")
+   }
+   command.add("--")
+   val processBuilder = ProcessBuilder(command)
+   processBuilder.directory(bundleDirectory.toFile())
+   processBuilder.environment()["PATH"] = System.getenv("PATH") ?: ""
+   processBuilder.environment()["LD_LIBRARY_PATH"] = ""
+   processBuilder.redirectOutput(File("/dev/null"))
+
+   val process = try {
+      processBuilder.start()
+   } catch (exception: java.io.IOException) {
+      return null
+   }
+   // perf stat -x prints "<count>,<unit>,<event>,..." per event to stderr after the launcher's own error output
+   val output = process.errorStream.readBytes().toString(Charsets.UTF_8)
+   process.waitFor()
+
+   var loads: Double? = null
+   var misses: Double? = null
+   for (line in output.lines()) {
+      val fields = line.split(',')
+      if (fields.size < 3) continue
+      val count = fields[0].toDoubleOrNull() ?: continue
+      when {
+         fields[2].contains("iTLB-load-misses") -> misses = (misses ?: 0.0) + count
+         fields[2].contains("iTLB-loads") -> loads = (loads ?: 0.0) + count
+      }
+   }
+   return if (loads != null && misses != null) Pair(loads, misses) else null
+}
+
 /**
  * Gradle property specifying where the JDK archives directory is
  */
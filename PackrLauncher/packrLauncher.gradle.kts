@@ -20,6 +20,7 @@ import com.libgdx.gradle.isSnapshot
 import com.libgdx.gradle.packrPublishRepositories
 import org.gradle.internal.jvm.Jvm
 import java.nio.file.Path
+import java.util.Locale
 
 group = rootProject.group
 version = rootProject.version
@@ -69,6 +70,16 @@ val macOsLipo = tasks.register<Exec>("macOsLipo") {
    args(macOsLipoOutputFilePath.fileName.toString())
 }
 
+/**
+ * Largest allowed size in bytes of the minimal Linux launcher, checked by the checkMinimal tasks
+ */
+val minimalLauncherSizeBudget: Long = (findProperty("minimalLauncher.sizeBudget") as String?)?.toLong() ?: 1024L * 1024L
+
+/**
+ * Largest allowed median milliseconds from spawning the minimal Linux launcher until `--version` returned, checked by the checkMinimal tasks
+ */
+val minimalLauncherStartBudgetMs: Double = (findProperty("minimalLauncher.startBudgetMs") as String?)?.toDouble() ?: 5.0
+
 /**
  * Configuration for holding the release executables that are built
  */
@@ -133,6 +144,8 @@ application {
 
       //
       binaryCompileTask.macros["PACKR_VERSION_STRING"] = "\"" + (project.version as String) + "\""
+      // configuration files are small, 32 bit structure offsets halve the memory sajson allocates for parsing them
+      binaryCompileTask.macros["SAJSON_32BIT_OFFSETS"] = null
 
       // Create a single special publication from lipo on MacOS since that allows combining multiple architectures into a single binary
       val publicationName =
@@ -207,6 +220,7 @@ application {
          binaryLinkTask.linkerArgs.add("/SUBSYSTEM:WINDOWS")
          binaryLinkTask.linkerArgs.add("User32.lib")
          binaryLinkTask.linkerArgs.add("Shell32.lib")
+         binaryLinkTask.linkerArgs.add("Psapi.lib")
 
          if (binaryCompileTask.isOptimized) {
             binaryCompileTask.compilerArgs.add("/Os")
@@ -244,6 +258,13 @@ application {
          binaryLinkTask.linkerArgs.add("-ldl")
          binaryLinkTask.linkerArgs.add("-no-pie")
          binaryLinkTask.linkerArgs.add("-fno-pie")
+
+         if (binaryCompileTask.isOptimized && targetMachine.operatingSystemFamily.isLinux) {
+            // lets the minimal variant drop unused functions and data, the regular executable links the same objects
+            binaryCompileTask.compilerArgs.add("-ffunction-sections")
+            binaryCompileTask.compilerArgs.add("-fdata-sections")
+            registerMinimalLauncher(this, binaryLinkTask, publicationName)
+         }
       } else if (binaryToolChain is Clang) {
          binaryCompileTask.compilerArgs.add("-fPIC")
          binaryCompileTask.compilerArgs.add("-c")
@@ -293,6 +314,7 @@ unitTest {
    binaries.configureEach(CppTestExecutable::class.java) {
       val binaryCompileTask = compileTask.get()
       val binaryLinkTask = linkTask.get()
+      binaryCompileTask.macros["SAJSON_32BIT_OFFSETS"] = null
       when (toolChain) {
          is Gcc -> {
             binaryCompileTask.compilerArgs.add("-std=c++14")
@@ -317,6 +339,7 @@ unitTest {
 
             binaryLinkTask.linkerArgs.add("/SUBSYSTEM:CONSOLE")
             binaryLinkTask.linkerArgs.add("Shell32.lib")
+            binaryLinkTask.linkerArgs.add("Psapi.lib")
          }
       }
 
@@ -434,6 +457,82 @@ afterEvaluate {
    }
 }
 
+/**
+ * Registers a task linking the objects of [executable] into a minimal variant that doesn't load libstdc++.so at startup, and a check task asserting the
+ * variant stays within [minimalLauncherSizeBudget] and [minimalLauncherStartBudgetMs]. Linking the C++ runtime statically avoids resolving and
+ * relocating its symbols on every start, unused sections and the symbol table are removed to keep the executable small.
+ */
+fun registerMinimalLauncher(executable: CppExecutable, binaryLinkTask: LinkExecutable, publicationName: String) {
+   val minimalExecutableFile = distributionDirectoryPath.resolve("$publicationName-minimal").toFile()
+   val linkMinimal = tasks.register<LinkExecutable>("linkMinimal${executable.name.capitalize()}") {
+      toolChain.set(binaryLinkTask.toolChain)
+      targetPlatform.set(binaryLinkTask.targetPlatform)
+      source.from(binaryLinkTask.source)
+      libs.from(binaryLinkTask.libs)
+      linkedFile.set(minimalExecutableFile)
+      debuggable.set(false)
+      linkerArgs.addAll(binaryLinkTask.linkerArgs)
+      linkerArgs.addAll("-static-libstdc++", "-static-libgcc", "-Wl,--gc-sections", "-Wl,-O1", "-s")
+   }
+
+   val checkMinimal = tasks.register("checkMinimal${executable.name.capitalize()}") {
+      dependsOn(linkMinimal, binaryLinkTask)
+      outputs.upToDateWhen { false }
+
+      doLast {
+         val size = minimalExecutableFile.length()
+         logger.lifecycle("Minimal launcher $minimalExecutableFile is $size bytes, the budget is $minimalLauncherSizeBudget bytes")
+         if (size > minimalLauncherSizeBudget) {
+            throw GradleException("Minimal launcher $minimalExecutableFile is $size bytes, more than the budget of $minimalLauncherSizeBudget bytes")
+         }
+
+         val minimalStartMs = measureMedianStartMs(minimalExecutableFile)
+         val regularStartMs = measureMedianStartMs(binaryLinkTask.linkedFile.get().asFile)
+         logger.lifecycle(String.format(Locale.ROOT,
+               "Median start of --version: minimal launcher %.2f ms, regular launcher %.2f ms, the budget is %.2f ms",
+               minimalStartMs,
+               regularStartMs,
+               minimalLauncherStartBudgetMs))
+         if (minimalStartMs > minimalLauncherStartBudgetMs) {
+            throw GradleException(String.format(Locale.ROOT,
+                  "Minimal launcher took %.2f ms to start, more than the budget of %.2f ms",
+                  minimalStartMs,
+                  minimalLauncherStartBudgetMs))
+         }
+      }
+   }
+
+   tasks.named("check") {
+      dependsOn(checkMinimal)
+   }
+}
+
+/**
+ * Median milliseconds from spawning [executableFile] with `-c --version`, which returns right after parsing the command line, until it exited.
+ * The launchers exit with EXIT_FAILURE after showing the version, like after showing the help, so only other exit values are errors.
+ */
+fun measureMedianStartMs(executableFile: File): Double {
+   val versionExitValue = 1
+   val times = mutableListOf<Double>()
+   // the first launches only populate the page cache
+   for (iteration in 1..105) {
+      val processBuilder = ProcessBuilder(executableFile.absolutePath, "-c", "--version")
+      processBuilder.redirectOutput(File("/dev/null"))
+      processBuilder.redirectError(File("/dev/null"))
+      val spawnNanos = System.nanoTime()
+      val exitValue = processBuilder.start().waitFor()
+      val time = (System.nanoTime() - spawnNanos) / 1_000_000.0
+      if (exitValue != versionExitValue) {
+         throw GradleException("$executableFile -c --version exited with $exitValue instead of $versionExitValue")
+      }
+      if (iteration > 5) {
+         times.add(time)
+      }
+   }
+   times.sort()
+   return times[times.size / 2]
+}
+
 /**
  * Adds JVM include header paths to [binaryCompileTask].
  */
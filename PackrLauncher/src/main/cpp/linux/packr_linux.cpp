@@ -17,13 +17,34 @@
 
 #include <packr.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <fstream>
 #include <iostream>
 #include <limits.h>
+#include <link.h>
+#include <malloc.h>
+#include <mutex>
+#include <sched.h>
+#include <semaphore.h>
+#include <set>
+#include <signal.h>
+#include <sstream>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <thread>
+#include <time.h>
 #include <unistd.h>
 
 using namespace std;
@@ -41,26 +62,28 @@ int main(int argc, char** argv) {
     return 0;
 }
 
-bool loadJNIFunctions(const dropt_char* jrePath, GetDefaultJavaVMInitArgs* getDefaultJavaVMInitArgs, CreateJavaVM* createJavaVM) {
+bool loadJNIFunctions(const dropt_char* jrePath, const char* vmType, GetDefaultJavaVMInitArgs* getDefaultJavaVMInitArgs, CreateJavaVM* createJavaVM) {
 
-    void* handle;
+    void* handle = nullptr;
     struct stat buffer;
     std::string jrePathString(jrePath);
+    std::string vmTypeString(vmType);
 
-    if (handle == NULL && stat((jrePathString + "/lib/server/libjvm.so").c_str(), &buffer) == 0) {
-        handle = dlopen((jrePathString + "/lib/server/libjvm.so").c_str(), RTLD_LAZY);
+    if (handle == NULL && stat((jrePathString + "/lib/" + vmTypeString + "/libjvm.so").c_str(), &buffer) == 0) {
+        handle = dlopen((jrePathString + "/lib/" + vmTypeString + "/libjvm.so").c_str(), RTLD_LAZY);
     }
 
-    if (handle == NULL && stat((jrePathString + "/lib/amd64/server/libjvm.so").c_str(), &buffer) == 0) {
-        handle = dlopen((jrePathString + "/lib/amd64/server/libjvm.so").c_str(), RTLD_LAZY);
+    if (handle == NULL && stat((jrePathString + "/lib/amd64/" + vmTypeString + "/libjvm.so").c_str(), &buffer) == 0) {
+        handle = dlopen((jrePathString + "/lib/amd64/" + vmTypeString + "/libjvm.so").c_str(), RTLD_LAZY);
     }
 
-    if (handle == NULL && stat((jrePathString + "/lib/i386/server/libjvm.so").c_str(), &buffer) == 0) {
-        handle = dlopen((jrePathString + "/lib/i386/server/libjvm.so").c_str(), RTLD_LAZY);
+    if (handle == NULL && stat((jrePathString + "/lib/i386/" + vmTypeString + "/libjvm.so").c_str(), &buffer) == 0) {
+        handle = dlopen((jrePathString + "/lib/i386/" + vmTypeString + "/libjvm.so").c_str(), RTLD_LAZY);
     }
 
     if (handle == NULL) {
-        cerr << dlerror() << endl;
+        const char* error = dlerror();
+        cerr << (error != nullptr ? error : "No " + vmTypeString + " libjvm.so found in " + jrePathString) << endl;
         return false;
     }
 
@@ -91,8 +114,686 @@ bool changeWorkingDir(const dropt_char* directory) {
 	return chdir(directory) == 0;
 }
 
+bool createDirectory(const dropt_char* directory) {
+    return mkdir(directory, 0755) == 0 || errno == EEXIST;
+}
+
+unsigned long getProcessId() {
+    return (unsigned long) getpid();
+}
+
+bool mapFile(const dropt_char* path, bool copyOnWrite, MappedFile* mapping) {
+    int descriptor = open(path, O_RDONLY | O_CLOEXEC);
+    if (descriptor == -1) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close(descriptor);
+        return false;
+    }
+    // a private mapping never writes back to the file
+    void* data = mmap(nullptr, status.st_size, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    mapping->data = (char*) data;
+    mapping->length = status.st_size;
+    return true;
+}
+
+void unmapFile(MappedFile* mapping) {
+    if (mapping->data != nullptr) {
+        munmap(mapping->data, mapping->length);
+    }
+    mapping->data = nullptr;
+    mapping->length = 0;
+}
+
 bool isZgcSupported() {
     return true;
 }
 
+unsigned long long getPhysicalMemorySize() {
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages < 0 || pageSize < 0) {
+        return 0;
+    }
+    return (unsigned long long) pages * (unsigned long long) pageSize;
+}
+
+bool hasCpuFeature(const char* feature) {
+    // x86 lists the features in the "flags" line and ARM in the "Features" line of /proc/cpuinfo, the first processor is representative
+    static set<string> features;
+    static bool featuresRead = false;
+    if (!featuresRead) {
+        featuresRead = true;
+        ifstream cpuInfo("/proc/cpuinfo");
+        string line;
+        while (getline(cpuInfo, line)) {
+            if (line.compare(0, 5, "flags") != 0 && line.compare(0, 8, "Features") != 0) {
+                continue;
+            }
+            size_t colon = line.find(':');
+            if (colon == string::npos) {
+                continue;
+            }
+            istringstream tokens(line.substr(colon + 1));
+            string token;
+            while (tokens >> token) {
+                features.insert(token);
+            }
+            break;
+        }
+    }
+    string lowerCaseFeature(feature);
+    transform(lowerCaseFeature.begin(), lowerCaseFeature.end(), lowerCaseFeature.begin(), ::tolower);
+    return features.count(lowerCaseFeature) != 0;
+}
+
+/**
+ * Process ids of the supervised children, read by the signal handler to forward termination requests.
+ */
+static volatile pid_t supervisedActivePid = -1;
+static volatile pid_t supervisedStandbyPid = -1;
+static volatile sig_atomic_t supervisorShutdownRequested = 0;
+
+static void forwardTerminationSignal(int signalNumber) {
+    supervisorShutdownRequested = 1;
+    if (supervisedActivePid > 0) {
+        kill(supervisedActivePid, signalNumber);
+    }
+    if (supervisedStandbyPid > 0) {
+        kill(supervisedStandbyPid, signalNumber);
+    }
+}
+
+static string describeExitStatus(int status) {
+    if (WIFSIGNALED(status)) {
+        return "was killed by signal " + to_string(WTERMSIG(status));
+    }
+    return "exited with status " + to_string(WEXITSTATUS(status));
+}
+
+/**
+ * Forks a child process that runs {@code child} and exits.
+ *
+ * @param releaseDescriptor read end of the pipe the child parks on before invoking the Java main method, or -1 to not park
+ * @param supervisorDescriptor descriptor held by the supervisor that the child must close, or -1
+ * @return the child process id, or -1 if forking failed
+ */
+static pid_t forkSupervisedChild(const SupervisedChildDelegate& child, int releaseDescriptor, int supervisorDescriptor) {
+    cout.flush();
+    cerr.flush();
+    fflush(nullptr);
+
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    if (supervisorDescriptor >= 0) {
+        close(supervisorDescriptor);
+    }
+
+    child([releaseDescriptor]() {
+        if (releaseDescriptor < 0) {
+            return true;
+        }
+        // the supervisor writes a byte to release this process, or the pipe is closed if this standby isn't needed anymore
+        char released = 0;
+        ssize_t count;
+        do {
+            count = read(releaseDescriptor, &released, 1);
+        } while (count == -1 && errno == EINTR);
+        close(releaseDescriptor);
+        return count == 1;
+    });
+    exit(EXIT_SUCCESS);
+}
+
+bool superviseChildProcesses(const SupervisedChildDelegate& child, bool useStandby, int* exitCode) {
+    // delay before replacing a crashed process, doubled on every crash and reset once a process ran for stableRunTime
+    const chrono::milliseconds minimumRestartDelay(250);
+    const chrono::milliseconds maximumRestartDelay(30000);
+    const chrono::seconds stableRunTime(60);
+    // how often pending restarts are checked while children are running
+    const chrono::milliseconds pollInterval(10);
+
+    struct sigaction forwardAction = {};
+    forwardAction.sa_handler = forwardTerminationSignal;
+    sigemptyset(&forwardAction.sa_mask);
+    sigaction(SIGTERM, &forwardAction, nullptr);
+    sigaction(SIGHUP, &forwardAction, nullptr);
+    // releasing a standby that died but wasn't reaped yet must not kill the supervisor
+    signal(SIGPIPE, SIG_IGN);
+
+    chrono::milliseconds restartDelay = minimumRestartDelay;
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    chrono::steady_clock::time_point activeStartTime = now;
+    chrono::steady_clock::time_point activeDue = now;
+    chrono::steady_clock::time_point standbyDue = now;
+    bool activePending = true;
+    bool standbyPending = useStandby;
+    bool stopping = false;
+    int standbyReleaseDescriptor = -1;
+    *exitCode = EXIT_SUCCESS;
+
+    auto scheduleAfterBackoff = [&]() {
+        chrono::steady_clock::time_point due = chrono::steady_clock::now() + restartDelay;
+        restartDelay = min(restartDelay * 2, maximumRestartDelay);
+        return due;
+    };
+
+    while (true) {
+        now = chrono::steady_clock::now();
+        if (supervisorShutdownRequested) {
+            stopping = true;
+        }
+        if (stopping) {
+            activePending = false;
+            standbyPending = false;
+            if (standbyReleaseDescriptor >= 0) {
+                // the parked standby reads end-of-file and exits
+                close(standbyReleaseDescriptor);
+                standbyReleaseDescriptor = -1;
+            }
+        }
+
+        if (activePending && now >= activeDue) {
+            pid_t pid = forkSupervisedChild(child, -1, standbyReleaseDescriptor);
+            if (pid > 0) {
+                supervisedActivePid = pid;
+                activePending = false;
+                activeStartTime = now;
+                if (verbose) {
+                    cout << "Started supervised Java process " << pid << endl;
+                }
+            } else {
+                cerr << "Warning: failed to fork a Java process: " << strerror(errno) << endl;
+                activeDue = scheduleAfterBackoff();
+            }
+        }
+
+        if (standbyPending && now >= standbyDue) {
+            int descriptors[2];
+            pid_t pid = -1;
+            if (pipe2(descriptors, O_CLOEXEC) == 0) {
+                pid = forkSupervisedChild(child, descriptors[0], descriptors[1]);
+                close(descriptors[0]);
+                if (pid > 0) {
+                    supervisedStandbyPid = pid;
+                    standbyReleaseDescriptor = descriptors[1];
+                    standbyPending = false;
+                    if (verbose) {
+                        cout << "Started standby Java process " << pid << endl;
+                    }
+                } else {
+                    close(descriptors[1]);
+                }
+            }
+            if (pid <= 0) {
+                cerr << "Warning: failed to start a standby Java process: " << strerror(errno) << endl;
+                standbyDue = scheduleAfterBackoff();
+            }
+        }
+
+        int status = 0;
+        pid_t exited;
+        if (activePending || standbyPending) {
+            exited = waitpid(-1, &status, WNOHANG);
+            if (exited == 0) {
+                this_thread::sleep_for(pollInterval);
+                continue;
+            }
+        } else {
+            exited = waitpid(-1, &status, 0);
+        }
+
+        if (exited == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ECHILD && (activePending || standbyPending)) {
+                // every child crashed, wait for the restart delay
+                this_thread::sleep_for(pollInterval);
+                continue;
+            }
+            // no children left
+            break;
+        }
+
+        if (exited == supervisedStandbyPid) {
+            supervisedStandbyPid = -1;
+            if (standbyReleaseDescriptor >= 0) {
+                close(standbyReleaseDescriptor);
+                standbyReleaseDescriptor = -1;
+            }
+            if (!stopping) {
+                cerr << "Warning: standby Java process " << exited << " " << describeExitStatus(status) << " before it was needed" << endl;
+                standbyPending = true;
+                standbyDue = scheduleAfterBackoff();
+            }
+            continue;
+        }
+
+        if (exited != supervisedActivePid) {
+            continue;
+        }
+
+        supervisedActivePid = -1;
+        if (stopping || (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)) {
+            if (verbose) {
+                cout << "Supervised Java process " << exited << " " << describeExitStatus(status) << endl;
+            }
+            *exitCode = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+            stopping = true;
+            continue;
+        }
+
+        cerr << "Warning: Java process " << exited << " " << describeExitStatus(status) << endl;
+        now = chrono::steady_clock::now();
+        if (now - activeStartTime >= stableRunTime) {
+            restartDelay = minimumRestartDelay;
+        }
+
+        if (supervisedStandbyPid > 0 && write(standbyReleaseDescriptor, "r", 1) == 1) {
+            close(standbyReleaseDescriptor);
+            standbyReleaseDescriptor = -1;
+            supervisedActivePid = supervisedStandbyPid;
+            supervisedStandbyPid = -1;
+            activeStartTime = now;
+            if (verbose) {
+                cout << "Released standby Java process " << supervisedActivePid << endl;
+            }
+            standbyPending = true;
+            standbyDue = scheduleAfterBackoff();
+        } else {
+            // no standby is ready, the standby (if any) is replaced once the new active process is running
+            activePending = true;
+            activeDue = scheduleAfterBackoff();
+        }
+    }
+
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    return true;
+}
+
+static const int maxCapturedFrames = 64;
+
+/**
+ * The thread whose stack is requested, set to -1 by the thread's signal handler once it captures its stack, and to 0 when nobody is waiting.
+ */
+static atomic<pid_t> stackCaptureThread(0);
+static void* capturedFrames[maxCapturedFrames];
+static int capturedFrameCount = 0;
+static sem_t stackCaptured;
+
+/**
+ * The launcher's threads that run native code only, the capture holds the mutex so a thread can't start running Java code meanwhile.
+ */
+static mutex capturableThreadsMutex;
+static set<pid_t> capturableThreads;
+
+static int getStackCaptureSignal() {
+    // not used by HotSpot, which takes SIGUSR2 and the usual fault and termination signals
+    return SIGRTMIN + 2;
+}
+
+static void captureStack(int signalNumber) {
+    int savedErrno = errno;
+    pid_t expected = (pid_t) syscall(SYS_gettid);
+    if (stackCaptureThread.compare_exchange_strong(expected, -1)) {
+        capturedFrameCount = backtrace(capturedFrames, maxCapturedFrames);
+        sem_post(&stackCaptured);
+    }
+    errno = savedErrno;
+}
+
+static void writeCapturedFrames(ostream& out) {
+    for (int frameIndex = 0; frameIndex < capturedFrameCount; frameIndex++) {
+        out << "  #" << frameIndex << " " << capturedFrames[frameIndex];
+        Dl_info info;
+        if (dladdr(capturedFrames[frameIndex], &info) != 0 && info.dli_fname != nullptr) {
+            const char* library = strrchr(info.dli_fname, '/');
+            out << " " << (library != nullptr ? library + 1 : info.dli_fname) << "+0x" << hex
+                << ((char*) capturedFrames[frameIndex] - (char*) info.dli_fbase) << dec;
+            if (info.dli_sname != nullptr) {
+                out << " " << info.dli_sname << "+0x" << hex << ((char*) capturedFrames[frameIndex] - (char*) info.dli_saddr) << dec;
+            }
+        }
+        out << "\n";
+    }
+}
+
+void setNativeStackCapturable(bool capturable) {
+    pid_t self = (pid_t) syscall(SYS_gettid);
+    lock_guard<mutex> lock(capturableThreadsMutex);
+    if (capturable) {
+        capturableThreads.insert(self);
+    } else {
+        capturableThreads.erase(self);
+    }
+}
+
+bool writeNativeStacks(ostream& out) {
+    lock_guard<mutex> lock(capturableThreadsMutex);
+    static bool handlerInstalled = false;
+    if (!handlerInstalled) {
+        // the first backtrace() loads the unwinder, which isn't safe in a signal handler
+        backtrace(capturedFrames, 1);
+        sem_init(&stackCaptured, 0, 0);
+        struct sigaction action = {};
+        action.sa_handler = captureStack;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(getStackCaptureSignal(), &action, nullptr) != 0) {
+            return false;
+        }
+        // the handler stays installed, a thread that had the signal blocked may still take it later
+        handlerInstalled = true;
+    }
+
+    // the threads of the JVM aren't signalled, unwinding JIT compiled frames or a thread that holds the unwinder's locks could crash or hang
+    pid_t self = (pid_t) syscall(SYS_gettid);
+    if (capturableThreads.empty() || (capturableThreads.size() == 1 && *capturableThreads.begin() == self)) {
+        out << "  (every launcher thread runs in the JVM, see the Java threads)\n";
+    }
+    for (pid_t thread : capturableThreads) {
+        if (thread == self) {
+            continue;
+        }
+        string threadName;
+        ifstream comm("/proc/self/task/" + to_string(thread) + "/comm");
+        getline(comm, threadName);
+        out << "Thread " << thread << " \"" << threadName << "\"\n";
+
+        stackCaptureThread = thread;
+        if (syscall(SYS_tgkill, getpid(), thread, getStackCaptureSignal()) != 0) {
+            stackCaptureThread = 0;
+            out << "  (exited)\n\n";
+            continue;
+        }
+        struct timespec timeout;
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_nsec += 500 * 1000 * 1000;
+        timeout.tv_sec += timeout.tv_nsec / (1000 * 1000 * 1000);
+        timeout.tv_nsec %= 1000 * 1000 * 1000;
+        int waited;
+        while ((waited = sem_timedwait(&stackCaptured, &timeout)) != 0 && errno == EINTR) {
+        }
+        pid_t expected = thread;
+        if (waited != 0 && stackCaptureThread.compare_exchange_strong(expected, 0)) {
+            out << "  (didn't respond, the signal may be blocked)\n\n";
+            continue;
+        }
+        if (waited != 0) {
+            // the handler claimed the request just after the timeout and is about to finish
+            while (sem_wait(&stackCaptured) != 0 && errno == EINTR) {
+            }
+        }
+        stackCaptureThread = 0;
+        writeCapturedFrames(out);
+        out << "\n";
+    }
+    return true;
+}
+
+/**
+ * Reads the "avg10" values of a pressure stall information file, e.g. /proc/pressure/memory.
+ */
+static bool readPressureStallFile(const string& path, MemoryPressure* pressure) {
+    ifstream in(path);
+    bool hasSome = false;
+    string line;
+    while (getline(in, line)) {
+        double avg10 = 0;
+        if (sscanf(line.c_str(), "some avg10=%lf", &avg10) == 1) {
+            pressure->someAvg10 = avg10;
+            hasSome = true;
+        } else if (sscanf(line.c_str(), "full avg10=%lf", &avg10) == 1) {
+            pressure->fullAvg10 = avg10;
+        }
+    }
+    return hasSome;
+}
+
+/**
+ * The directory of the cgroup v2 this process runs in, empty if there's none. Hybrid hierarchies mount it at /sys/fs/cgroup/unified.
+ */
+static string getCgroupDirectory() {
+    ifstream in("/proc/self/cgroup");
+    string line;
+    while (getline(in, line)) {
+        if (line.compare(0, 3, "0::") != 0) {
+            continue;
+        }
+        string path = line.substr(3);
+        for (const char* mount : {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"}) {
+            string directory = mount + (path == "/" ? string() : path);
+            if (access((directory + "/memory.events").c_str(), R_OK) == 0) {
+                return directory;
+            }
+        }
+    }
+    return string();
+}
+
+bool readMemoryPressure(MemoryPressure* pressure) {
+    static const string cgroupDirectory = getCgroupDirectory();
+    *pressure = {};
+
+    // a container's own pressure matters more than the machine's
+    bool hasCgroupPressure = !cgroupDirectory.empty() && readPressureStallFile(cgroupDirectory + "/memory.pressure", pressure);
+    if (!hasCgroupPressure && !readPressureStallFile("/proc/pressure/memory", pressure)) {
+        return false;
+    }
+
+    if (!cgroupDirectory.empty()) {
+        ifstream in(cgroupDirectory + "/memory.events");
+        string event;
+        unsigned long long count;
+        while (in >> event >> count) {
+            if (event == "high" || event == "max" || event == "oom") {
+                pressure->limitEvents += count;
+            }
+        }
+    }
+    return true;
+}
+
+void applyProcessPriority(const ProcessPriority& priority) {
+    // scheduling policy, nice value, and I/O priority are per thread on Linux, threads started afterwards inherit them
+    if (!priority.scheduler.empty()) {
+        int policy = priority.scheduler == "idle" ? SCHED_IDLE : priority.scheduler == "batch" ? SCHED_BATCH : SCHED_OTHER;
+        struct sched_param parameters = {};
+        if (sched_setscheduler(0, policy, &parameters) != 0) {
+            cerr << "Warning: failed to set the scheduling policy " << priority.scheduler << ": " << strerror(errno) << endl;
+        }
+    }
+
+    // SCHED_IDLE ignores the nice value
+    if (priority.hasNice && setpriority(PRIO_PROCESS, 0, priority.nice) != 0) {
+        cerr << "Warning: failed to set the nice value " << priority.nice << ": " << strerror(errno) << endl;
+    }
+
+    if (!priority.ioClass.empty()) {
+        // ioprio_set() has no glibc wrapper, the class is stored above the 13 bits of the priority
+        const int ioprioWhoProcess = 1;
+        const int ioprioClassShift = 13;
+        int ioClass = priority.ioClass == "realtime" ? 1 : priority.ioClass == "best-effort" ? 2 : 3;
+        if (syscall(SYS_ioprio_set, ioprioWhoProcess, 0, (ioClass << ioprioClassShift) | priority.ioPriority) != 0) {
+            cerr << "Warning: failed to set the I/O class " << priority.ioClass << ": " << strerror(errno) << endl;
+        }
+    }
+
+    if (priority.hasOomScoreAdjust) {
+        ofstream oomScoreAdjust("/proc/self/oom_score_adj");
+        oomScoreAdjust << priority.oomScoreAdjust << flush;
+        if (!oomScoreAdjust) {
+            cerr << "Warning: failed to set the OOM score adjustment " << priority.oomScoreAdjust
+                 << (priority.oomScoreAdjust < 0 ? ", lowering it needs CAP_SYS_RESOURCE" : "") << endl;
+        }
+    }
+}
+
+/**
+ * The executable segment of a loaded library and where it comes from in the library file.
+ */
+struct TextSegment {
+    uintptr_t start;
+    size_t length;
+    off_t fileOffset;
+    string path;
+};
+
+static int findJvmTextSegment(struct dl_phdr_info* info, size_t, void* data) {
+    const char* name = info->dlpi_name;
+    const char* fileName = name != nullptr ? strrchr(name, '/') : nullptr;
+    if (fileName == nullptr || strcmp(fileName, "/libjvm.so") != 0) {
+        return 0;
+    }
+    TextSegment* segment = (TextSegment*) data;
+    for (int index = 0; index < info->dlpi_phnum; index++) {
+        const ElfW(Phdr)& header = info->dlpi_phdr[index];
+        if (header.p_type == PT_LOAD && (header.p_flags & PF_X) != 0 && header.p_memsz > segment->length) {
+            segment->start = info->dlpi_addr + header.p_vaddr;
+            segment->length = header.p_memsz;
+            segment->fileOffset = header.p_offset;
+            segment->path = name;
+        }
+    }
+    return 1;
+}
+
+/**
+ * The size of a transparent huge page, or 0 if the kernel doesn't hand them out to madvise(MADV_HUGEPAGE) regions.
+ */
+static size_t getTransparentHugePageSize() {
+    ifstream enabled("/sys/kernel/mm/transparent_hugepage/enabled");
+    string modes;
+    if (!getline(enabled, modes) || modes.find("[never]") != string::npos) {
+        return 0;
+    }
+    size_t size = 0;
+    ifstream pmdSize("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+    if (!(pmdSize >> size)) {
+        size = 2 * 1024 * 1024;
+    }
+    return size;
+}
+
+/**
+ * The kilobytes of a mapping starting at start that are backed by anonymous huge pages.
+ */
+static unsigned long getAnonymousHugePageKilobytes(uintptr_t start) {
+    ifstream smaps("/proc/self/smaps");
+    string line;
+    bool inMapping = false;
+    while (getline(smaps, line)) {
+        unsigned long mappingStart = 0;
+        unsigned long kilobytes = 0;
+        if (line.find(' ') > line.find('-') && sscanf(line.c_str(), "%lx-", &mappingStart) == 1) {
+            inMapping = mappingStart == start;
+        } else if (inMapping && sscanf(line.c_str(), "AnonHugePages: %lu kB", &kilobytes) == 1) {
+            return kilobytes;
+        }
+    }
+    return 0;
+}
+
+bool remapJvmTextOntoHugePages() {
+    TextSegment segment = {};
+    if (dl_iterate_phdr(findJvmTextSegment, &segment) == 0 || segment.length == 0) {
+        cerr << "Warning: the executable segment of libjvm.so wasn't found" << endl;
+        return false;
+    }
+
+    size_t hugePageSize = getTransparentHugePageSize();
+    if (hugePageSize == 0) {
+        cerr << "Warning: transparent huge pages are disabled or unsupported by the kernel" << endl;
+        return false;
+    }
+
+    // only whole huge pages inside the segment are moved, the code around them stays mapped from the file
+    uintptr_t start = (segment.start + hugePageSize - 1) & ~(uintptr_t) (hugePageSize - 1);
+    uintptr_t end = (segment.start + segment.length) & ~(uintptr_t) (hugePageSize - 1);
+    if (end <= start) {
+        cerr << "Warning: the code of libjvm.so is smaller than a huge page" << endl;
+        return false;
+    }
+    size_t length = end - start;
+    off_t fileOffset = segment.fileOffset + (off_t) (start - segment.start);
+
+    // opened beforehand, so the original file mapping can be restored if a later step fails
+    int descriptor = open(segment.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor == -1) {
+        cerr << "Warning: failed to open " << segment.path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    void* copy = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (copy == MAP_FAILED) {
+        cerr << "Warning: failed to allocate " << length << " bytes for the libjvm.so code: " << strerror(errno) << endl;
+        close(descriptor);
+        return false;
+    }
+    memcpy(copy, (const void*) start, length);
+
+    // nothing may execute the code between here and mprotect(), the JVM hasn't started any threads yet
+    const char* failedStep = nullptr;
+    void* target = mmap((void*) start, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if (target == MAP_FAILED) {
+        failedStep = "map anonymous memory";
+    } else if (madvise(target, length, MADV_HUGEPAGE) != 0) {
+        failedStep = "request huge pages";
+    } else {
+        memcpy(target, copy, length);
+        // kernels that forbid executable anonymous memory, e.g. with SELinux execmem denied, fail here
+        if (mprotect(target, length, PROT_READ | PROT_EXEC) != 0) {
+            failedStep = "make the copied code executable";
+        }
+    }
+
+    if (failedStep != nullptr) {
+        cerr << "Warning: failed to " << failedStep << " for the libjvm.so code: " << strerror(errno) << endl;
+        if (mmap((void*) start, length, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_FIXED, descriptor, fileOffset) == MAP_FAILED) {
+            cerr << "Error: failed to restore the libjvm.so code mapping: " << strerror(errno) << endl;
+            abort();
+        }
+    }
+    munmap(copy, length);
+    close(descriptor);
+
+    if (failedStep == nullptr && verbose) {
+        cout << "Remapped " << (length >> 20) << " MiB of libjvm.so code, " << (getAnonymousHugePageKilobytes(start) >> 10)
+             << " MiB of it on huge pages so far" << endl;
+    }
+    return failedStep == nullptr;
+}
+
+unsigned long long getResidentMemorySize() {
+    // the second field of statm is the resident set in pages
+    ifstream statm("/proc/self/statm");
+    unsigned long long size = 0;
+    unsigned long long residentPages = 0;
+    if (!(statm >> size >> residentPages)) {
+        return 0;
+    }
+    return residentPages * (unsigned long long) sysconf(_SC_PAGESIZE);
+}
+
+void releaseFreeHeapMemory() {
+#ifdef __GLIBC__
+    // glibc only gives back the top of the heap on its own, malloc_trim() also releases free pages in the middle of every arena
+    malloc_trim(0);
+#endif
+}
+
 #endif
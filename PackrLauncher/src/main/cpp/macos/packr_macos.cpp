@@ -17,11 +17,22 @@
 
 #include <packr.h>
 
+#include <algorithm>
 #include <dlfcn.h>
+#include <errno.h>
 #include <iostream>
 #include <pthread.h>
+#include <sstream>
+#include <string.h>
 #include <CoreFoundation/CoreFoundation.h>
+#include <fcntl.h>
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+#include <sys/mman.h>
 #include <sys/param.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/sysctl.h>
 #include <unistd.h>
 
 #include <ftw.h>
@@ -124,20 +135,36 @@ int searchForLibJli(const char *filename, const struct stat *statptr, int filefl
     return 0;
 }
 
-bool loadJNIFunctions(const dropt_char* jrePath, GetDefaultJavaVMInitArgs* getDefaultJavaVMInitArgs, CreateJavaVM* createJavaVM) {
-    libJliSearchPath[0] = 0;
-    nftw(jrePath, searchForLibJli, 5, FTW_CHDIR | FTW_DEPTH | FTW_MOUNT);
+bool loadJNIFunctions(const dropt_char* jrePath, const char* vmType, GetDefaultJavaVMInitArgs* getDefaultJavaVMInitArgs, CreateJavaVM* createJavaVM) {
+    void* handle = nullptr;
 
-    string libJliAbsolutePath;
-    char currentWorkingDirectoryPath[MAXPATHLEN];
-    if (getcwd(currentWorkingDirectoryPath, sizeof(currentWorkingDirectoryPath))) {
-        libJliAbsolutePath.append(currentWorkingDirectoryPath).append("/");
-    }
-    libJliAbsolutePath.append(libJliSearchPath);
-    if(verbose) {
-        cout << "Loading libjli=" << libJliAbsolutePath << endl;
+    // libjli always creates the server VM, other VM types are loaded directly
+    if (strcmp(vmType, "server") != 0) {
+        string libJvmPath = string(jrePath) + "/lib/" + vmType + "/libjvm.dylib";
+        struct stat buffer;
+        if (stat(libJvmPath.c_str(), &buffer) != 0) {
+            cerr << "No " << vmType << " libjvm.dylib found in " << jrePath << endl;
+            return false;
+        }
+        if(verbose) {
+            cout << "Loading libjvm=" << libJvmPath << endl;
+        }
+        handle = dlopen(libJvmPath.c_str(), RTLD_LAZY);
+    } else {
+        libJliSearchPath[0] = 0;
+        nftw(jrePath, searchForLibJli, 5, FTW_CHDIR | FTW_DEPTH | FTW_MOUNT);
+
+        string libJliAbsolutePath;
+        char currentWorkingDirectoryPath[MAXPATHLEN];
+        if (getcwd(currentWorkingDirectoryPath, sizeof(currentWorkingDirectoryPath))) {
+            libJliAbsolutePath.append(currentWorkingDirectoryPath).append("/");
+        }
+        libJliAbsolutePath.append(libJliSearchPath);
+        if(verbose) {
+            cout << "Loading libjli=" << libJliAbsolutePath << endl;
+        }
+        handle = dlopen(libJliAbsolutePath.c_str(), RTLD_LAZY);
     }
-    void* handle = dlopen(libJliAbsolutePath.c_str(), RTLD_LAZY);
     if (handle == nullptr) {
         cerr << dlerror() << endl;
         return false;
@@ -217,8 +244,136 @@ bool changeWorkingDir(const dropt_char* directory) {
     return chdir(directory) == 0;
 }
 
+bool createDirectory(const dropt_char* directory) {
+    return mkdir(directory, 0755) == 0 || errno == EEXIST;
+}
+
+unsigned long getProcessId() {
+    return (unsigned long) getpid();
+}
+
+bool mapFile(const dropt_char* path, bool copyOnWrite, MappedFile* mapping) {
+    int descriptor = open(path, O_RDONLY | O_CLOEXEC);
+    if (descriptor == -1) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close(descriptor);
+        return false;
+    }
+    // a private mapping never writes back to the file
+    void* data = mmap(nullptr, status.st_size, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    mapping->data = (char*) data;
+    mapping->length = status.st_size;
+    return true;
+}
+
+void unmapFile(MappedFile* mapping) {
+    if (mapping->data != nullptr) {
+        munmap(mapping->data, mapping->length);
+    }
+    mapping->data = nullptr;
+    mapping->length = 0;
+}
+
 bool isZgcSupported() {
     return true;
 }
 
+unsigned long long getPhysicalMemorySize() {
+    uint64_t memorySize = 0;
+    size_t length = sizeof(memorySize);
+    if (sysctlbyname("hw.memsize", &memorySize, &length, nullptr, 0) != 0) {
+        return 0;
+    }
+    return memorySize;
+}
+
+bool hasCpuFeature(const char* feature) {
+    string lowerCaseFeature(feature);
+    transform(lowerCaseFeature.begin(), lowerCaseFeature.end(), lowerCaseFeature.begin(), ::tolower);
+
+    // Intel Macs list the features like "SSE4.1 AVX1.0", Linux /proc/cpuinfo names are used for them, e.g. "sse4_1" and "avx"
+    for (const char* sysctlName : {"machdep.cpu.features", "machdep.cpu.leaf7_features", "machdep.cpu.extfeatures"}) {
+        char features[1024];
+        size_t length = sizeof(features);
+        if (sysctlbyname(sysctlName, features, &length, nullptr, 0) != 0) {
+            continue;
+        }
+        istringstream tokens(string(features, strnlen(features, length)));
+        string token;
+        while (tokens >> token) {
+            transform(token.begin(), token.end(), token.begin(), ::tolower);
+            replace(token.begin(), token.end(), '.', '_');
+            if (token.size() > 4 && token.compare(token.size() - 4, 4, "1_0") == 0) {
+                token.erase(token.size() - 3);
+            }
+            if (token == lowerCaseFeature) {
+                return true;
+            }
+        }
+    }
+
+    // Apple silicon reports features as hw.optional.<feature> flags, e.g. hw.optional.neon
+    int available = 0;
+    size_t length = sizeof(available);
+    if (sysctlbyname(("hw.optional." + lowerCaseFeature).c_str(), &available, &length, nullptr, 0) == 0) {
+        return available != 0;
+    }
+    return false;
+}
+
+bool superviseChildProcesses(const SupervisedChildDelegate& child, bool useStandby, int* exitCode) {
+    return false;
+}
+
+void setNativeStackCapturable(bool capturable) {
+}
+
+bool writeNativeStacks(ostream& out) {
+    return false;
+}
+
+bool readMemoryPressure(MemoryPressure* pressure) {
+    return false;
+}
+
+void applyProcessPriority(const ProcessPriority& priority) {
+    if (priority.hasNice && setpriority(PRIO_PROCESS, 0, priority.nice) != 0) {
+        cerr << "Warning: failed to set the nice value " << priority.nice << ": " << strerror(errno) << endl;
+    }
+    // disk I/O of a throttled process yields to other processes
+    if (priority.ioClass == "idle" && setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE) != 0) {
+        cerr << "Warning: failed to throttle disk I/O: " << strerror(errno) << endl;
+    } else if (!priority.ioClass.empty() && priority.ioClass != "idle") {
+        cerr << "Warning: only the idle I/O class is supported on macOS" << endl;
+    }
+    if (!priority.scheduler.empty() || priority.hasOomScoreAdjust) {
+        cerr << "Warning: the scheduling policy and the OOM score adjustment aren't supported on macOS" << endl;
+    }
+}
+
+bool remapJvmTextOntoHugePages() {
+    return false;
+}
+
+unsigned long long getResidentMemorySize() {
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+}
+
+void releaseFreeHeapMemory() {
+    // asks every malloc zone to give back as much free memory as it can
+    malloc_zone_pressure_relief(nullptr, 0);
+}
+
 #endif
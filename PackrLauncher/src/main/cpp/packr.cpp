@@ -16,15 +16,26 @@
 #include "packr.h"
 
 #include "dropt.h"
+#include "dropt_static.hpp"
 #include "sajson.h"
 
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <memory>
 #include <cstring>
+#include <cstdarg>
+#include <cstdio>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #include <locale>
 #include <codecvt>
@@ -39,6 +50,33 @@
 using namespace std;
 
 bool verbose = false;
+bool tracing = false;
+
+/**
+ * Steady clock time captured during static initialization, used as the base for startup trace timings.
+ */
+static const chrono::steady_clock::time_point launcherStartTime = chrono::steady_clock::now();
+
+/**
+ * A startup phase passed to tracePhase(), with the microseconds since the launcher started and since the epoch.
+ */
+struct TracedPhase {
+    string name;
+    long long elapsedMicros;
+    long long epochMicros;
+};
+
+/**
+ * Every traced phase in order, starting with "launcher-started". Java adds phases through the launcher API on any thread.
+ */
+static vector<TracedPhase> tracedPhases = {
+        {"launcher-started", 0, chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count()}};
+static mutex tracedPhasesMutex;
+
+/**
+ * Class the launcher defines in the class loader of the application, see Launcher.java in Packr for its Java side.
+ */
+static const char launcherClassName[] = "com/badlogicgames/packr/Launcher";
 
 /**
  * UTF-8 encoded working directory.
@@ -46,13 +84,66 @@ bool verbose = false;
 static string workingDir;
 static string executableName;
 static string configurationPath;
+static bool configurationFromCommandLine = false;
+
+/**
+ * Path to this executable as returned by getExecutablePath(), checked for an embedded single file payload.
+ */
+static basic_string<dropt_char> executableFilePath;
+
+/**
+ * A single file executable ends with a zip of the classpath whose comment is this trailer, followed by the configuration offset and length as 20 digit
+ * decimal numbers separated by a space, and a newline.
+ */
+static const char payloadTrailerMagic[] = "PACKR-PAYLOAD ";
+static const size_t payloadTrailerLength = sizeof(payloadTrailerMagic) - 1 + 20 + 1 + 20 + 1;
+
+/**
+ * Supervise mode requested on the command line, in addition to the "supervise" and "supervisorStandby" configuration values.
+ */
+static bool superviseFromCommandLine = false;
+static bool standbyFromCommandLine = false;
+
+/**
+ * UTF-8 encoded VM options passed with "-J" on the command line, they override the "vmArgs" of the configuration.
+ */
+static vector<string> vmOptionsFromCommandLine;
+
+/**
+ * Diagnostics profile requested on the command line, in addition to the "enabled" value of the "profile" configuration section.
+ */
+static bool profileFromCommandLine = false;
+
+/**
+ * UTF-8 encoded directory the diagnostics profile of this run is written to, empty if profiling is off.
+ */
+static string profileDirectory;
+static chrono::system_clock::time_point profileStartTime;
+static vector<string> profileVmOptions;
+static atomic<bool> profileIndexWritten(false);
+
+/**
+ * The files of a diagnostics profile, by their name in the index.
+ */
+static const char *const profileFiles[][2] = {{"classLoading", "class-load.log"},
+                                              {"startup", "startup.log"},
+                                              {"safepoints", "safepoint.log"},
+                                              {"recording", "recording.jfr"},
+                                              {"recordingRepository", "jfr"},
+                                              {"crashLog", "hs_err.log"}};
 
-static size_t cmdLineArgc = 0;
+/**
+ * UTF-8 encoded command line options for passing to the JVM. They point into argv where it is UTF-8 already, otherwise into the argument blocks.
+ */
+static vector<const char *> cmdLineArgv;
 
 /**
- * UTF-8 encoded command line options for passing to the JVM.
+ * Arguments converted to UTF-8 or read from argument files are packed into blocks of this size, instead of allocating each one separately.
  */
-static char **cmdLineArgv = nullptr;
+static const size_t argumentBlockSize = 64 * 1024;
+static vector<unique_ptr<char[]>> argumentBlocks;
+static char *argumentBlock = nullptr;
+static size_t argumentBlockUsed = argumentBlockSize;
 
 #define verify(env, pointer) \
     if (checkExceptionAndResult(env, pointer)) return EXIT_FAILURE;
@@ -66,7 +157,146 @@ static bool checkExceptionAndResult(JNIEnv *env, void *pointer) {
     return pointer == nullptr;
 }
 
-static int loadStaticMethod(JNIEnv *env, const vector<string> &classPath, const string &className, jclass *resultClass, jmethodID *resultMethod) {
+void tracePhase(const char *phase) {
+    long long elapsedMicros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - launcherStartTime).count();
+    long long epochMicros = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    lock_guard<mutex> lock(tracedPhasesMutex);
+    tracedPhases.push_back({phase, elapsedMicros, epochMicros});
+    if (!tracing) {
+        return;
+    }
+    // packr-trace <phase> <microseconds since launcher start> <microseconds since epoch>
+    cout << "packr-trace " << phase << " " << elapsedMicros << " " << epochMicros << endl;
+}
+
+static jboolean JNICALL launcherIsAvailable(JNIEnv *env, jclass launcherClass) {
+    return JNI_TRUE;
+}
+
+/**
+ * Reads a phase name passed from Java, whitespace is replaced with "-" to keep the trace output parsable.
+ * @return false with a pending exception if the name is null or empty
+ */
+static bool getPhaseName(JNIEnv *env, jstring phase, string *phaseName) {
+    if (phase == nullptr) {
+        env->ThrowNew(env->FindClass("java/lang/NullPointerException"), "phase");
+        return false;
+    }
+    const char *phaseUtf = env->GetStringUTFChars(phase, nullptr);
+    if (phaseUtf == nullptr) {
+        return false;
+    }
+    *phaseName = phaseUtf;
+    env->ReleaseStringUTFChars(phase, phaseUtf);
+    if (phaseName->empty()) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"), "phase is empty");
+        return false;
+    }
+    replace_if(phaseName->begin(), phaseName->end(), [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }, '-');
+    return true;
+}
+
+static void JNICALL launcherMarkPhase(JNIEnv *env, jclass launcherClass, jstring phase) {
+    string phaseName;
+    if (getPhaseName(env, phase, &phaseName)) {
+        tracePhase(phaseName.c_str());
+    }
+}
+
+static void JNICALL launcherMarkReady(JNIEnv *env, jclass launcherClass) {
+    tracePhase("ready");
+    if (verbose) {
+        lock_guard<mutex> lock(tracedPhasesMutex);
+        cout << "Application ready after " << tracedPhases.back().elapsedMicros / 1000 << " ms" << endl;
+    }
+}
+
+/**
+ * @return the microseconds since the epoch of the first time the phase was traced, or -1 if it wasn't
+ */
+static jlong JNICALL launcherGetPhaseTimeMicros(JNIEnv *env, jclass launcherClass, jstring phase) {
+    string phaseName;
+    if (!getPhaseName(env, phase, &phaseName)) {
+        return -1;
+    }
+    lock_guard<mutex> lock(tracedPhasesMutex);
+    for (const TracedPhase &tracedPhase : tracedPhases) {
+        if (tracedPhase.name == phaseName) {
+            return tracedPhase.epochMicros;
+        }
+    }
+    return -1;
+}
+
+static JNINativeMethod launcherNatives[] = {{(char *) "isAvailable", (char *) "()Z", (void *) launcherIsAvailable},
+                                            {(char *) "markPhase", (char *) "(Ljava/lang/String;)V", (void *) launcherMarkPhase},
+                                            {(char *) "markReady", (char *) "()V", (void *) launcherMarkReady},
+                                            {(char *) "getPhaseTimeMicros", (char *) "(Ljava/lang/String;)J", (void *) launcherGetPhaseTimeMicros}};
+
+/**
+ * Builds the class file of a public final class named launcherClassName with a public static native method for each of launcherNatives.
+ */
+static vector<jbyte> buildLauncherClassFile() {
+    vector<jbyte> classFile;
+    auto u1 = [&](unsigned int value) {
+        classFile.push_back((jbyte) (value & 0xff));
+    };
+    auto u2 = [&](size_t value) {
+        u1((unsigned int) (value >> 8));
+        u1((unsigned int) value);
+    };
+    auto utf8 = [&](const char *text) {
+        u1(1);
+        u2(strlen(text));
+        classFile.insert(classFile.end(), text, text + strlen(text));
+    };
+    const size_t methodCount = sizeof(launcherNatives) / sizeof(launcherNatives[0]);
+
+    u1(0xca), u1(0xfe), u1(0xba), u1(0xbe);
+    // class file version 52, Java 8
+    u2(0), u2(52);
+
+    // constant pool: #1 and #2 are this class, #3 and #4 the super class, then the name and descriptor of each method
+    u2(5 + 2 * methodCount);
+    utf8(launcherClassName), u1(7), u2(1);
+    utf8("java/lang/Object"), u1(7), u2(3);
+    for (const JNINativeMethod &method : launcherNatives) {
+        utf8(method.name);
+        utf8(method.signature);
+    }
+
+    // ACC_PUBLIC | ACC_FINAL | ACC_SUPER, this class, super class, no interfaces, no fields
+    u2(0x0031), u2(2), u2(4), u2(0), u2(0);
+
+    u2(methodCount);
+    for (size_t methodIndex = 0; methodIndex < methodCount; methodIndex++) {
+        // ACC_PUBLIC | ACC_STATIC | ACC_NATIVE, name, descriptor, no attributes
+        u2(0x0109), u2(5 + 2 * methodIndex), u2(6 + 2 * methodIndex), u2(0);
+    }
+
+    // no attributes
+    u2(0);
+    return classFile;
+}
+
+/**
+ * Defines the launcher API class in the class loader of the application and registers its native methods. Failing to do so isn't fatal, the
+ * application only loses the launcher API.
+ */
+static void defineLauncherClass(JNIEnv *env, jobject classLoader) {
+    vector<jbyte> classFile = buildLauncherClassFile();
+    jclass launcherClass = env->DefineClass(launcherClassName, classLoader, classFile.data(), (jsize) classFile.size());
+    if (launcherClass == nullptr || env->RegisterNatives(launcherClass, launcherNatives, sizeof(launcherNatives) / sizeof(launcherNatives[0])) != 0) {
+        cerr << "Warning: failed to define the launcher API class " << launcherClassName << endl;
+        if (env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+    }
+}
+
+static int loadStaticMethod(JNIEnv *env, const vector<string> &classPath, const string &className, jclass *resultClass, jmethodID *resultMethod,
+                            jobject *resultClassLoader) {
 
     //! Method to retrieve 'static void main(String[] args)' from a user-defined class path.
     //! The original 'packr' passes "-Djava.class.path=<path-to-jar>" as an argument during
@@ -168,6 +398,10 @@ static int loadStaticMethod(JNIEnv *env, const vector<string> &classPath, const
 
     env->CallVoidMethod(thread, threadSetLoader, urlClassLoader);
 
+    // defined before the main class, so the application resolves the launcher API to it instead of the class in Packr
+
+    defineLauncherClass(env, urlClassLoader);
+
     // Class<?> mainClass = urlClassLoader.loadClass(<main-class-name>)
 
     jmethodID loadClass = env->GetMethodID(urlClassLoaderClass, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;");
@@ -186,22 +420,322 @@ static int loadStaticMethod(JNIEnv *env, const vector<string> &classPath, const
 
     *resultClass = (jclass) mainClass;
     *resultMethod = mainMethod;
+    *resultClassLoader = urlClassLoader;
 
     return 0;
 }
 
+/**
+ * Reads class names from a class list file. Lines starting with # or @ are skipped and anything after the class name is ignored, so the output of
+ * -XX:DumpLoadedClassList can be used directly.
+ *
+ * @param classListPath UTF-8 encoded path to the class list
+ * @param classNames receives the class names with . as package delimiter
+ */
+static void readClassList(const string &classListPath, vector<string> &classNames) {
+#ifdef UNICODE
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    ifstream in(converter.from_bytes(classListPath).c_str());
+#else
+    ifstream in(classListPath.c_str());
+#endif
+    if (!in) {
+        cerr << "Warning: failed to read preload class list " << classListPath << endl;
+        return;
+    }
+    string line;
+    while (getline(in, line)) {
+        istringstream tokens(line);
+        string className;
+        if (!(tokens >> className) || className[0] == '#' || className[0] == '@') {
+            continue;
+        }
+        replace(className.begin(), className.end(), '/', '.');
+        classNames.push_back(className);
+    }
+}
+
+/**
+ * Loads classes with Class.forName(name, false, classLoader) on a daemon thread so that the main method finds them already loaded. Classes that
+ * can't be found are skipped.
+ *
+ * @param jvm the Java VM to attach the preloading thread to
+ * @param classLoader the application class loader, a global reference is kept while preloading
+ * @param classNames class names from the "preloadClasses" configuration
+ * @param classListPath UTF-8 encoded path from the "preloadClassList" configuration, or empty
+ */
+static void startClassPreloading(JavaVM *jvm, JNIEnv *env, jobject classLoader, vector<string> classNames, string classListPath) {
+    jobject globalClassLoader = env->NewGlobalRef(classLoader);
+    if (globalClassLoader == nullptr) {
+        cerr << "Warning: failed to reference the class loader for preloading classes" << endl;
+        return;
+    }
+
+    thread([jvm, globalClassLoader, classNames, classListPath]() mutable {
+        chrono::steady_clock::time_point preloadStart = chrono::steady_clock::now();
+        JNIEnv *preloadEnv = nullptr;
+        // a daemon thread doesn't keep DestroyJavaVM waiting when the application finishes before the preloading
+        if (jvm->AttachCurrentThreadAsDaemon((void **) &preloadEnv, nullptr) != JNI_OK) {
+            cerr << "Warning: failed to attach the class preloading thread" << endl;
+            return;
+        }
+
+        if (!classListPath.empty()) {
+            readClassList(classListPath, classNames);
+        }
+
+        size_t loadedCount = 0;
+        jclass classClass = preloadEnv->FindClass("java/lang/Class");
+        jmethodID forName = classClass == nullptr ? nullptr
+                                                  : preloadEnv->GetStaticMethodID(classClass, "forName", "(Ljava/lang/String;ZLjava/lang/ClassLoader;)Ljava/lang/Class;");
+        if (forName == nullptr) {
+            preloadEnv->ExceptionClear();
+            cerr << "Warning: failed to find Class.forName for preloading classes" << endl;
+            classNames.clear();
+        }
+
+        for (const string &className : classNames) {
+            jstring classNameUTF = preloadEnv->NewStringUTF(className.c_str());
+            if (classNameUTF == nullptr) {
+                preloadEnv->ExceptionClear();
+                continue;
+            }
+            jobject loadedClass = preloadEnv->CallStaticObjectMethod(classClass, forName, classNameUTF, JNI_FALSE, globalClassLoader);
+            if (preloadEnv->ExceptionCheck()) {
+                preloadEnv->ExceptionClear();
+                if (verbose) {
+                    cout << "Couldn't preload class " << className << endl;
+                }
+            } else {
+                loadedCount++;
+            }
+            if (loadedClass != nullptr) {
+                preloadEnv->DeleteLocalRef(loadedClass);
+            }
+            preloadEnv->DeleteLocalRef(classNameUTF);
+        }
+
+        preloadEnv->DeleteGlobalRef(globalClassLoader);
+        jvm->DetachCurrentThread();
+
+        tracePhase("classes-preloaded");
+        if (verbose) {
+            cout << "Preloaded " << loadedCount << " of " << classNames.size() << " classes in "
+                 << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - preloadStart).count() << " ms" << endl;
+        }
+    }).detach();
+}
+
+/**
+ * State shared by the threads that invoke the "warmupEntryPoints".
+ */
+struct WarmupState {
+    JavaVM *jvm = nullptr;
+    /** global reference to the application class loader, deleted by the last thread to finish */
+    jobject classLoader = nullptr;
+    vector<string> entryPoints;
+    atomic<size_t> nextEntryPoint{0};
+    atomic<size_t> runningThreads{0};
+    chrono::steady_clock::time_point startTime;
+    /** entry points that haven't started once the budget is used up are skipped, zero means no budget */
+    chrono::milliseconds timeBudget{0};
+};
+
+/**
+ * Ends a warm-up thread, the last one releases the class loader. A thread that failed to attach attaches again for the release, since a global
+ * reference can only be deleted by an attached thread.
+ *
+ * @param env nullptr if the calling thread isn't attached
+ */
+static void finishWarmupThread(const shared_ptr<WarmupState> &state, JNIEnv *env) {
+    if (--state->runningThreads == 0) {
+        JavaVMAttachArgs attachArguments = {JNI_VERSION_1_6, (char *) "packr-warmup", nullptr};
+        if (env == nullptr && state->jvm->AttachCurrentThreadAsDaemon((void **) &env, &attachArguments) != JNI_OK) {
+            env = nullptr;
+            cerr << "Warning: failed to attach a warm-up thread to release the class loader" << endl;
+        }
+        if (env != nullptr) {
+            env->DeleteGlobalRef(state->classLoader);
+        }
+        tracePhase("warmup-finished");
+    }
+    if (env != nullptr) {
+        state->jvm->DetachCurrentThread();
+    }
+}
+
+/**
+ * Invokes warm-up entry points until all of them were taken by this or another warm-up thread.
+ */
+static void runWarmupEntryPoints(const shared_ptr<WarmupState> &state) {
+    JNIEnv *env = nullptr;
+    if (state->jvm->AttachCurrentThreadAsDaemon((void **) &env, nullptr) != JNI_OK) {
+        cerr << "Warning: failed to attach a warm-up thread" << endl;
+        finishWarmupThread(state, nullptr);
+        return;
+    }
+
+    jclass classClass = env->FindClass("java/lang/Class");
+    jmethodID forName = classClass == nullptr ? nullptr
+                                              : env->GetStaticMethodID(classClass, "forName", "(Ljava/lang/String;ZLjava/lang/ClassLoader;)Ljava/lang/Class;");
+    if (forName == nullptr) {
+        env->ExceptionClear();
+        cerr << "Warning: failed to find Class.forName for the warm-up entry points" << endl;
+        state->nextEntryPoint = state->entryPoints.size();
+    }
+
+    size_t index;
+    while ((index = state->nextEntryPoint++) < state->entryPoints.size()) {
+        const string &entryPoint = state->entryPoints[index];
+        chrono::steady_clock::time_point entryStartTime = chrono::steady_clock::now();
+        if (state->timeBudget.count() > 0 && entryStartTime - state->startTime >= state->timeBudget) {
+            if (verbose) {
+                cout << "Skipping warm-up entry point " + entryPoint + ", the time budget is used up\n" << flush;
+            }
+            continue;
+        }
+
+        size_t methodDelimiter = entryPoint.rfind('.');
+        if (methodDelimiter == string::npos) {
+            cerr << "Warning: warm-up entry point " << entryPoint << " isn't a <class name>.<method name>" << endl;
+            continue;
+        }
+        const string className = entryPoint.substr(0, methodDelimiter);
+        const string methodName = entryPoint.substr(methodDelimiter + 1);
+
+        // Class.forName(className, true, classLoader).getMethod(methodName).invoke(null)
+
+        jstring classNameUTF = env->NewStringUTF(className.c_str());
+        jclass warmupClass = classNameUTF == nullptr ? nullptr
+                                                     : (jclass) env->CallStaticObjectMethod(classClass, forName, classNameUTF, JNI_TRUE, state->classLoader);
+        jmethodID warmupMethod = nullptr;
+        if (warmupClass != nullptr && !env->ExceptionCheck()) {
+            warmupMethod = env->GetStaticMethodID(warmupClass, methodName.c_str(), "()V");
+        }
+
+        if (warmupMethod == nullptr) {
+            env->ExceptionClear();
+            cerr << "Warning: failed to find the warm-up entry point static void " << entryPoint << "()" << endl;
+        } else {
+            env->CallStaticVoidMethod(warmupClass, warmupMethod);
+            if (env->ExceptionCheck()) {
+                env->ExceptionDescribe();
+                env->ExceptionClear();
+                cerr << "Warning: warm-up entry point " << entryPoint << " threw an exception" << endl;
+            }
+            tracePhase(("warmup:" + entryPoint).c_str());
+            if (verbose) {
+                long long elapsedMillis = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - entryStartTime).count();
+                cout << "Warm-up entry point " + entryPoint + " took " + to_string(elapsedMillis) + " ms\n" << flush;
+            }
+        }
+
+        if (warmupClass != nullptr) {
+            env->DeleteLocalRef(warmupClass);
+        }
+        if (classNameUTF != nullptr) {
+            env->DeleteLocalRef(classNameUTF);
+        }
+    }
+
+    finishWarmupThread(state, env);
+}
+
+/**
+ * Invokes the static no-argument warm-up methods on up to threadCount daemon threads, concurrently with the main method.
+ *
+ * @param entryPoints warm-up methods as fully qualified class name, a dot, and the method name
+ * @param timeBudget entry points that haven't started after this time are skipped, zero means no budget
+ */
+static void startWarmupEntryPoints(JavaVM *jvm, JNIEnv *env, jobject classLoader, const vector<string> &entryPoints, size_t threadCount,
+                                   chrono::milliseconds timeBudget) {
+    shared_ptr<WarmupState> state = make_shared<WarmupState>();
+    state->jvm = jvm;
+    state->classLoader = env->NewGlobalRef(classLoader);
+    if (state->classLoader == nullptr) {
+        cerr << "Warning: failed to reference the class loader for the warm-up entry points" << endl;
+        return;
+    }
+    state->entryPoints = entryPoints;
+    state->startTime = chrono::steady_clock::now();
+    state->timeBudget = timeBudget;
+
+    threadCount = max((size_t) 1, min(threadCount, entryPoints.size()));
+    state->runningThreads = threadCount;
+    if (verbose) {
+        cout << "Invoking " << entryPoints.size() << " warm-up entry points on " << threadCount << " threads ..." << endl;
+    }
+    for (size_t threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        thread(runWarmupEntryPoints, state).detach();
+    }
+}
+
+/**
+ * Finds the configuration embedded by packr in a single file executable.
+ *
+ * @param executable the mapped executable file
+ * @param configuration receives the start of the JSON configuration inside the mapping
+ * @param configurationLength receives the length of the JSON configuration
+ * @return false if the executable has no payload trailer
+ */
+static bool findEmbeddedConfiguration(const MappedFile &executable, char **configuration, size_t *configurationLength) {
+    if (executable.length < payloadTrailerLength) {
+        return false;
+    }
+    const char *trailer = executable.data + executable.length - payloadTrailerLength;
+    if (memcmp(trailer, payloadTrailerMagic, sizeof(payloadTrailerMagic) - 1) != 0 || trailer[payloadTrailerLength - 1] != '\n') {
+        return false;
+    }
+
+    istringstream numbers(string(trailer + sizeof(payloadTrailerMagic) - 1, payloadTrailerLength - sizeof(payloadTrailerMagic)));
+    unsigned long long offset = 0;
+    unsigned long long length = 0;
+    if (!(numbers >> offset >> length)) {
+        return false;
+    }
+    size_t payloadEnd = executable.length - payloadTrailerLength;
+    if (offset > payloadEnd || length > payloadEnd - offset) {
+        cerr << "Warning: ignoring the corrupt payload trailer of the executable" << endl;
+        return false;
+    }
+
+    *configuration = executable.data + offset;
+    *configurationLength = (size_t) length;
+    return true;
+}
+
+/**
+ * Memory the configuration document is parsed in, sajson parses in place so it has to outlive the document.
+ */
+static MappedFile configurationMapping = {};
+static vector<char> configurationBuffer;
+
 static sajson::document readConfigurationFile(const string &fileName) {
 #ifdef UNICODE
     wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
     wstring fileNameWstring = converter.from_bytes(fileName);
+    const dropt_char *path = fileNameWstring.c_str();
+#else
+    const dropt_char *path = fileName.c_str();
+#endif
+    // a copy-on-write mapping lets sajson parse in place without reading or copying the file
+    if (mapFile(path, true, &configurationMapping)) {
+        return sajson::parse(sajson::mutable_string_view(configurationMapping.length, configurationMapping.data));
+    }
+
+#ifdef UNICODE
     // On Windows, fstream's constructor accepts a wchar_t file name that is unicode.
-    std::fstream in(fileNameWstring.c_str(), std::ios::in | std::ios::binary);
+    std::fstream in(path, std::ios::in | std::ios::binary);
 #else
-    ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+    ifstream in(path, std::ios::in | std::ios::binary);
 #endif
-    string content = string((istreambuf_iterator<char>(in)), (istreambuf_iterator<char>()));
-    sajson::document json = sajson::parse(sajson::literal(content.c_str()));
-    return json;
+    in.seekg(0, ios::end);
+    streamoff size = in.tellg();
+    configurationBuffer.resize(size > 0 ? (size_t) size : 0);
+    in.seekg(0, ios::beg);
+    in.read(configurationBuffer.data(), configurationBuffer.size());
+    configurationBuffer.resize((size_t) max((streamsize) 0, in.gcount()));
+    return sajson::parse(sajson::mutable_string_view(configurationBuffer.size(), configurationBuffer.data()));
 }
 
 static bool hasJsonValue(sajson::value jsonObject, const char *key, sajson::type expectedType) {
@@ -218,6 +752,75 @@ static sajson::value getJsonValue(sajson::value jsonObject, const char *key) {
     return jsonObject.get_object_value(index);
 }
 
+/**
+ * Checks the "minCores", "minMemoryMb", and "cpuFeatures" requirements of a "jreVariants" element against this machine.
+ *
+ * @param variant the "jreVariants" element
+ * @param variantPath the "path" of the variant, used in messages
+ * @return true if the machine satisfies every requirement of the variant
+ */
+static bool isJreVariantSupported(sajson::value variant, const string &variantPath) {
+    if (hasJsonValue(variant, "minCores", sajson::TYPE_INTEGER)) {
+        unsigned int cores = thread::hardware_concurrency();
+        if (cores < (unsigned int) getJsonValue(variant, "minCores").get_integer_value()) {
+            if (verbose) {
+                cout << "Skipping JRE variant " << variantPath << ", only " << cores << " cores are available" << endl;
+            }
+            return false;
+        }
+    }
+
+    if (hasJsonValue(variant, "minMemoryMb", sajson::TYPE_INTEGER)) {
+        unsigned long long memoryMb = getPhysicalMemorySize() / (1024 * 1024);
+        if (memoryMb < (unsigned long long) getJsonValue(variant, "minMemoryMb").get_integer_value()) {
+            if (verbose) {
+                cout << "Skipping JRE variant " << variantPath << ", only " << memoryMb << " MB of memory are available" << endl;
+            }
+            return false;
+        }
+    }
+
+    if (hasJsonValue(variant, "cpuFeatures", sajson::TYPE_ARRAY)) {
+        sajson::value cpuFeatures = getJsonValue(variant, "cpuFeatures");
+        for (size_t featureIndex = 0; featureIndex < cpuFeatures.get_length(); featureIndex++) {
+            const string cpuFeature = cpuFeatures.get_array_element(featureIndex).as_string();
+            if (!hasCpuFeature(cpuFeature.c_str())) {
+                if (verbose) {
+                    cout << "Skipping JRE variant " << variantPath << ", the CPU doesn't support " << cpuFeature << endl;
+                }
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Huge page backed libjvm text requested on the command line, in addition to the "hugePageJvmText" configuration value.
+ */
+static bool hugePageJvmTextFromCommandLine = false;
+
+/**
+ * Loads the JVM runtime library from a JRE directory.
+ *
+ * @param jrePathString UTF-8 encoded path to the JRE directory, a trailing slash is ignored
+ * @param vmType the VM to load, e.g. "server" or "minimal"
+ */
+static bool loadJreFunctions(const string &jrePathString, const string &vmType, GetDefaultJavaVMInitArgs *getDefaultJavaVMInitArgs, CreateJavaVM *createJavaVM) {
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    wstring trimmedJrePathWstring = converter.from_bytes(jrePathString);
+    // Removes trailing slash.
+    if (!trimmedJrePathWstring.empty() && L'/' == trimmedJrePathWstring.back())
+        trimmedJrePathWstring.pop_back();
+#ifdef UNICODE
+    return loadJNIFunctions(trimmedJrePathWstring.c_str(), vmType.c_str(), getDefaultJavaVMInitArgs, createJavaVM);
+#else
+    string trimmedJrePathString = converter.to_bytes(trimmedJrePathWstring);
+    return loadJNIFunctions(trimmedJrePathString.c_str(), vmType.c_str(), getDefaultJavaVMInitArgs, createJavaVM);
+#endif
+}
+
 static vector<string> extractClassPath(const sajson::value &classPath) {
 
     size_t count = classPath.get_length();
@@ -243,106 +846,1519 @@ static vector<string> extractClassPath(const sajson::value &classPath) {
 
                 if (line.find("-classpath") == 0) {
 
-                    txt >> line;
+                    txt >> line;
+
+                    istringstream iss(line);
+                    string path;
+
+                    while (getline(iss, path, __CLASS_PATH_DELIM)) {
+                        paths.push_back(path);
+                    }
+
+                    break;
+                }
+
+            }
+
+            txt.close();
+
+        }
+
+    }
+
+    return paths;
+}
+
+/**
+ * Searches for the last / or \ and returns all prior characters.
+ *
+ * @param executablePath to get the parent directory of
+ * @return the parent directory of {@code executablePath}. The returned string is UTF-8 encoded.
+ */
+string getExecutableDirectory(const dropt_char *executablePath) {
+    const dropt_char *lastSlash = findLastCharacter(executablePath, DROPT_TEXT_LITERAL('/'));
+    if (lastSlash == nullptr) {
+        lastSlash = findLastCharacter(executablePath, DROPT_TEXT_LITERAL('\\'));
+    }
+
+    if (lastSlash != nullptr) {
+#ifdef UNICODE
+        wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+        return converter.to_bytes(executablePath, lastSlash);
+#else
+        return string(executablePath, lastSlash - executablePath);
+#endif
+    }
+
+    return string("");
+}
+
+/**
+ * Finds the last path element by searching for a / or \, all text found after the last / is returned. If a / or \ isn't found then {@code executablePath} is returned UTF-8 encoded in a string.
+ *
+ * @param executablePath the path to find the executable in
+ * @return UTF-8 encoded executable name from {@code executablePath}
+ */
+string getExecutableName(const dropt_char *executablePath) {
+    const dropt_char *delim = findLastCharacter(executablePath, DROPT_TEXT_LITERAL('/'));
+    if (delim == nullptr) {
+        delim = findLastCharacter(executablePath, DROPT_TEXT_LITERAL('\\'));
+    }
+
+    if (delim != nullptr) {
+#ifdef UNICODE
+        wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+        return converter.to_bytes(++delim);
+#else
+        return string(++delim);
+#endif
+    }
+
+#ifdef UNICODE
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    string utf8Path = converter.to_bytes(executablePath);
+    return utf8Path;
+#else
+    return string(executablePath);
+#endif
+}
+
+/**
+ * Strips ".exe" suffix from the executable name and appends ".json".
+ * @param executableName the UTF-8 encoded executable name
+ * @return UTF-8 encoded configuration path
+ */
+string getDefaultConfigurationPath(string& executableName) {
+    wstring_convert<codecvt_utf8_utf16<wchar_t>> converter;
+    wstring executableNameWstring = converter.from_bytes(executableName);
+    wstring exeSuffix = wstring(L".exe");
+    bool hasExeSuffix = executableNameWstring.size() >= exeSuffix.size() &&
+        executableNameWstring.compare(executableNameWstring.size() - exeSuffix.size(),
+            exeSuffix.size(), exeSuffix) == 0;
+    wstring appName;
+    if (hasExeSuffix)
+        appName = executableNameWstring.substr(0, executableNameWstring.size() - exeSuffix.size());
+    else
+        appName = executableNameWstring;
+    wstring defaultConfigurationPath = appName + L".json";
+    return converter.to_bytes(defaultConfigurationPath);
+}
+
+/**
+ * Copies an argument into the argument blocks, the copy stays valid until the launcher exits.
+ */
+static const char *storeArgument(const char *argument, size_t length) {
+    size_t size = length + 1;
+    char *storage;
+    if (size > argumentBlockSize / 4) {
+        // large arguments get their own block, so they don't waste the rest of the current one
+        argumentBlocks.emplace_back(new char[size]);
+        storage = argumentBlocks.back().get();
+    } else {
+        if (argumentBlockUsed + size > argumentBlockSize) {
+            argumentBlocks.emplace_back(new char[argumentBlockSize]);
+            argumentBlock = argumentBlocks.back().get();
+            argumentBlockUsed = 0;
+        }
+        storage = argumentBlock + argumentBlockUsed;
+        argumentBlockUsed += size;
+    }
+    memcpy(storage, argument, length);
+    storage[length] = '\0';
+    return storage;
+}
+
+/**
+ * Splits argument files into arguments like the "java" command does. Arguments are separated by whitespace, and can be quoted with double or
+ * single quotes. In quotes, a backslash escapes the next character, "\n", "\r", "\t", and "\f" are control characters, and a backslash at the
+ * end of a line continues the argument on the next line without its leading whitespace. Lines starting with "#" are comments.
+ *
+ * The file is fed in chunks, an argument or escape sequence may span several chunks.
+ */
+class ArgumentFileTokenizer {
+public:
+    explicit ArgumentFileTokenizer(vector<const char *> &arguments) : arguments(arguments) {
+    }
+
+    void feed(const char *chunk, size_t length) {
+        const char *end = chunk + length;
+        const char *character = chunk;
+        while (character < end) {
+            char c = *character;
+            switch (state) {
+                case BETWEEN:
+                    if (c == '#') {
+                        state = COMMENT;
+                    } else if (!isWhitespace(c)) {
+                        state = UNQUOTED;
+                        continue;
+                    }
+                    break;
+                case COMMENT:
+                    if (c == '\n' || c == '\r') {
+                        state = BETWEEN;
+                    }
+                    break;
+                case UNQUOTED: {
+                    // copies runs of plain characters at once
+                    const char *plain = character;
+                    while (plain < end && !isWhitespace(*plain) && *plain != '"' && *plain != '\'') {
+                        plain++;
+                    }
+                    argument.append(character, plain - character);
+                    character = plain;
+                    if (character == end) {
+                        continue;
+                    }
+                    c = *character;
+                    if (isWhitespace(c)) {
+                        endArgument();
+                    } else {
+                        quote = c;
+                        state = QUOTED;
+                    }
+                    break;
+                }
+                case QUOTED: {
+                    const char *plain = character;
+                    while (plain < end && *plain != quote && *plain != '\\') {
+                        plain++;
+                    }
+                    argument.append(character, plain - character);
+                    character = plain;
+                    if (character == end) {
+                        continue;
+                    }
+                    state = *character == quote ? UNQUOTED : ESCAPED;
+                    break;
+                }
+                case ESCAPED:
+                    state = QUOTED;
+                    if (c == 'n') {
+                        argument.push_back('\n');
+                    } else if (c == 'r') {
+                        argument.push_back('\r');
+                    } else if (c == 't') {
+                        argument.push_back('\t');
+                    } else if (c == 'f') {
+                        argument.push_back('\f');
+                    } else if (c == '\n' || c == '\r') {
+                        state = CONTINUED;
+                    } else {
+                        argument.push_back(c);
+                    }
+                    break;
+                case CONTINUED:
+                    if (!isWhitespace(c)) {
+                        state = QUOTED;
+                        continue;
+                    }
+                    break;
+            }
+            character++;
+        }
+    }
+
+    /**
+     * Ends the last argument.
+     * @return false if it has an unterminated quote
+     */
+    bool finish() {
+        if (state == UNQUOTED) {
+            endArgument();
+        }
+        return state == BETWEEN || state == COMMENT;
+    }
+
+private:
+    enum State {
+        BETWEEN, COMMENT, UNQUOTED, QUOTED, ESCAPED, CONTINUED
+    };
+
+    static bool isWhitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+    }
+
+    void endArgument() {
+        arguments.push_back(storeArgument(argument.data(), argument.size()));
+        // keeps the capacity for the next argument
+        argument.clear();
+        state = BETWEEN;
+    }
+
+    vector<const char *> &arguments;
+    string argument;
+    State state = BETWEEN;
+    char quote = '"';
+};
+
+bool readArgumentFile(const char *path, vector<const char *> &arguments) {
+#ifdef UNICODE
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    FILE *file = _wfopen(converter.from_bytes(path).c_str(), L"rb");
+#else
+    FILE *file = fopen(path, "rb");
+#endif
+    if (file == nullptr) {
+        cerr << "Error: failed to open argument file " << path << endl;
+        return false;
+    }
+
+    ArgumentFileTokenizer tokenizer(arguments);
+    unique_ptr<char[]> chunk(new char[argumentBlockSize]);
+    size_t length;
+    while ((length = fread(chunk.get(), 1, argumentBlockSize, file)) > 0) {
+        tokenizer.feed(chunk.get(), length);
+    }
+    bool readError = ferror(file) != 0;
+    fclose(file);
+
+    if (readError) {
+        cerr << "Error: failed to read argument file " << path << endl;
+        return false;
+    }
+    if (!tokenizer.finish()) {
+        cerr << "Error: unterminated quote in argument file " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Replaces "@file" arguments with the arguments read from the file, "@@" at the start of an argument is passed as a single "@".
+ */
+static void expandArgumentFiles() {
+    vector<const char *> expandedArguments;
+    expandedArguments.reserve(cmdLineArgv.size());
+    for (const char *argument : cmdLineArgv) {
+        if (argument[0] == '@' && argument[1] == '@') {
+            expandedArguments.push_back(argument + 1);
+        } else if (argument[0] == '@' && argument[1] != '\0') {
+            if (verbose) {
+                cout << "Reading argument file " << argument + 1 << " ..." << endl;
+            }
+            if (!readArgumentFile(argument + 1, expandedArguments)) {
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            expandedArguments.push_back(argument);
+        }
+    }
+    cmdLineArgv.swap(expandedArguments);
+}
+
+/**
+ * Collects the "-J" options, which can be passed several times.
+ */
+static dropt_error handleVmOption(dropt_context *context, const dropt_char *optionArgument, void *handlerData) {
+    if (optionArgument == nullptr || optionArgument[0] == '\0') {
+        return dropt_error_insufficient_arguments;
+    }
+#ifdef UNICODE
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    static_cast<vector<string> *>(handlerData)->push_back(converter.to_bytes(optionArgument));
+#else
+    static_cast<vector<string> *>(handlerData)->push_back(optionArgument);
+#endif
+    return dropt_error_none;
+}
+
+/**
+ * Returns what identifies the setting a VM option changes, options with the same key override each other. The key of "-Xmx1G" is "-Xmx", of
+ * "-Dname=value" it is "-Dname", and "-XX:+Name", "-XX:-Name", and "-XX:Name=value" have the key "-XX:Name". The flags selecting a garbage
+ * collector share a key. Other options are only duplicates of identical options.
+ */
+static string getVmOptionKey(const char *option) {
+    string value(option);
+    for (const char *prefix : {"-Xmx", "-Xms", "-Xss", "-Xmn"}) {
+        if (value.compare(0, 4, prefix) == 0) {
+            return prefix;
+        }
+    }
+    if (value.compare(0, 2, "-D") == 0) {
+        return value.substr(0, value.find('='));
+    }
+    if (value.compare(0, 4, "-XX:") == 0) {
+        if (value.size() > 4 && (value[4] == '+' || value[4] == '-')) {
+            string name = value.substr(5);
+            for (const char *collector : {"UseSerialGC", "UseParallelGC", "UseParallelOldGC", "UseParNewGC", "UseConcMarkSweepGC", "UseG1GC",
+                                          "UseZGC", "UseShenandoahGC", "UseEpsilonGC"}) {
+                if (value[4] == '+' && name == collector) {
+                    return "-XX:+Use*GC";
+                }
+            }
+            return "-XX:" + name;
+        }
+        return value.substr(0, value.find('='));
+    }
+    return value;
+}
+
+vector<const char *> mergeVmOptions(const vector<const char *> &options) {
+    vector<const char *> mergedOptions;
+    unordered_set<string> keys;
+    for (auto option = options.rbegin(); option != options.rend(); ++option) {
+        if (keys.insert(getVmOptionKey(*option)).second) {
+            mergedOptions.push_back(*option);
+        } else if (verbose) {
+            cout << "Overridden VM option " << *option << endl;
+        }
+    }
+    reverse(mergedOptions.begin(), mergedOptions.end());
+    return mergedOptions;
+}
+
+/**
+ * Reads the VM options in the PACKR_VM_OPTIONS environment variable, they are separated and quoted like the arguments in an argument file.
+ */
+static void readVmOptionsFromEnvironment(vector<const char *> &options) {
+#ifdef UNICODE
+    const wchar_t *environmentValue = _wgetenv(L"PACKR_VM_OPTIONS");
+    if (environmentValue == nullptr) {
+        return;
+    }
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    string value = converter.to_bytes(environmentValue);
+#else
+    const char *environmentValue = getenv("PACKR_VM_OPTIONS");
+    if (environmentValue == nullptr) {
+        return;
+    }
+    string value(environmentValue);
+#endif
+    ArgumentFileTokenizer tokenizer(options);
+    tokenizer.feed(value.data(), value.size());
+    if (!tokenizer.finish()) {
+        cerr << "Error: unterminated quote in PACKR_VM_OPTIONS" << endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+static bool createUtf8Directory(const string &directory) {
+#ifdef UNICODE
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    return createDirectory(converter.from_bytes(directory).c_str());
+#else
+    return createDirectory(directory.c_str());
+#endif
+}
+
+/**
+ * @return the UTF-8 encoded directory for temporary files
+ */
+static string getTemporaryDirectory() {
+#ifdef UNICODE
+    const wchar_t *temporaryDirectory = _wgetenv(L"TEMP");
+    if (temporaryDirectory == nullptr || temporaryDirectory[0] == L'\0') {
+        return ".";
+    }
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    return converter.to_bytes(temporaryDirectory);
+#else
+    const char *temporaryDirectory = getenv("TMPDIR");
+    if (temporaryDirectory == nullptr || temporaryDirectory[0] == '\0') {
+        return "/tmp";
+    }
+    return temporaryDirectory;
+#endif
+}
+
+vector<string> getProfileVmOptions(const string &runDirectory, int maxRecordingSizeMb) {
+    // the JVM expands "%p" in log and crash file names, and a '"' would end the quoted paths
+    if (runDirectory.find_first_of("\"%") != string::npos) {
+        return {};
+    }
+    // quoted, since -Xlog splits its options at ':' and ',', and the flight recorder at ',' and '='
+    auto quotedPath = [&](int profileFile) {
+        return "\"" + runDirectory + "/" + profileFiles[profileFile][1] + "\"";
+    };
+    vector<string> options;
+    const string logRotation = ":filecount=5,filesize=10m";
+    options.push_back("-Xlog:class+load=info:file=" + quotedPath(0) + ":uptime,tid" + logRotation);
+    options.push_back("-Xlog:startuptime=info:file=" + quotedPath(1) + ":uptime" + logRotation);
+    options.push_back("-Xlog:safepoint=info:file=" + quotedPath(2) + ":uptime" + logRotation);
+    // the repository drops its oldest chunks beyond maxsize, smaller chunks make that rotation finer
+    options.push_back("-XX:FlightRecorderOptions=repository=" + quotedPath(4) + ",maxchunksize=" + to_string(max(1, maxRecordingSizeMb / 8)) + "m");
+    // dumponexit also dumps the recording when Java calls System.exit() or main() throws
+    options.push_back("-XX:StartFlightRecording=name=packr-profile,settings=default,disk=true,dumponexit=true,maxsize=" + to_string(maxRecordingSizeMb)
+                      + "m,filename=" + quotedPath(3));
+    // a plain path, which the JVM doesn't split
+    options.push_back("-XX:ErrorFile=" + runDirectory + "/" + profileFiles[5][1]);
+    return options;
+}
+
+/**
+ * Creates the directory of this run's diagnostics profile, and adds the VM options that record class loading, startup, safepoints, and a continuous
+ * flight recording into it. Logs rotate through 5 files of 10 MB each, the flight recording keeps at most "maxRecordingSizeMb" of the most recent
+ * data. Older JVMs ignore the options they don't know.
+ *
+ * @return false if profiling is off or the directory can't be created
+ */
+static bool startProfile(sajson::value jsonRoot, vector<const char *> &vmOptions) {
+    bool hasProfileSection = hasJsonValue(jsonRoot, "profile", sajson::TYPE_OBJECT);
+    const sajson::value profile = hasProfileSection ? getJsonValue(jsonRoot, "profile") : jsonRoot;
+    if (!profileFromCommandLine && !(hasProfileSection && hasJsonValue(profile, "enabled", sajson::TYPE_TRUE))) {
+        return false;
+    }
+
+    string baseDirectory = getTemporaryDirectory() + "/packr-profiles";
+    if (hasProfileSection && hasJsonValue(profile, "directory", sajson::TYPE_STRING)) {
+        baseDirectory = getJsonValue(profile, "directory").as_string();
+    }
+    int maxRecordingSizeMb = 100;
+    if (hasProfileSection && hasJsonValue(profile, "maxRecordingSizeMb", sajson::TYPE_INTEGER)) {
+        maxRecordingSizeMb = max(1, getJsonValue(profile, "maxRecordingSizeMb").get_integer_value());
+    }
+
+    profileStartTime = chrono::system_clock::now();
+    time_t startTime = chrono::system_clock::to_time_t(profileStartTime);
+    char timestamp[32];
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&startTime));
+    string runDirectory = baseDirectory + "/" + executableName + "-" + timestamp + "-" + to_string(getProcessId());
+    vector<string> options = getProfileVmOptions(runDirectory, maxRecordingSizeMb);
+    if (options.empty()) {
+        cerr << "Warning: the JVM can't write a profile to " << runDirectory << ", a path with '\"' or '%' isn't supported, profiling is off" << endl;
+        return false;
+    }
+    if (!createUtf8Directory(baseDirectory) || !createUtf8Directory(runDirectory)) {
+        cerr << "Warning: failed to create the profile directory " << runDirectory << ", profiling is off" << endl;
+        return false;
+    }
+    profileDirectory = runDirectory;
+    cout << "Recording a diagnostics profile to " << profileDirectory << endl;
+
+    // the index lists the options when the JVM exits, so they're kept apart from the launcher memory released before main()
+    profileVmOptions = options;
+    for (const string &option : profileVmOptions) {
+        vmOptions.push_back(option.c_str());
+    }
+    return true;
+}
+
+static void writeJsonString(ostream &out, const string &value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char) c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", (unsigned int) c);
+            out << escape;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+/**
+ * Writes the traced phases as a JSON array.
+ *
+ * @param elementPrefix written before each element, e.g. a newline and indentation
+ * @param endPrefix written before the closing bracket of a non-empty array
+ */
+static void writePhasesJson(ostream &out, const char *elementPrefix, const char *endPrefix) {
+    lock_guard<mutex> lock(tracedPhasesMutex);
+    out << '[';
+    for (size_t phaseIndex = 0; phaseIndex < tracedPhases.size(); phaseIndex++) {
+        out << (phaseIndex == 0 ? "" : ",") << elementPrefix << "{\"name\": ";
+        writeJsonString(out, tracedPhases[phaseIndex].name);
+        out << ", \"elapsedMicros\": " << tracedPhases[phaseIndex].elapsedMicros << ", \"epochMicros\": " << tracedPhases[phaseIndex].epochMicros << "}";
+    }
+    out << (tracedPhases.empty() ? "" : endPrefix) << ']';
+}
+
+/**
+ * Writes "index.json" into the profile directory, which describes how the run ended and lists the files of the profile. Only the first call writes
+ * it, the JVM exit hooks may race with the end of the main method.
+ *
+ * @param exitReason "returned" or "exception" after main(), "exit" for System.exit(), or "abort" for a crash
+ */
+static void writeProfileIndex(const char *exitReason, int exitCode) {
+    if (profileDirectory.empty() || profileIndexWritten.exchange(true)) {
+        return;
+    }
+    string indexPath = profileDirectory + "/index.json";
+#ifdef UNICODE
+    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    std::fstream out(converter.from_bytes(indexPath), std::ios::out | std::ios::binary | std::ios::trunc);
+#else
+    ofstream out(indexPath, std::ios::out | std::ios::binary | std::ios::trunc);
+#endif
+    if (!out) {
+        cerr << "Warning: failed to write the profile index " << indexPath << endl;
+        return;
+    }
+
+    time_t startTime = chrono::system_clock::to_time_t(profileStartTime);
+    char started[32];
+    strftime(started, sizeof(started), "%Y-%m-%dT%H:%M:%SZ", gmtime(&startTime));
+    auto duration = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - profileStartTime);
+
+    out << "{\n  \"executable\": ";
+    writeJsonString(out, executableName);
+    out << ",\n  \"pid\": " << getProcessId();
+    out << ",\n  \"started\": \"" << started << "\"";
+    out << ",\n  \"durationMs\": " << duration.count();
+    out << ",\n  \"exit\": \"" << exitReason << "\"";
+    out << ",\n  \"exitCode\": " << exitCode;
+    out << ",\n  \"vmOptions\": [";
+    for (size_t optionIndex = 0; optionIndex < profileVmOptions.size(); optionIndex++) {
+        out << (optionIndex == 0 ? "\n    " : ",\n    ");
+        writeJsonString(out, profileVmOptions[optionIndex]);
+    }
+    out << "\n  ],\n  \"phases\": ";
+    writePhasesJson(out, "\n    ", "\n  ");
+    out << ",\n  \"files\": {";
+    for (size_t fileIndex = 0; fileIndex < sizeof(profileFiles) / sizeof(profileFiles[0]); fileIndex++) {
+        out << (fileIndex == 0 ? "\n    \"" : ",\n    \"") << profileFiles[fileIndex][0] << "\": \"" << profileFiles[fileIndex][1] << "\"";
+    }
+    out << "\n  }\n}\n";
+}
+
+/**
+ * When main() returned and the JVM started shutting down.
+ */
+static chrono::steady_clock::time_point shutdownStartTime;
+
+/**
+ * Set when the "shutdownPolicy" called System.exit() because non-daemon threads kept the JVM alive.
+ */
+static atomic<bool> shutdownForced(false);
+
+/**
+ * Called by the JVM when Java calls System.exit(), after the shutdown hooks ran and the flight recording was dumped.
+ */
+static void JNICALL vmExitHook(jint code) {
+    if (shutdownForced) {
+        cerr << "Shutdown took " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - shutdownStartTime).count()
+             << " ms, exiting with status " << code << endl;
+    }
+    writeProfileIndex("exit", code);
+}
+
+/**
+ * Called by the JVM when it aborts after a fatal error. The flight recording repository and the crash log are in the profile directory.
+ */
+static void JNICALL profileAbortHook() {
+    writeProfileIndex("abort", -1);
+}
+
+/**
+ * Control socket requested on the command line, in addition to the "controlSocket" configuration value.
+ */
+static bool controlSocketFromCommandLine = false;
+
+/**
+ * JVM created by this process, set once JNI_CreateJavaVM returned, for the launcher's background threads.
+ */
+static atomic<JavaVM *> createdJvm(nullptr);
+
+/**
+ * Makes the JNI calls of one control socket request. Once a call throws, the exception becomes the error of the request, and the following calls
+ * return null without calling Java, so a request checks for failure once at its end.
+ */
+class ControlRequest {
+public:
+    explicit ControlRequest(JNIEnv *env) : env(env) {
+    }
+
+    bool failed() const {
+        return !error.empty();
+    }
+
+    const string &getError() const {
+        return error;
+    }
+
+    jobject callStatic(const char *className, const char *methodName, const char *signature) {
+        if (failed()) {
+            return nullptr;
+        }
+        jclass javaClass = env->FindClass(className);
+        jmethodID method = javaClass != nullptr ? env->GetStaticMethodID(javaClass, methodName, signature) : nullptr;
+        return check(method != nullptr ? env->CallStaticObjectMethod(javaClass, method) : nullptr);
+    }
+
+    void callStaticVoid(const char *className, const char *methodName, const char *signature, ...) {
+        if (failed()) {
+            return;
+        }
+        jclass javaClass = env->FindClass(className);
+        jmethodID method = javaClass != nullptr ? env->GetStaticMethodID(javaClass, methodName, signature) : nullptr;
+        if (check(method) != nullptr) {
+            va_list arguments;
+            va_start(arguments, signature);
+            env->CallStaticVoidMethodV(javaClass, method, arguments);
+            va_end(arguments);
+            checkException();
+        }
+    }
+
+    void callVoid(jobject object, const char *methodName, const char *signature, ...) {
+        jmethodID method = getMethod(object, methodName, signature);
+        if (method != nullptr) {
+            va_list arguments;
+            va_start(arguments, signature);
+            env->CallVoidMethodV(object, method, arguments);
+            va_end(arguments);
+            checkException();
+        }
+    }
+
+    jobject call(jobject object, const char *methodName, const char *signature, ...) {
+        va_list arguments;
+        va_start(arguments, signature);
+        jobject result = callObject(object, methodName, signature, arguments, false);
+        va_end(arguments);
+        return result;
+    }
+
+    /**
+     * Like call(), for methods that return null, e.g. MBeanServer.invoke() of an operation without a result.
+     */
+    jobject callAllowingNull(jobject object, const char *methodName, const char *signature, ...) {
+        va_list arguments;
+        va_start(arguments, signature);
+        jobject result = callObject(object, methodName, signature, arguments, true);
+        va_end(arguments);
+        return result;
+    }
+
+    jlong callLong(jobject object, const char *methodName) {
+        jmethodID method = getMethod(object, methodName, "()J");
+        jlong result = method != nullptr ? env->CallLongMethod(object, method) : 0;
+        check(method);
+        return result;
+    }
+
+    bool callBoolean(jobject object, const char *methodName) {
+        jmethodID method = getMethod(object, methodName, "()Z");
+        jboolean result = method != nullptr ? env->CallBooleanMethod(object, method) : JNI_FALSE;
+        check(method);
+        return result == JNI_TRUE;
+    }
+
+    jint callInt(jobject object, const char *methodName) {
+        jmethodID method = getMethod(object, methodName, "()I");
+        jint result = method != nullptr ? env->CallIntMethod(object, method) : 0;
+        check(method);
+        return result;
+    }
+
+    string callString(jobject object, const char *methodName) {
+        return toString((jstring) call(object, methodName, "()Ljava/lang/String;"));
+    }
+
+    jobject newObject(const char *className, const char *signature, ...) {
+        if (failed()) {
+            return nullptr;
+        }
+        jclass javaClass = env->FindClass(className);
+        jmethodID constructor = javaClass != nullptr ? env->GetMethodID(javaClass, "<init>", signature) : nullptr;
+        if (check(constructor) == nullptr) {
+            return nullptr;
+        }
+        va_list arguments;
+        va_start(arguments, signature);
+        jobject result = env->NewObjectV(javaClass, constructor, arguments);
+        va_end(arguments);
+        return check(result);
+    }
+
+    jobjectArray newArray(const char *elementClassName, const vector<jobject> &elements) {
+        if (failed()) {
+            return nullptr;
+        }
+        jclass elementClass = env->FindClass(elementClassName);
+        jobjectArray array = elementClass != nullptr ? env->NewObjectArray((jsize) elements.size(), elementClass, nullptr) : nullptr;
+        for (size_t index = 0; array != nullptr && index < elements.size(); index++) {
+            env->SetObjectArrayElement(array, (jsize) index, elements[index]);
+        }
+        return (jobjectArray) check(array);
+    }
+
+    jsize getArrayLength(jobjectArray array) {
+        return failed() || check(array) == nullptr ? 0 : env->GetArrayLength(array);
+    }
+
+    jobject getArrayElement(jobjectArray array, jsize index) {
+        return failed() ? nullptr : check(env->GetObjectArrayElement(array, index));
+    }
+
+    jstring newString(const string &value) {
+        return failed() ? nullptr : (jstring) check(env->NewStringUTF(value.c_str()));
+    }
+
+private:
+    jobject callObject(jobject object, const char *methodName, const char *signature, va_list arguments, bool allowNull) {
+        jmethodID method = getMethod(object, methodName, signature);
+        if (method == nullptr) {
+            return nullptr;
+        }
+        jobject result = env->CallObjectMethodV(object, method, arguments);
+        if (allowNull) {
+            return checkException() ? result : nullptr;
+        }
+        return check(result);
+    }
+
+    jmethodID getMethod(jobject object, const char *methodName, const char *signature) {
+        if (failed() || check(object) == nullptr) {
+            return nullptr;
+        }
+        return check(env->GetMethodID(env->GetObjectClass(object), methodName, signature));
+    }
+
+    template<typename T>
+    T check(T result) {
+        if (!checkException()) {
+            return nullptr;
+        }
+        if (result == nullptr && !failed()) {
+            error = "Java returned null";
+        }
+        return result;
+    }
+
+    /**
+     * @return false if a Java exception was pending, which becomes the error of the request
+     */
+    bool checkException() {
+        if (env->ExceptionCheck()) {
+            jthrowable exception = env->ExceptionOccurred();
+            env->ExceptionClear();
+            error = "Java exception";
+            jmethodID toStringMethod = env->GetMethodID(env->FindClass("java/lang/Object"), "toString", "()Ljava/lang/String;");
+            jstring description = (jstring) env->CallObjectMethod(exception, toStringMethod);
+            if (env->ExceptionCheck()) {
+                env->ExceptionClear();
+            } else if (description != nullptr) {
+                error = toString(description);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    string toString(jstring value) {
+        if (value == nullptr) {
+            return string();
+        }
+        const char *utf = env->GetStringUTFChars(value, nullptr);
+        string result = utf != nullptr ? utf : "";
+        env->ReleaseStringUTFChars(value, utf);
+        return result;
+    }
+
+    JNIEnv *env;
+    string error;
+};
+
+static void writeMemoryUsageJson(ostream &out, ControlRequest &request, jobject memoryUsage) {
+    out << "{\"used\": " << request.callLong(memoryUsage, "getUsed") << ", \"committed\": " << request.callLong(memoryUsage, "getCommitted")
+        << ", \"max\": " << request.callLong(memoryUsage, "getMax") << "}";
+}
+
+static void writeUptimeJson(ostream &out, ControlRequest &request) {
+    jobject runtime = request.callStatic("java/lang/management/ManagementFactory", "getRuntimeMXBean", "()Ljava/lang/management/RuntimeMXBean;");
+    out << "\"launcherUptimeMs\": " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - launcherStartTime).count()
+        << ", \"jvmUptimeMs\": " << request.callLong(runtime, "getUptime");
+}
+
+static void writeHeapJson(ostream &out, ControlRequest &request) {
+    jobject memory = request.callStatic("java/lang/management/ManagementFactory", "getMemoryMXBean", "()Ljava/lang/management/MemoryMXBean;");
+    out << "\"heap\": ";
+    writeMemoryUsageJson(out, request, request.call(memory, "getHeapMemoryUsage", "()Ljava/lang/management/MemoryUsage;"));
+    out << ", \"nonHeap\": ";
+    writeMemoryUsageJson(out, request, request.call(memory, "getNonHeapMemoryUsage", "()Ljava/lang/management/MemoryUsage;"));
+}
+
+static void writeGcJson(ostream &out, ControlRequest &request) {
+    jobject collectors = request.callStatic("java/lang/management/ManagementFactory", "getGarbageCollectorMXBeans", "()Ljava/util/List;");
+    jint collectorCount = request.callInt(collectors, "size");
+    out << "\"garbageCollectors\": [";
+    for (jint index = 0; index < collectorCount && !request.failed(); index++) {
+        jobject collector = request.call(collectors, "get", "(I)Ljava/lang/Object;", index);
+        out << (index == 0 ? "{\"name\": " : ", {\"name\": ");
+        writeJsonString(out, request.callString(collector, "getName"));
+        out << ", \"count\": " << request.callLong(collector, "getCollectionCount") << ", \"timeMs\": " << request.callLong(collector, "getCollectionTime")
+            << "}";
+    }
+    out << "]";
+}
+
+static void writeThreadsJson(ostream &out, ControlRequest &request) {
+    jobject threads = request.callStatic("java/lang/management/ManagementFactory", "getThreadMXBean", "()Ljava/lang/management/ThreadMXBean;");
+    out << "\"threads\": {\"count\": " << request.callInt(threads, "getThreadCount") << ", \"daemon\": " << request.callInt(threads, "getDaemonThreadCount")
+        << ", \"peak\": " << request.callInt(threads, "getPeakThreadCount") << "}";
+}
+
+/**
+ * Invokes an operation of a platform MBean, e.g. of com.sun.management:type=HotSpotDiagnostic.
+ *
+ * @param parameterTypes the class names of the operation's parameters, e.g. "java.lang.String"
+ * @return the result of the operation, null for an operation without a result
+ */
+static jobject invokeMBeanOperation(ControlRequest &request, const char *objectName, const char *operation, const vector<jobject> &parameters,
+                                    const vector<const char *> &parameterTypes) {
+    jobject server = request.callStatic("java/lang/management/ManagementFactory", "getPlatformMBeanServer", "()Ljavax/management/MBeanServer;");
+    jobject name = request.newObject("javax/management/ObjectName", "(Ljava/lang/String;)V", request.newString(objectName));
+    vector<jobject> types;
+    for (const char *parameterType : parameterTypes) {
+        types.push_back(request.newString(parameterType));
+    }
+    return request.callAllowingNull(server, "invoke",
+                                    "(Ljavax/management/ObjectName;Ljava/lang/String;[Ljava/lang/Object;[Ljava/lang/String;)Ljava/lang/Object;", name,
+                                    request.newString(operation), request.newArray("java/lang/Object", parameters),
+                                    request.newArray("java/lang/String", types));
+}
+
+/**
+ * Invokes a diagnostic command of the JVM, the same that jcmd sends, through the DiagnosticCommand MBean of the jdk.management module.
+ *
+ * @param operation the MBean operation, e.g. "threadPrint" for jcmd's Thread.print
+ * @return the output of the command
+ */
+static string invokeDiagnosticCommand(ControlRequest &request, const char *operation, const vector<string> &arguments) {
+    vector<jobject> commandArguments;
+    for (const string &argument : arguments) {
+        commandArguments.push_back(request.newString(argument));
+    }
+    jobject result = invokeMBeanOperation(request, "com.sun.management:type=DiagnosticCommand", operation,
+                                          {request.newArray("java/lang/String", commandArguments)}, {"[Ljava.lang.String;"});
+    return request.callString(result, "toString");
+}
+
+/**
+ * Attaches the calling background thread to the created JVM as a daemon, unless it's attached already.
+ *
+ * @return nullptr if there's no JVM or attaching failed
+ */
+static JNIEnv *attachBackgroundThread(const char *threadName) {
+    JavaVM *jvm = createdJvm;
+    JNIEnv *env = nullptr;
+    if (jvm == nullptr) {
+        return nullptr;
+    }
+    if (jvm->GetEnv((void **) &env, JNI_VERSION_1_6) == JNI_EDETACHED) {
+        JavaVMAttachArgs attachArguments = {JNI_VERSION_1_6, (char *) threadName, nullptr};
+        if (jvm->AttachCurrentThreadAsDaemon((void **) &env, &attachArguments) != JNI_OK) {
+            return nullptr;
+        }
+    }
+    return env;
+}
+
+/**
+ * Watches the "startupDeadlines" of the configuration, which map phase names to the milliseconds the launcher may take to reach them, e.g.
+ * {"jvm-created": 2000, "ready": 10000}. When a phase misses its deadline, the watchdog writes the reached phases, the native stacks of the launcher,
+ * and a Java thread dump to a file, and the application keeps running. The time a standby process waits for the supervisor doesn't count.
+ */
+class StartupWatchdog {
+public:
+    StartupWatchdog(const vector<pair<string, chrono::milliseconds>> &deadlines, chrono::steady_clock::time_point start)
+            : deadlines(deadlines), start(start) {
+    }
+
+    void pause() {
+        lock_guard<mutex> lock(stateMutex);
+        paused = true;
+        pauseStart = chrono::steady_clock::now();
+    }
+
+    void resume() {
+        lock_guard<mutex> lock(stateMutex);
+        pausedDuration += chrono::steady_clock::now() - pauseStart;
+        paused = false;
+        resumed.notify_all();
+    }
+
+    void run() {
+        for (const auto &deadline : deadlines) {
+            unique_lock<mutex> lock(stateMutex);
+            for (;;) {
+                chrono::steady_clock::duration remaining = deadline.second - (chrono::steady_clock::now() - start - pausedDuration);
+                if (paused) {
+                    resumed.wait(lock);
+                } else if (remaining > chrono::steady_clock::duration::zero()) {
+                    resumed.wait_for(lock, remaining);
+                } else {
+                    break;
+                }
+            }
+            lock.unlock();
+            if (!hasTracedPhase(deadline.first)) {
+                writeStallReport(deadline.first, deadline.second);
+            }
+        }
+    }
+
+private:
+    static bool hasTracedPhase(const string &phase) {
+        lock_guard<mutex> lock(tracedPhasesMutex);
+        return any_of(tracedPhases.begin(), tracedPhases.end(), [&phase](const TracedPhase &traced) { return traced.name == phase; });
+    }
+
+    static void writeStallReport(const string &phase, chrono::milliseconds deadline) {
+        string reportPath = (profileDirectory.empty() ? getTemporaryDirectory() + "/packr-" + executableName + "-" + to_string(getProcessId()) + "-"
+                                                      : profileDirectory + "/") + "stall-" + phase + ".txt";
+#ifdef UNICODE
+        wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+        std::fstream out(converter.from_bytes(reportPath), std::ios::out | std::ios::binary | std::ios::trunc);
+#else
+        ofstream out(reportPath, std::ios::out | std::ios::binary | std::ios::trunc);
+#endif
+        cerr << "Warning: startup phase '" << phase << "' missed its deadline of " << deadline.count() << " ms, writing diagnostics to " << reportPath
+             << endl;
+        if (!out) {
+            cerr << "Warning: failed to write " << reportPath << endl;
+            return;
+        }
+
+        out << "Startup phase '" << phase << "' missed its deadline of " << deadline.count() << " ms in " << executableName << ", process "
+            << getProcessId() << "\n\nReached phases:\n";
+        {
+            lock_guard<mutex> lock(tracedPhasesMutex);
+            for (const TracedPhase &traced : tracedPhases) {
+                out << "  " << traced.name << " after " << traced.elapsedMicros / 1000 << " ms\n";
+            }
+        }
+
+        // the native stacks come first, attaching to a JVM that hangs in a safepoint could block
+        out << "\nNative stacks:\n";
+        if (!writeNativeStacks(out)) {
+            out << "  (not available on this platform)\n";
+        }
+        out.flush();
+
+        out << "\nJava threads:\n";
+        JNIEnv *env = attachBackgroundThread("packr-watchdog");
+        if (env == nullptr) {
+            out << "  (the JVM isn't created yet)\n";
+        } else if (env->PushLocalFrame(64) != JNI_OK) {
+            env->ExceptionClear();
+            out << "  (out of memory)\n";
+        } else {
+            ControlRequest request(env);
+            string threadDump = invokeDiagnosticCommand(request, "threadPrint", {"-l"});
+            out << (request.failed() ? "  (" + request.getError() + ")\n" : threadDump);
+            env->PopLocalFrame(nullptr);
+        }
+    }
+
+    const vector<pair<string, chrono::milliseconds>> deadlines;
+    const chrono::steady_clock::time_point start;
+    mutex stateMutex;
+    condition_variable resumed;
+    bool paused = false;
+    chrono::steady_clock::time_point pauseStart;
+    chrono::steady_clock::duration pausedDuration = chrono::steady_clock::duration::zero();
+};
+
+/**
+ * Watchdog of this process, it's never destroyed since its thread may still wait when the launcher exits.
+ */
+static StartupWatchdog *startupWatchdog = nullptr;
+
+/**
+ * Starts watching the "startupDeadlines" of the configuration that haven't been reached yet, measured from start.
+ */
+static void startStartupWatchdog(sajson::value jsonRoot, chrono::steady_clock::time_point start) {
+    if (!hasJsonValue(jsonRoot, "startupDeadlines", sajson::TYPE_OBJECT)) {
+        return;
+    }
+    sajson::value startupDeadlines = getJsonValue(jsonRoot, "startupDeadlines");
+    vector<pair<string, chrono::milliseconds>> deadlines;
+    for (size_t deadlineIndex = 0; deadlineIndex < startupDeadlines.get_length(); deadlineIndex++) {
+        const string phase = startupDeadlines.get_object_key(deadlineIndex).as_string();
+        sajson::value deadline = startupDeadlines.get_object_value(deadlineIndex);
+        if (deadline.get_type() != sajson::TYPE_INTEGER || deadline.get_integer_value() <= 0) {
+            cerr << "Warning: ignoring the startup deadline of '" << phase << "', it isn't a positive number of milliseconds" << endl;
+            continue;
+        }
+        deadlines.emplace_back(phase, chrono::milliseconds(deadline.get_integer_value()));
+    }
+    if (deadlines.empty()) {
+        return;
+    }
+    sort(deadlines.begin(), deadlines.end(),
+         [](const pair<string, chrono::milliseconds> &first, const pair<string, chrono::milliseconds> &second) { return first.second < second.second; });
+
+    startupWatchdog = new StartupWatchdog(deadlines, start);
+    thread([]() { startupWatchdog->run(); }).detach();
+}
+
+/**
+ * Thresholds of the "memoryPressure" section of the configuration.
+ */
+struct MemoryPressurePolicy {
+    double highPercent;
+    double lowPercent;
+    int softMaxHeapPercent;
+    long long periodicGcIntervalMs;
+    chrono::milliseconds interval;
+};
+
+static const char *const hotSpotDiagnostic = "com.sun.management:type=HotSpotDiagnostic";
+
+/**
+ * Reads a VM flag through the HotSpotDiagnostic MBean.
+ *
+ * @return the value, empty if the JVM doesn't have the flag
+ */
+static string getVmFlag(JNIEnv *env, const char *flag) {
+    ControlRequest request(env);
+    jobject option = invokeMBeanOperation(request, hotSpotDiagnostic, "getVMOption", {request.newString(flag)}, {"java.lang.String"});
+    string value = request.callString(request.call(option, "get", "(Ljava/lang/String;)Ljava/lang/Object;", request.newString("value")), "toString");
+    return request.failed() ? string() : value;
+}
+
+/**
+ * Sets a manageable VM flag through the HotSpotDiagnostic MBean.
+ *
+ * @return the previous value, empty if the JVM doesn't have the flag or can't change it at run time
+ */
+static string setManageableVmFlag(JNIEnv *env, const char *flag, const string &value) {
+    string previousValue = getVmFlag(env, flag);
+    if (previousValue.empty()) {
+        if (verbose) {
+            cout << "Can't set " << flag << ", the JVM doesn't have it" << endl;
+        }
+        return string();
+    }
+    ControlRequest request(env);
+    invokeMBeanOperation(request, hotSpotDiagnostic, "setVMOption", {request.newString(flag), request.newString(value)},
+                         {"java.lang.String", "java.lang.String"});
+    if (request.failed()) {
+        if (verbose) {
+            cout << "Can't set " << flag << ": " << request.getError() << endl;
+        }
+        return string();
+    }
+    return previousValue;
+}
+
+/**
+ * Lowers the JVM's soft maximum heap size with ZGC and Shenandoah, lets G1 collect periodically, and collects garbage, so the heap shrinks and
+ * returns memory to the system. The flags that are changed are added to changedFlags with their previous values.
+ */
+static void relieveMemoryPressure(const MemoryPressurePolicy &policy, vector<pair<const char *, string>> &changedFlags) {
+    JNIEnv *env = attachBackgroundThread("packr-memory");
+    if (env == nullptr || env->PushLocalFrame(64) != JNI_OK) {
+        return;
+    }
+    if (changedFlags.empty()) {
+        ControlRequest request(env);
+        jlong maxHeapSize = request.callLong(request.callStatic("java/lang/Runtime", "getRuntime", "()Ljava/lang/Runtime;"), "maxMemory");
+        // each flag is only set for the collectors that honor it, the other collectors would ignore it
+        bool useG1 = getVmFlag(env, "UseG1GC") == "true";
+        bool honorsSoftMaxHeapSize = getVmFlag(env, "UseZGC") == "true" || getVmFlag(env, "UseShenandoahGC") == "true";
+        vector<pair<const char *, string>> flags;
+        if (policy.softMaxHeapPercent > 0 && honorsSoftMaxHeapSize && !request.failed()) {
+            flags.emplace_back("SoftMaxHeapSize", to_string(maxHeapSize / 100 * policy.softMaxHeapPercent));
+        }
+        if (policy.periodicGcIntervalMs > 0 && useG1) {
+            flags.emplace_back("G1PeriodicGCInterval", to_string(policy.periodicGcIntervalMs));
+        }
+        for (const auto &flag : flags) {
+            string previousValue = setManageableVmFlag(env, flag.first, flag.second);
+            if (!previousValue.empty()) {
+                changedFlags.emplace_back(flag.first, previousValue);
+                if (verbose) {
+                    cout << "Memory pressure, changed " << flag.first << " from " << previousValue << " to " << flag.second << endl;
+                }
+            }
+        }
+    }
+    ControlRequest request(env);
+    request.callStaticVoid("java/lang/System", "gc", "()V");
+    env->PopLocalFrame(nullptr);
+}
+
+static void restoreAfterMemoryPressure(vector<pair<const char *, string>> &changedFlags) {
+    JNIEnv *env = attachBackgroundThread("packr-memory");
+    if (env == nullptr || env->PushLocalFrame(64) != JNI_OK) {
+        return;
+    }
+    for (const auto &flag : changedFlags) {
+        setManageableVmFlag(env, flag.first, flag.second);
+        if (verbose) {
+            cout << "Memory pressure subsided, restored " << flag.first << " to " << flag.second << endl;
+        }
+    }
+    changedFlags.clear();
+    env->PopLocalFrame(nullptr);
+}
+
+/**
+ * Polls the memory pressure while the application runs. When the share of time tasks stall on memory reaches "highPercent", or the cgroup hits its
+ * memory limit, the heap is shrunk, and garbage is collected again whenever the limit is hit while the pressure lasts. Once the pressure falls to
+ * "lowPercent", the flags are restored.
+ */
+static void watchMemoryPressure(const MemoryPressurePolicy &policy, unsigned long long limitEvents) {
+    bool relieving = false;
+    vector<pair<const char *, string>> changedFlags;
+    for (;;) {
+        this_thread::sleep_for(policy.interval);
+        MemoryPressure pressure;
+        if (!readMemoryPressure(&pressure)) {
+            return;
+        }
+        bool hitLimit = pressure.limitEvents > limitEvents;
+        limitEvents = pressure.limitEvents;
+        if (pressure.someAvg10 >= policy.highPercent || hitLimit) {
+            if (!relieving || hitLimit) {
+                if (verbose) {
+                    cout << "Memory pressure " << pressure.someAvg10 << "%" << (hitLimit ? " and the cgroup hit its memory limit" : "")
+                         << ", collecting garbage ..." << endl;
+                }
+                relieveMemoryPressure(policy, changedFlags);
+            }
+            relieving = true;
+        } else if (relieving && pressure.someAvg10 <= policy.lowPercent) {
+            restoreAfterMemoryPressure(changedFlags);
+            relieving = false;
+        }
+    }
+}
 
-                    istringstream iss(line);
-                    string path;
+static double getJsonNumber(sajson::value jsonObject, const char *key, double defaultValue) {
+    if (hasJsonValue(jsonObject, key, sajson::TYPE_INTEGER) || hasJsonValue(jsonObject, key, sajson::TYPE_DOUBLE)) {
+        return getJsonValue(jsonObject, key).get_number_value();
+    }
+    return defaultValue;
+}
 
-                    while (getline(iss, path, __CLASS_PATH_DELIM)) {
-                        paths.push_back(path);
-                    }
+/**
+ * Starts watching the memory pressure if the "memoryPressure" section of the configuration is enabled and the platform reports it.
+ */
+static void startMemoryPressureWatcher(sajson::value jsonRoot) {
+    if (!hasJsonValue(jsonRoot, "memoryPressure", sajson::TYPE_OBJECT)) {
+        return;
+    }
+    const sajson::value section = getJsonValue(jsonRoot, "memoryPressure");
+    if (!hasJsonValue(section, "enabled", sajson::TYPE_TRUE)) {
+        return;
+    }
+    MemoryPressure pressure;
+    if (!readMemoryPressure(&pressure)) {
+        if (verbose) {
+            cout << "Memory pressure isn't reported on this system, not watching it" << endl;
+        }
+        return;
+    }
 
-                    break;
-                }
+    MemoryPressurePolicy policy;
+    policy.highPercent = getJsonNumber(section, "highPercent", 10);
+    policy.lowPercent = min(policy.highPercent, getJsonNumber(section, "lowPercent", 2));
+    policy.softMaxHeapPercent = (int) max(0.0, min(100.0, getJsonNumber(section, "softMaxHeapPercent", 50)));
+    policy.periodicGcIntervalMs = (long long) max(0.0, getJsonNumber(section, "periodicGcIntervalMs", 15000));
+    policy.interval = chrono::milliseconds((long long) max(100.0, getJsonNumber(section, "intervalMs", 1000)));
+    thread([policy, pressure]() { watchMemoryPressure(policy, pressure.limitEvents); }).detach();
+}
 
-            }
+/**
+ * Settings of the "shutdownPolicy" section of the configuration.
+ */
+struct ShutdownPolicy {
+    /** how long DestroyJavaVM may wait for non-daemon threads before System.exit() is called */
+    chrono::milliseconds wait;
+    /** how long the shutdown hooks may run before the JVM is halted, zero to wait for them */
+    chrono::milliseconds haltAfter;
+};
 
-            txt.close();
+static mutex shutdownMutex;
+static condition_variable javaVmDestroyedCondition;
+static bool javaVmDestroyed = false;
 
+/**
+ * Prints the live non-daemon threads, except the one waiting in DestroyJavaVM, with the frame each is in.
+ */
+static void printThreadsBlockingExit(JNIEnv *env) {
+    ControlRequest request(env);
+    jobject stackTraces = request.callStatic("java/lang/Thread", "getAllStackTraces", "()Ljava/util/Map;");
+    jobjectArray threads = (jobjectArray) request.call(request.call(stackTraces, "keySet", "()Ljava/util/Set;"), "toArray", "()[Ljava/lang/Object;");
+    jsize threadCount = request.getArrayLength(threads);
+    for (jsize threadIndex = 0; threadIndex < threadCount && !request.failed(); threadIndex++) {
+        jobject thread = request.getArrayElement(threads, threadIndex);
+        string name = request.callString(thread, "getName");
+        if (request.callBoolean(thread, "isDaemon") || !request.callBoolean(thread, "isAlive") || name == "DestroyJavaVM") {
+            continue;
         }
+        jobjectArray stackTrace = (jobjectArray) request.call(stackTraces, "get", "(Ljava/lang/Object;)Ljava/lang/Object;", thread);
+        cerr << "  \"" << name << "\"";
+        if (request.getArrayLength(stackTrace) > 0) {
+            cerr << " at " << request.callString(request.getArrayElement(stackTrace, 0), "toString");
+        }
+        cerr << endl;
+    }
+    if (request.failed()) {
+        cerr << "  (" << request.getError() << ")" << endl;
+    }
+}
 
+/**
+ * Waits for DestroyJavaVM to return. If the non-daemon threads keep the JVM alive longer than the policy allows, prints them and calls
+ * System.exit(), which runs the shutdown hooks and exits the process. Shutdown hooks that take longer than "haltAfterMs" are cut short with
+ * Runtime.halt().
+ */
+static void enforceShutdownPolicy(const ShutdownPolicy &policy, jint exitCode) {
+    {
+        unique_lock<mutex> lock(shutdownMutex);
+        if (javaVmDestroyedCondition.wait_for(lock, policy.wait, []() { return javaVmDestroyed; })) {
+            return;
+        }
+    }
+    JNIEnv *env = attachBackgroundThread("packr-shutdown");
+    if (env == nullptr || env->PushLocalFrame(64) != JNI_OK) {
+        return;
+    }
+    tracePhase("shutdown-forced");
+    cerr << "Warning: non-daemon threads kept the JVM alive " << policy.wait.count() << " ms after main() returned:" << endl;
+    printThreadsBlockingExit(env);
+
+    if (policy.haltAfter > chrono::milliseconds::zero()) {
+        thread([policy, exitCode]() {
+            this_thread::sleep_for(policy.haltAfter);
+            JNIEnv *haltEnv = attachBackgroundThread("packr-halt");
+            if (haltEnv == nullptr) {
+                return;
+            }
+            cerr << "Warning: the shutdown hooks didn't finish within " << policy.haltAfter.count() << " ms, halting the JVM" << endl;
+            ControlRequest request(haltEnv);
+            request.callVoid(request.callStatic("java/lang/Runtime", "getRuntime", "()Ljava/lang/Runtime;"), "halt", "(I)V", exitCode);
+        }).detach();
     }
 
-    return paths;
+    cerr << "Calling System.exit(" << exitCode << ") to run the shutdown hooks ..." << endl;
+    shutdownForced = true;
+    ControlRequest request(env);
+    request.callStaticVoid("java/lang/System", "exit", "(I)V", exitCode);
+    cerr << "Warning: System.exit() failed: " << (request.failed() ? request.getError() : "it returned") << endl;
+    env->PopLocalFrame(nullptr);
 }
 
 /**
- * Searches for the last / or \ and returns all prior characters.
+ * Reads the "shutdownPolicy" section of the configuration.
  *
- * @param executablePath to get the parent directory of
- * @return the parent directory of {@code executablePath}. The returned string is UTF-8 encoded.
+ * @return false if there's no such section
  */
-string getExecutableDirectory(const dropt_char *executablePath) {
-    const dropt_char *lastSlash = findLastCharacter(executablePath, DROPT_TEXT_LITERAL('/'));
-    if (lastSlash == nullptr) {
-        lastSlash = findLastCharacter(executablePath, DROPT_TEXT_LITERAL('\\'));
+static bool readShutdownPolicy(sajson::value jsonRoot, ShutdownPolicy *policy) {
+    if (!hasJsonValue(jsonRoot, "shutdownPolicy", sajson::TYPE_OBJECT)) {
+        return false;
     }
+    const sajson::value section = getJsonValue(jsonRoot, "shutdownPolicy");
+    policy->wait = chrono::milliseconds((long long) max(0.0, getJsonNumber(section, "waitMs", 2000)));
+    policy->haltAfter = chrono::milliseconds((long long) max(0.0, getJsonNumber(section, "haltAfterMs", 0)));
+    return true;
+}
 
-    if (lastSlash != nullptr) {
-#ifdef UNICODE
-        wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-        return converter.to_bytes(executablePath, lastSlash);
-#else
-        return string(executablePath, lastSlash - executablePath);
-#endif
+/**
+ * Starts enforcing the shutdown policy, if the configuration has one, once main() returned.
+ *
+ * @param policy the policy read by readShutdownPolicy(), nullptr if there's none
+ * @return true if a policy is enforced, finishShutdownPolicy() must be called once DestroyJavaVM returns
+ */
+static bool startShutdownPolicy(const ShutdownPolicy *policy, jint exitCode) {
+    shutdownStartTime = chrono::steady_clock::now();
+    if (policy == nullptr) {
+        return false;
     }
+    ShutdownPolicy enforcedPolicy = *policy;
+    thread([enforcedPolicy, exitCode]() { enforceShutdownPolicy(enforcedPolicy, exitCode); }).detach();
+    return true;
+}
 
-    return string("");
+static void finishShutdownPolicy() {
+    {
+        lock_guard<mutex> lock(shutdownMutex);
+        javaVmDestroyed = true;
+    }
+    javaVmDestroyedCondition.notify_all();
+    if (verbose) {
+        cout << "Shutdown took " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - shutdownStartTime).count() << " ms"
+             << endl;
+    }
 }
 
 /**
- * Finds the last path element by searching for a / or \, all text found after the last / is returned. If a / or \ isn't found then {@code executablePath} is returned UTF-8 encoded in a string.
+ * Reads the "processPriority" section of the configuration, e.g. {"nice": 10, "scheduler": "batch", "ioClass": "idle", "oomScoreAdjust": 500}.
  *
- * @param executablePath the path to find the executable in
- * @return UTF-8 encoded executable name from {@code executablePath}
+ * @return false if there's no such section
  */
-string getExecutableName(const dropt_char *executablePath) {
-    const dropt_char *delim = findLastCharacter(executablePath, DROPT_TEXT_LITERAL('/'));
-    if (delim == nullptr) {
-        delim = findLastCharacter(executablePath, DROPT_TEXT_LITERAL('\\'));
+static bool readProcessPriority(sajson::value jsonRoot, ProcessPriority *priority) {
+    if (!hasJsonValue(jsonRoot, "processPriority", sajson::TYPE_OBJECT)) {
+        return false;
+    }
+    const sajson::value section = getJsonValue(jsonRoot, "processPriority");
+    *priority = ProcessPriority();
+    priority->hasNice = hasJsonValue(section, "nice", sajson::TYPE_INTEGER);
+    if (priority->hasNice) {
+        priority->nice = max(-20, min(19, getJsonValue(section, "nice").get_integer_value()));
+    }
+    if (hasJsonValue(section, "scheduler", sajson::TYPE_STRING)) {
+        priority->scheduler = getJsonValue(section, "scheduler").as_string();
+        if (priority->scheduler != "other" && priority->scheduler != "batch" && priority->scheduler != "idle") {
+            cerr << "Warning: ignoring the unknown scheduler '" << priority->scheduler << "', use other, batch, or idle" << endl;
+            priority->scheduler.clear();
+        }
+    }
+    if (hasJsonValue(section, "ioClass", sajson::TYPE_STRING)) {
+        priority->ioClass = getJsonValue(section, "ioClass").as_string();
+        if (priority->ioClass != "realtime" && priority->ioClass != "best-effort" && priority->ioClass != "idle") {
+            cerr << "Warning: ignoring the unknown I/O class '" << priority->ioClass << "', use realtime, best-effort, or idle" << endl;
+            priority->ioClass.clear();
+        }
+    }
+    priority->ioPriority = hasJsonValue(section, "ioPriority", sajson::TYPE_INTEGER) ? max(0, min(7, getJsonValue(section, "ioPriority").get_integer_value()))
+                                                                                      : 4;
+    priority->hasOomScoreAdjust = hasJsonValue(section, "oomScoreAdjust", sajson::TYPE_INTEGER);
+    if (priority->hasOomScoreAdjust) {
+        priority->oomScoreAdjust = max(-1000, min(1000, getJsonValue(section, "oomScoreAdjust").get_integer_value()));
     }
+    return true;
+}
 
-    if (delim != nullptr) {
-#ifdef UNICODE
-        wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-        return converter.to_bytes(++delim);
-#else
-        return string(++delim);
-#endif
+/**
+ * Answers a control socket request with a JSON object on a single line. The requests are "uptime", "phases", "heap", "gc", "threads", "metrics"
+ * for all of these, and "dump threads", "start jfr", "check jfr", and "stop jfr", which accept the options of the matching jcmd command, e.g.
+ * "start jfr duration=60s filename=app.jfr".
+ */
+static string handleControlRequest(const string &requestLine) {
+    vector<string> words;
+    istringstream wordStream(requestLine);
+    for (string word; wordStream >> word;) {
+        words.push_back(word);
+    }
+    string command = words.empty() ? string() : words[0];
+    if (words.size() > 1 && (command == "dump" || command == "start" || command == "check" || command == "stop")) {
+        command += " " + words[1];
+        words.erase(words.begin(), words.begin() + 2);
+    } else if (!words.empty()) {
+        words.erase(words.begin());
     }
 
-#ifdef UNICODE
-    wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-    string utf8Path = converter.to_bytes(executablePath);
-    return utf8Path;
-#else
-    return string(executablePath);
-#endif
+    JNIEnv *env = attachBackgroundThread("packr-control");
+    if (env == nullptr) {
+        return "{\"error\": \"failed to attach to the JVM\"}";
+    }
+    if (env->PushLocalFrame(64) != JNI_OK) {
+        env->ExceptionClear();
+        return "{\"error\": \"out of memory\"}";
+    }
+
+    ControlRequest request(env);
+    ostringstream response;
+    response << '{';
+    if (command == "uptime") {
+        writeUptimeJson(response, request);
+    } else if (command == "phases") {
+        response << "\"phases\": ";
+        writePhasesJson(response, "", "");
+    } else if (command == "heap") {
+        writeHeapJson(response, request);
+    } else if (command == "gc") {
+        writeGcJson(response, request);
+    } else if (command == "threads") {
+        writeThreadsJson(response, request);
+    } else if (command == "metrics") {
+        writeUptimeJson(response, request);
+        response << ", \"phases\": ";
+        writePhasesJson(response, "", "");
+        response << ", ";
+        writeHeapJson(response, request);
+        response << ", ";
+        writeGcJson(response, request);
+        response << ", ";
+        writeThreadsJson(response, request);
+    } else if (command == "dump threads" || command == "start jfr" || command == "check jfr" || command == "stop jfr") {
+        const char *operation = command == "dump threads" ? "threadPrint" : command == "start jfr" ? "jfrStart" : command == "check jfr" ? "jfrCheck" : "jfrStop";
+        string output = invokeDiagnosticCommand(request, operation, words);
+        response << "\"output\": ";
+        writeJsonString(response, output);
+    } else {
+        response.str(string());
+        response << "{\"error\": ";
+        writeJsonString(response, "unknown request '" + requestLine + "', try uptime, phases, heap, gc, threads, metrics, dump threads, start jfr, "
+                                  "check jfr, or stop jfr");
+    }
+    response << '}';
+
+    env->PopLocalFrame(nullptr);
+    if (request.failed()) {
+        ostringstream error;
+        error << "{\"error\": ";
+        writeJsonString(error, request.getError());
+        error << '}';
+        return error.str();
+    }
+    return response.str();
 }
 
 /**
- * Strips ".exe" suffix from the executable name and appends ".json".
- * @param executableName the UTF-8 encoded executable name
- * @return UTF-8 encoded configuration path
+ * Starts answering requests on the control socket, if it was requested with --controlSocket or the "controlSocket" configuration value. The value
+ * is either true for a socket named after the executable and process id in the temporary directory, or the path of the socket.
  */
-string getDefaultConfigurationPath(string& executableName) {
-    wstring_convert<codecvt_utf8_utf16<wchar_t>> converter;
-    wstring executableNameWstring = converter.from_bytes(executableName);
-    wstring exeSuffix = wstring(L".exe");
-    bool hasExeSuffix = executableNameWstring.size() >= exeSuffix.size() &&
-        executableNameWstring.compare(executableNameWstring.size() - exeSuffix.size(),
-            exeSuffix.size(), exeSuffix) == 0;
-    wstring appName;
-    if (hasExeSuffix)
-        appName = executableNameWstring.substr(0, executableNameWstring.size() - exeSuffix.size());
-    else
-        appName = executableNameWstring;
-    wstring defaultConfigurationPath = appName + L".json";
-    return converter.to_bytes(defaultConfigurationPath);
+static void startControlSocketIfRequested(sajson::value jsonRoot) {
+    string path = getTemporaryDirectory() + "/packr-" + executableName + "-" + to_string(getProcessId()) + ".sock";
+    if (hasJsonValue(jsonRoot, "controlSocket", sajson::TYPE_STRING)) {
+        path = getJsonValue(jsonRoot, "controlSocket").as_string();
+    } else if (!controlSocketFromCommandLine && !hasJsonValue(jsonRoot, "controlSocket", sajson::TYPE_TRUE)) {
+        return;
+    }
+    if (!startControlSocket(path.c_str(), handleControlRequest)) {
+        cerr << "Warning: failed to open the control socket " << path << endl;
+        return;
+    }
+    if (verbose) {
+        cout << "Answering requests on the control socket " << path << endl;
+    }
+}
+
+/**
+ * Frees the memory the launcher only needs until the Java main method is invoked: the configuration document and the memory it was parsed in,
+ * the command line arguments, which Java has its own copies of, and the VM options, which the JVM copied while it was created. The freed memory is
+ * returned to the operating system, and the resident memory before and after is printed if verbose or tracing.
+ */
+static void releaseLauncherMemory(unique_ptr<sajson::document> &json, vector<const char *> &vmOptions, vector<JavaVMOption> &optionsVector) {
+    unsigned long long residentBefore = verbose || tracing ? getResidentMemorySize() : 0;
+
+    json.reset();
+    unmapFile(&configurationMapping);
+    vector<char>().swap(configurationBuffer);
+    vector<const char *>().swap(cmdLineArgv);
+    vector<const char *>().swap(vmOptions);
+    vector<JavaVMOption>().swap(optionsVector);
+    vector<string>().swap(vmOptionsFromCommandLine);
+    vector<unique_ptr<char[]>>().swap(argumentBlocks);
+    argumentBlock = nullptr;
+    argumentBlockUsed = argumentBlockSize;
+    releaseFreeHeapMemory();
+
+    if (!verbose && !tracing) {
+        return;
+    }
+    unsigned long long residentAfter = getResidentMemorySize();
+    if (verbose) {
+        cout << "Released the launcher memory, resident memory went from " << residentBefore / 1024 << " KB to " << residentAfter / 1024 << " KB"
+             << endl;
+    }
+    if (tracing) {
+        // packr-memory launcher-released <resident bytes before> <resident bytes after>
+        cout << "packr-memory launcher-released " << residentBefore << " " << residentAfter << endl;
+    }
 }
 
 bool setCmdLineArguments(int argc, dropt_char **argv) {
+    cmdLineArgv.clear();
+    vmOptionsFromCommandLine.clear();
+    profileFromCommandLine = false;
+    controlSocketFromCommandLine = false;
+    hugePageJvmTextFromCommandLine = false;
+
     const dropt_char *executablePath = getExecutablePath(argv[0]);
+    executableFilePath = executablePath;
     workingDir = getExecutableDirectory(executablePath);
     executableName = getExecutableName(executablePath);
     string defaultConfigurationPath = getDefaultConfigurationPath(executableName);
@@ -354,15 +2370,36 @@ bool setCmdLineArguments(int argc, dropt_char **argv) {
     defaultConfigurationPathDroptChar = defaultConfigurationPath.c_str();
 #endif
 
-    dropt_bool showHelp = 0;
-    dropt_bool showVersion = 0;
-    dropt_char *cwd = nullptr;
-    dropt_char *config = nullptr;
-    dropt_bool _verbose = 0;
-    dropt_bool _console = 0;
-    dropt_bool _cli = 0;
-
-    dropt_option options[] = {{'c',
+    // static, so the option table below can refer to them at compile time
+    static dropt_bool showHelp;
+    static dropt_bool showVersion;
+    static dropt_char *cwd;
+    static dropt_char *config;
+    static dropt_bool _verbose;
+    static dropt_bool _trace;
+    static dropt_bool _profile;
+    static dropt_bool _controlSocket;
+    static dropt_bool _hugePageJvmText;
+    static dropt_bool _console;
+    static dropt_bool _supervise;
+    static dropt_bool _standby;
+    static dropt_bool _cli;
+    showHelp = 0;
+    showVersion = 0;
+    cwd = nullptr;
+    config = nullptr;
+    _verbose = 0;
+    _trace = 0;
+    _profile = 0;
+    _controlSocket = 0;
+    _hugePageJvmText = 0;
+    _console = 0;
+    _supervise = 0;
+    _standby = 0;
+    _cli = 0;
+
+    // sorted at compile time, parsing doesn't allocate
+    static constexpr dropt_option options[] = {{'c',
                                DROPT_TEXT_LITERAL("cli"),
                                DROPT_TEXT_LITERAL("Enables this command line interface."),
                                nullptr,
@@ -394,7 +2431,7 @@ bool setCmdLineArguments(int argc, dropt_char **argv) {
                               {'\0',
                                DROPT_TEXT_LITERAL("config"),
                                DROPT_TEXT_LITERAL("Specifies the configuration file."),
-                               defaultConfigurationPathDroptChar,
+                               DROPT_TEXT_LITERAL("file"),
                                dropt_handle_string,
                                &config,
                                dropt_attr_optional_val},
@@ -405,21 +2442,67 @@ bool setCmdLineArguments(int argc, dropt_char **argv) {
                                dropt_handle_bool,
                                &_verbose,
                                dropt_attr_optional_val},
+                              {'\0',
+                               DROPT_TEXT_LITERAL("trace"),
+                               DROPT_TEXT_LITERAL("Prints timestamped startup phase markers."),
+                               nullptr,
+                               dropt_handle_bool,
+                               &_trace,
+                               dropt_attr_optional_val},
+                              {'\0',
+                               DROPT_TEXT_LITERAL("profile"),
+                               DROPT_TEXT_LITERAL("Records class loading, startup, safepoint logs, and a flight recording into a new directory."),
+                               nullptr,
+                               dropt_handle_bool,
+                               &_profile,
+                               dropt_attr_optional_val},
+                              {'\0',
+                               DROPT_TEXT_LITERAL("controlSocket"),
+                               DROPT_TEXT_LITERAL("Answers requests for metrics, thread dumps, and flight recordings on a Unix domain socket. [Linux and macOS only]"),
+                               nullptr,
+                               dropt_handle_bool,
+                               &_controlSocket,
+                               dropt_attr_optional_val},
+                              {'\0',
+                               DROPT_TEXT_LITERAL("hugePageJvmText"),
+                               DROPT_TEXT_LITERAL("Copies the code of the JVM library onto transparent huge pages after loading it. [Linux only]"),
+                               nullptr,
+                               dropt_handle_bool,
+                               &_hugePageJvmText,
+                               dropt_attr_optional_val},
+                              {'\0',
+                               DROPT_TEXT_LITERAL("supervise"),
+                               DROPT_TEXT_LITERAL("Runs Java in a child process that is restarted if it crashes. [Linux only]"),
+                               nullptr,
+                               dropt_handle_bool,
+                               &_supervise,
+                               dropt_attr_optional_val},
+                              {'\0',
+                               DROPT_TEXT_LITERAL("standby"),
+                               DROPT_TEXT_LITERAL("Keeps a started standby Java process to take over after a crash, implies --supervise. [Linux only]"),
+                               nullptr,
+                               dropt_handle_bool,
+                               &_standby,
+                               dropt_attr_optional_val},
+                              {'J',
+                               DROPT_TEXT_LITERAL("vmOption"),
+                               DROPT_TEXT_LITERAL("Passes an option to the JVM, e.g. -J-Xmx2G. Overrides the same option in the configuration."),
+                               DROPT_TEXT_LITERAL("option"),
+                               handleVmOption,
+                               &vmOptionsFromCommandLine,
+                               0},
                               {'\0',
                                DROPT_TEXT_LITERAL("console"),
                                DROPT_TEXT_LITERAL("Attaches a console window. [Windows only]"),
                                nullptr,
                                dropt_handle_bool,
                                &_console,
-                               dropt_attr_optional_val},
-                              {0, nullptr, nullptr, nullptr, nullptr, nullptr, 0}};
-
-    dropt_context *droptContext = dropt_new_context(options);
+                               dropt_attr_optional_val}};
+    static constexpr auto optionTable = dropt::make_option_table(options);
 
-    if (droptContext == nullptr) {
-        cerr << "Error: failed to parse command line!" << endl;
-        exit(EXIT_FAILURE);
-    }
+    auto droptContext = dropt::make_static_context(optionTable);
+    // for -J-Xmx2G like the java tools
+    droptContext.allow_concatenated_arguments();
 
     if (argc > 1) {
 
@@ -428,10 +2511,10 @@ bool setCmdLineArguments(int argc, dropt_char **argv) {
         if ((stringCompare(DROPT_TEXT_LITERAL("--cli"), argv[1]) == 0) || (stringCompare(DROPT_TEXT_LITERAL("-c"), argv[1]) == 0)) {
             // only parse command line if the first argument is "--cli" or "-c"
 
-            remains = dropt_parse(droptContext, -1, &argv[1]);
+            remains = droptContext.parse(-1, &argv[1]);
 
-            if (dropt_get_error(droptContext) != dropt_error_none) {
-                cerr << dropt_get_error_message(droptContext) << endl;
+            if (droptContext.get_error() != dropt_error_none) {
+                cerr << droptContext.get_error_message() << endl;
                 exit(EXIT_FAILURE);
             }
 
@@ -440,12 +2523,29 @@ bool setCmdLineArguments(int argc, dropt_char **argv) {
                 cout << "       " << executableName << " -c [options] [-- [java arguments]]" << endl;
                 cout << endl << "Options:" << endl;
 
-                dropt_print_help(stdout, droptContext, nullptr);
+                // the help shows the default configuration file, which is only known at runtime
+                vector<dropt_option> helpOptions(optionTable.get_options(), optionTable.get_options() + optionTable.size() + 1);
+                for (dropt_option &option : helpOptions) {
+                    if (option.handler_data == &config) {
+                        option.arg_description = defaultConfigurationPathDroptChar;
+                    }
+                }
+                dropt_context *helpContext = dropt_new_context(helpOptions.data());
+                if (helpContext != nullptr) {
+                    dropt_print_help(stdout, helpContext, nullptr);
+                    dropt_free_context(helpContext);
+                }
             } else if (showVersion) {
                 cout << executableName << " version " << PACKR_VERSION_STRING << endl;
             } else {
                 // evaluate parameters
                 verbose = _verbose != 0;
+                tracing = _trace != 0;
+                profileFromCommandLine = _profile != 0;
+                controlSocketFromCommandLine = _controlSocket != 0;
+                hugePageJvmTextFromCommandLine = _hugePageJvmText != 0;
+                standbyFromCommandLine = _standby != 0;
+                superviseFromCommandLine = _supervise != 0 || standbyFromCommandLine;
 
                 if (cwd != nullptr) {
                     if (verbose) {
@@ -455,6 +2555,7 @@ bool setCmdLineArguments(int argc, dropt_char **argv) {
                 }
 
                 if (config != nullptr) {
+                    configurationFromCommandLine = true;
 #ifdef UNICODE
                     configurationPath = converter.to_bytes(wstring(config));
 #else
@@ -480,32 +2581,20 @@ bool setCmdLineArguments(int argc, dropt_char **argv) {
             configurationPath = defaultConfigurationPath;
         }
 
-        // count number of unparsed arguments
-        dropt_char **cnt = remains;
-        while (*cnt != nullptr) {
-            cmdLineArgc++;
-            cnt++;
-        }
-
-        // copy unparsed arguments
-        cmdLineArgv = new char *[cmdLineArgc];
-        cmdLineArgc = 0;
-
-        while (*remains != nullptr) {
+        // argv outlives the JVM, so only arguments that need converting to UTF-8 are copied
+        for (; *remains != nullptr; remains++) {
 #ifdef UNICODE
             string utf8CommandLineArgument = converter.to_bytes(*remains);
-            cmdLineArgv[cmdLineArgc] = strdup(utf8CommandLineArgument.c_str());
+            cmdLineArgv.push_back(storeArgument(utf8CommandLineArgument.data(), utf8CommandLineArgument.size()));
 #else
-            cmdLineArgv[cmdLineArgc] = strdup(*remains);
+            cmdLineArgv.push_back(*remains);
 #endif
-            cmdLineArgc++;
-            remains++;
         }
     } else {
 		configurationPath = defaultConfigurationPath;
 	}
 
-    dropt_free_context(droptContext);
+    tracePhase("arguments-parsed");
 
     return showHelp == 0 && showVersion == 0;
 }
@@ -529,15 +2618,41 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
 #endif
     }
 
-    // read settings
-    sajson::document json = readConfigurationFile(configurationPath);
+    // read settings, a single file executable carries them in a payload appended to the executable
+    char *embeddedConfiguration = nullptr;
+    size_t embeddedConfigurationLength = 0;
+    bool hasEmbeddedConfiguration = !configurationFromCommandLine && mapFile(executableFilePath.c_str(), true, &configurationMapping)
+                                    && findEmbeddedConfiguration(configurationMapping, &embeddedConfiguration, &embeddedConfigurationLength);
+    if (verbose && hasEmbeddedConfiguration) {
+        cout << "Using the configuration embedded in the executable ..." << endl;
+    }
+    if (!hasEmbeddedConfiguration) {
+        unmapFile(&configurationMapping);
+    }
+
+    // the document points into configurationMapping or configurationBuffer, releaseLauncherMemory() frees them together before main() is invoked
+    unique_ptr<sajson::document> json(new sajson::document(
+            hasEmbeddedConfiguration ? sajson::parse(sajson::mutable_string_view(embeddedConfigurationLength, embeddedConfiguration))
+                                     : readConfigurationFile(configurationPath)));
 
-    if (!json.is_valid()) {
-        cerr << "Error: failed to load configuration: " << configurationPath << endl;
+    if (!json->is_valid()) {
+        cerr << "Error: failed to load configuration: " << (hasEmbeddedConfiguration ? "embedded in the executable" : configurationPath) << endl;
         exit(EXIT_FAILURE);
     }
 
-    sajson::value jsonRoot = json.get_root();
+    tracePhase("configuration-loaded");
+
+    sajson::value jsonRoot = json->get_root();
+
+    bool useStandby = standbyFromCommandLine || hasJsonValue(jsonRoot, "supervisorStandby", sajson::TYPE_TRUE);
+    bool supervise = superviseFromCommandLine || useStandby || hasJsonValue(jsonRoot, "supervise", sajson::TYPE_TRUE);
+
+    // supervised Java processes watch their own startup, the supervisor doesn't start Java
+    if (!supervise) {
+        // a stall report shows the native stack of this thread until it creates the JVM
+        setNativeStackCapturable(true);
+        startStartupWatchdog(jsonRoot, launcherStartTime);
+    }
 
     // load JVM library, get function pointers
     if (verbose) {
@@ -546,32 +2661,54 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
 
     GetDefaultJavaVMInitArgs getDefaultJavaVMInitArgs = nullptr;
     CreateJavaVM createJavaVM = nullptr;
-    wstring trimmedJrePathWstring;
-    string trimmedJrePathString;
-    const dropt_char* jrePath = nullptr;
-    if (hasJsonValue(jsonRoot, "jrePath", sajson::TYPE_STRING)) {
-        const string originalJrePathString = getJsonValue(jsonRoot, "jrePath").as_string();
-        wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-        wstring originalJrePathWstring = converter.from_bytes(originalJrePathString);
-        trimmedJrePathWstring = originalJrePathWstring;
-        // Removes trailing slash.
-        if (L'/' == trimmedJrePathWstring.back())
-            trimmedJrePathWstring.pop_back();
-#ifdef UNICODE
-        jrePath = trimmedJrePathWstring.c_str();
-#else
-        trimmedJrePathString = converter.to_bytes(trimmedJrePathWstring);
-        jrePath = trimmedJrePathString.c_str();
-#endif
+    bool loadedJvmLibrary = false;
+
+    // the first variant this machine satisfies is used, variants are listed from the most to the least demanding
+    if (hasJsonValue(jsonRoot, "jreVariants", sajson::TYPE_ARRAY)) {
+        sajson::value jreVariants = getJsonValue(jsonRoot, "jreVariants");
+        for (size_t variantIndex = 0; variantIndex < jreVariants.get_length() && !loadedJvmLibrary; variantIndex++) {
+            sajson::value variant = jreVariants.get_array_element(variantIndex);
+            if (variant.get_type() != sajson::TYPE_OBJECT || !hasJsonValue(variant, "path", sajson::TYPE_STRING)) {
+                cerr << "Warning: ignoring jreVariants element " << variantIndex << " without a 'path'" << endl;
+                continue;
+            }
+            const string variantPath = getJsonValue(variant, "path").as_string();
+            if (!isJreVariantSupported(variant, variantPath)) {
+                continue;
+            }
+            const string vmType = hasJsonValue(variant, "vmType", sajson::TYPE_STRING) ? getJsonValue(variant, "vmType").as_string() : "server";
+            if (verbose) {
+                cout << "Using JRE variant " << variantPath << " with the " << vmType << " VM ..." << endl;
+            }
+            loadedJvmLibrary = loadJreFunctions(variantPath, vmType, &getDefaultJavaVMInitArgs, &createJavaVM);
+            if (!loadedJvmLibrary) {
+                cerr << "Warning: failed to load the " << vmType << " VM of JRE variant " << variantPath << endl;
+            }
+        }
     }
-    else {
-        jrePath = DROPT_TEXT_LITERAL("jre");
+
+    if (!loadedJvmLibrary) {
+        const string jrePath = hasJsonValue(jsonRoot, "jrePath", sajson::TYPE_STRING) ? getJsonValue(jsonRoot, "jrePath").as_string() : "jre";
+        loadedJvmLibrary = loadJreFunctions(jrePath, "server", &getDefaultJavaVMInitArgs, &createJavaVM);
     }
-    if (!loadJNIFunctions(jrePath, &getDefaultJavaVMInitArgs, &createJavaVM)) {
+
+    if (!loadedJvmLibrary) {
         cerr << "Error: failed to load VM runtime library!" << endl;
         exit(EXIT_FAILURE);
     }
 
+    // before the JVM starts threads that execute the code being moved
+    if (hugePageJvmTextFromCommandLine || hasJsonValue(jsonRoot, "hugePageJvmText", sajson::TYPE_TRUE)) {
+        if (verbose) {
+            cout << "Remapping the JVM library code onto huge pages ..." << endl;
+        }
+        if (!remapJvmTextOntoHugePages()) {
+            cerr << "Warning: the JVM library code stays on regular pages" << endl;
+        }
+    }
+
+    tracePhase("jvm-library-loaded");
+
     // get default init arguments
     JavaVMInitArgs args;
     args.version = JNI_VERSION_1_6;
@@ -599,8 +2736,8 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
         cout << "Passing VM options ..." << endl;
     }
 
-    vector<JavaVMOption> optionsVector;
-    vector<unique_ptr<char *>> optionStrings;
+    // later options override earlier ones with the same key, in the order: configuration, PACKR_VM_OPTIONS, and -J on the command line
+    vector<const char *> vmOptions;
 
     if (verbose) {
         cout
@@ -611,14 +2748,8 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
                 << endl;
     }
     if (isZgcSupported() && hasJsonValue(jsonRoot, "useZgcIfSupportedOs", sajson::TYPE_TRUE)) {
-        JavaVMOption unlockExperimental;
-        unlockExperimental.optionString = (char *) "-XX:+UnlockExperimentalVMOptions";
-        unlockExperimental.extraInfo = nullptr;
-        optionsVector.push_back(unlockExperimental);
-        JavaVMOption useZGC;
-        useZGC.optionString = (char *) "-XX:+UseZGC";
-        useZGC.extraInfo = nullptr;
-        optionsVector.push_back(useZGC);
+        vmOptions.push_back("-XX:+UnlockExperimentalVMOptions");
+        vmOptions.push_back("-XX:+UseZGC");
     }
 
     if (hasJsonValue(jsonRoot, "vmArgs", sajson::TYPE_ARRAY)) {
@@ -629,14 +2760,30 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
             if (verbose) {
                 cout << "  # " << vmArgValue << endl;
             }
-            JavaVMOption option;
-            optionStrings.push_back(make_unique<char *>(strdup(vmArgValue.c_str())));
-            option.optionString = *optionStrings.back();
-            option.extraInfo = nullptr;
-            optionsVector.push_back(option);
+            vmOptions.push_back(storeArgument(vmArgValue.data(), vmArgValue.size()));
         }
     }
 
+    bool profiling = startProfile(jsonRoot, vmOptions);
+    readVmOptionsFromEnvironment(vmOptions);
+    for (const string &vmOption : vmOptionsFromCommandLine) {
+        vmOptions.push_back(vmOption.c_str());
+    }
+
+    vector<JavaVMOption> optionsVector;
+    for (const char *vmOption : mergeVmOptions(vmOptions)) {
+        JavaVMOption option;
+        option.optionString = const_cast<char *>(vmOption);
+        option.extraInfo = nullptr;
+        optionsVector.push_back(option);
+    }
+    if (profiling || hasJsonValue(jsonRoot, "shutdownPolicy", sajson::TYPE_OBJECT)) {
+        optionsVector.push_back({(char *) "exit", (void *) vmExitHook});
+    }
+    if (profiling) {
+        optionsVector.push_back({(char *) "abort", (void *) profileAbortHook});
+    }
+
     args.nOptions = optionsVector.size();
     args.options = &optionsVector[0];
 
@@ -656,7 +2803,29 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
         Done as lambda to capture local variables, and remain in function scope.
     */
 
-    callback([&](void *) {
+    if (hasJsonValue(jsonRoot, "argumentFiles", sajson::TYPE_TRUE)) {
+        expandArgumentFiles();
+    }
+
+    /*
+        Creates the JVM and runs the Java main method in this process. A standby process of a supervisor creates its JVM and loads the main class, then
+        parks in waitForRelease until the supervisor makes it the active process.
+    */
+    auto runJavaMain = [&](const WaitForReleaseDelegate &waitForRelease) {
+
+        if (supervise) {
+            setNativeStackCapturable(true);
+            startStartupWatchdog(jsonRoot, chrono::steady_clock::now());
+        }
+
+        // on the thread that creates the JVM, so the JVM's threads inherit the settings
+        ProcessPriority priority;
+        if (readProcessPriority(jsonRoot, &priority)) {
+            if (verbose) {
+                cout << "Applying the process priority ..." << endl;
+            }
+            applyProcessPriority(priority);
+        }
 
         // create JVM
 
@@ -667,24 +2836,33 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
             cout << "Creating Java VM ..." << endl;
         }
 
+        setNativeStackCapturable(false);
         if (createJavaVM(&jvm, (void **) &env, &args) < 0) {
             cerr << "Error: failed to create Java VM!" << endl;
             exit(EXIT_FAILURE);
         }
 
+        tracePhase("jvm-created");
+
+        createdJvm = jvm;
+        startControlSocketIfRequested(jsonRoot);
+        startMemoryPressureWatcher(jsonRoot);
+
         // create array of arguments to pass to Java main()
 
         if (verbose) {
             cout << "Passing command line arguments ..." << endl;
         }
 
-        jobjectArray appArgs = env->NewObjectArray(cmdLineArgc, env->FindClass("java/lang/String"), nullptr);
-        for (size_t i = 0; i < cmdLineArgc; i++) {
+        jobjectArray appArgs = env->NewObjectArray((jsize) cmdLineArgv.size(), env->FindClass("java/lang/String"), nullptr);
+        for (size_t i = 0; i < cmdLineArgv.size(); i++) {
             if (verbose) {
                 cout << "  # " << cmdLineArgv[i] << endl;
             }
             jstring arg = env->NewStringUTF(cmdLineArgv[i]);
-            env->SetObjectArrayElement(appArgs, i, arg);
+            env->SetObjectArrayElement(appArgs, (jsize) i, arg);
+            // the array keeps the string, releasing the local reference keeps long argument lists from filling the local reference table
+            env->DeleteLocalRef(arg);
         }
 
         // load main class & method from classpath
@@ -704,24 +2882,92 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
         }
 
         const string main = getJsonValue(jsonRoot, "mainClass").as_string();
-        sajson::value jsonClassPath = getJsonValue(jsonRoot, "classPath");
-        vector<string> classPath = extractClassPath(jsonClassPath);
 
         jclass mainClass = nullptr;
         jmethodID mainMethod = nullptr;
+        jobject classLoader = nullptr;
 
-        if (loadStaticMethod(env, classPath, main, &mainClass, &mainMethod) != 0) {
-            cerr << "Error: failed to load/find main class " << main << endl;
-            exit(EXIT_FAILURE);
+        {
+            // the class loader keeps its own copy of the class path
+            vector<string> classPath = extractClassPath(getJsonValue(jsonRoot, "classPath"));
+            if (loadStaticMethod(env, classPath, main, &mainClass, &mainMethod, &classLoader) != 0) {
+                cerr << "Error: failed to load/find main class " << main << endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        tracePhase("main-class-loaded");
+
+        // invoke the warm-up entry points concurrently with main()
+
+        if (hasJsonValue(jsonRoot, "warmupEntryPoints", sajson::TYPE_ARRAY)) {
+            sajson::value warmupEntryPoints = getJsonValue(jsonRoot, "warmupEntryPoints");
+            vector<string> entryPoints;
+            for (size_t entryIndex = 0; entryIndex < warmupEntryPoints.get_length(); entryIndex++) {
+                entryPoints.push_back(warmupEntryPoints.get_array_element(entryIndex).as_string());
+            }
+            // by default one core is left for the main thread
+            size_t warmupThreads = max(1u, thread::hardware_concurrency()) - 1;
+            if (hasJsonValue(jsonRoot, "warmupThreads", sajson::TYPE_INTEGER)) {
+                warmupThreads = (size_t) max(1, getJsonValue(jsonRoot, "warmupThreads").get_integer_value());
+            }
+            chrono::milliseconds warmupTimeBudget(0);
+            if (hasJsonValue(jsonRoot, "warmupTimeBudgetMs", sajson::TYPE_INTEGER)) {
+                warmupTimeBudget = chrono::milliseconds(getJsonValue(jsonRoot, "warmupTimeBudgetMs").get_integer_value());
+            }
+            if (!entryPoints.empty()) {
+                startWarmupEntryPoints(jvm, env, classLoader, entryPoints, warmupThreads, warmupTimeBudget);
+            }
+        }
+
+        // preload classes in the background while main() runs
+
+        vector<string> preloadClassNames;
+        if (hasJsonValue(jsonRoot, "preloadClasses", sajson::TYPE_ARRAY)) {
+            sajson::value preloadClasses = getJsonValue(jsonRoot, "preloadClasses");
+            for (size_t preloadIndex = 0; preloadIndex < preloadClasses.get_length(); preloadIndex++) {
+                preloadClassNames.push_back(preloadClasses.get_array_element(preloadIndex).as_string());
+            }
+        }
+        string preloadClassList;
+        if (hasJsonValue(jsonRoot, "preloadClassList", sajson::TYPE_STRING)) {
+            preloadClassList = getJsonValue(jsonRoot, "preloadClassList").as_string();
+        }
+        if (!preloadClassNames.empty() || !preloadClassList.empty()) {
+            if (verbose) {
+                cout << "Preloading classes in the background ..." << endl;
+            }
+            startClassPreloading(jvm, env, classLoader, preloadClassNames, preloadClassList);
+        }
+
+        if (startupWatchdog != nullptr) {
+            startupWatchdog->pause();
+        }
+        bool released = waitForRelease();
+        if (startupWatchdog != nullptr) {
+            startupWatchdog->resume();
+        }
+        if (!released) {
+            if (verbose) {
+                cout << "Standby process was not needed by the supervisor, exiting ..." << endl;
+            }
+            exit(EXIT_SUCCESS);
         }
 
+        // jsonRoot, cmdLineArgv, and the VM options can't be used once the launcher memory is released
+        ShutdownPolicy shutdownPolicy;
+        bool hasShutdownPolicy = readShutdownPolicy(jsonRoot, &shutdownPolicy);
+        releaseLauncherMemory(json, vmOptions, optionsVector);
+
         // call main() method
 
         if (verbose) {
             cout << "Invoking static " << main << ".main() function ..." << endl;
         }
 
+        tracePhase("main-invoked");
         env->CallStaticVoidMethod(mainClass, mainMethod, appArgs);
+        tracePhase("main-returned");
         jboolean exceptionOccurred = env->ExceptionCheck();
         if (verbose) {
             cout << "Checked for an exception from the main method, exceptionOccurred=" << (bool) exceptionOccurred << endl;
@@ -735,42 +2981,59 @@ void launchJavaVM(const LaunchJavaVMCallback &callback) {
             jclass threadClass = env->FindClass("java/lang/Thread");
             if (threadClass == nullptr) {
                 cerr << "Couldn't load thread class";
-                return nullptr;
+                return;
             }
             jmethodID threadGetCurrent = env->GetStaticMethodID(threadClass, "currentThread", "()Ljava/lang/Thread;");
             if (threadGetCurrent == nullptr) {
                 cerr << "Couldn't load current thread method";
-                return nullptr;
+                return;
             }
             jobject thread = env->CallStaticObjectMethod(threadClass, threadGetCurrent);
             if (thread == nullptr) {
                 cerr << "Couldn't load thread current";
-                return nullptr;
+                return;
             }
             // call java.lang.Thread#dispatchUncaughtException(Throwable)
             jmethodID dispatchMethodId = env->GetMethodID(threadClass, "dispatchUncaughtException", "(Ljava/lang/Throwable;)V");
             if(threadClass== nullptr){
                 cerr << "Couldn't find method dispatchUncaughtException";
-                return nullptr;
+                return;
             }
             env->CallVoidMethod(thread, dispatchMethodId, throwable);
             env->ExceptionClear();
         }
 
-        // cleanup
-        for (size_t cmdLineArg = 0; cmdLineArg < cmdLineArgc; cmdLineArg++) {
-            free(cmdLineArgv[cmdLineArg]);
-        }
-
-        delete[] cmdLineArgv;
+        // the control socket makes JNI calls, so it stops before the JVM is destroyed or the shutdown policy calls System.exit()
+        stopControlSocket();
 
-        // blocks this thread until the Java main() method exits
+        // blocks this thread until the Java main() method exits, and the non-daemon threads it started
 
+        bool enforcingShutdownPolicy = startShutdownPolicy(hasShutdownPolicy ? &shutdownPolicy : nullptr, exceptionOccurred ? EXIT_FAILURE : EXIT_SUCCESS);
         jvm->DestroyJavaVM();
+        createdJvm = nullptr;
+        if (enforcingShutdownPolicy) {
+            finishShutdownPolicy();
+        }
+
+        writeProfileIndex(exceptionOccurred ? "exception" : "returned", exceptionOccurred ? EXIT_FAILURE : EXIT_SUCCESS);
+
+        tracePhase("jvm-destroyed");
 
         if (verbose) {
             cout << "Destroyed Java VM ..." << endl;
         }
+    };
+
+    callback([&](void *) {
+        if (supervise) {
+            int exitCode = EXIT_SUCCESS;
+            if (superviseChildProcesses(runJavaMain, useStandby, &exitCode)) {
+                exit(exitCode);
+            }
+            cerr << "Warning: supervise mode isn't supported on this platform, running without a supervisor" << endl;
+        }
+
+        runJavaMain([]() { return true; });
 
         return nullptr;
     }, args);
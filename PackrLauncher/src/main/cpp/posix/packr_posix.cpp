@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * Copyright 2015 See AUTHORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ******************************************************************************/
+#if defined(__linux__) || defined(__APPLE__)
+
+/* parts of the launcher shared by the POSIX platforms */
+
+#include <packr.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * Path of the control socket, removed when the process exits.
+ */
+static string controlSocketPath;
+
+static void removeControlSocket() {
+    if (!controlSocketPath.empty()) {
+        unlink(controlSocketPath.c_str());
+        controlSocketPath.clear();
+    }
+}
+
+/**
+ * Held while a request is handled, stopControlSocket() takes it so no request runs once it returns.
+ */
+static mutex controlRequestMutex;
+static bool controlSocketStopped = false;
+
+/**
+ * Write end of the pipe that wakes the control socket thread from waiting for a connection.
+ */
+static int controlSocketWakeDescriptor = -1;
+
+/**
+ * A client that sends nothing, or doesn't read its responses, for this long is dropped, so it can't hold the single connection slot.
+ */
+static const int controlConnectionTimeoutSeconds = 10;
+
+/**
+ * Keeps a client that went away from raising SIGPIPE, macOS has no MSG_NOSIGNAL and sets SO_NOSIGPIPE on each connection instead.
+ */
+#ifdef __APPLE__
+static const int sendFlags = 0;
+#else
+static const int sendFlags = MSG_NOSIGNAL;
+#endif
+
+/**
+ * Writes all of data to a connection, returns false if the client went away.
+ */
+static bool writeControlResponse(int connection, const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t length = send(connection, data.data() + written, data.size() - written, sendFlags);
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            return false;
+        }
+        written += (size_t) length;
+    }
+    return true;
+}
+
+bool startControlSocket(const char* path, const ControlRequestDelegate& handleRequest) {
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        cerr << "Warning: control socket path " << path << " is too long" << endl;
+        return false;
+    }
+    strcpy(address.sun_path, path);
+
+    int descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (descriptor == -1) {
+        return false;
+    }
+    fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+    unlink(path);
+    // only the user running the application may connect
+    mode_t previousMask = umask(0077);
+    int bound = ::bind(descriptor, (struct sockaddr*) &address, sizeof(address));
+    umask(previousMask);
+    if (bound != 0 || listen(descriptor, 4) != 0) {
+        close(descriptor);
+        return false;
+    }
+    int wakePipe[2];
+    if (pipe(wakePipe) != 0) {
+        close(descriptor);
+        return false;
+    }
+    fcntl(wakePipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(wakePipe[1], F_SETFD, FD_CLOEXEC);
+    controlSocketWakeDescriptor = wakePipe[1];
+    controlSocketPath = path;
+    atexit(removeControlSocket);
+
+    // connections are served one at a time, each sends requests terminated by newlines and reads one response line per request
+    int wakeDescriptor = wakePipe[0];
+    thread([descriptor, wakeDescriptor, handleRequest]() {
+        for (;;) {
+            struct pollfd waiting[2] = {{descriptor, POLLIN, 0}, {wakeDescriptor, POLLIN, 0}};
+            if (poll(waiting, 2, -1) < 0 && errno != EINTR) {
+                break;
+            }
+            if (waiting[1].revents != 0) {
+                break;
+            }
+            if (waiting[0].revents == 0) {
+                continue;
+            }
+            int connection = accept(descriptor, nullptr, nullptr);
+            if (connection == -1) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                break;
+            }
+            fcntl(connection, F_SETFD, FD_CLOEXEC);
+#ifdef __APPLE__
+            int noSigPipe = 1;
+            setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+            struct timeval timeout = {controlConnectionTimeoutSeconds, 0};
+            setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            string received;
+            char buffer[4096];
+            ssize_t length;
+            bool open = true;
+            while (open && (length = read(connection, buffer, sizeof(buffer))) != 0) {
+                if (length < 0) {
+                    open = errno == EINTR;
+                    continue;
+                }
+                received.append(buffer, (size_t) length);
+                size_t newline;
+                while (open && (newline = received.find('\n')) != string::npos) {
+                    string request = received.substr(0, newline);
+                    received.erase(0, newline + 1);
+                    string response;
+                    {
+                        lock_guard<mutex> lock(controlRequestMutex);
+                        if (controlSocketStopped) {
+                            break;
+                        }
+                        response = handleRequest(request);
+                    }
+                    open = writeControlResponse(connection, response + "\n");
+                }
+                // requests are short commands, a client that doesn't send newlines is dropped
+                open = open && received.size() <= 64 * 1024;
+                lock_guard<mutex> lock(controlRequestMutex);
+                open = open && !controlSocketStopped;
+            }
+            close(connection);
+        }
+        close(descriptor);
+        close(wakeDescriptor);
+    }).detach();
+    return true;
+}
+
+void stopControlSocket() {
+    if (controlSocketWakeDescriptor == -1) {
+        return;
+    }
+    {
+        // waits for the request being handled
+        lock_guard<mutex> lock(controlRequestMutex);
+        controlSocketStopped = true;
+    }
+    removeControlSocket();
+    close(controlSocketWakeDescriptor);
+    controlSocketWakeDescriptor = -1;
+}
+
+#endif
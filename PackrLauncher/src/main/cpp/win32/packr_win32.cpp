@@ -17,11 +17,13 @@
 
 #include <Windows.h>
 #include <processenv.h>
+#include <psapi.h>
 
 #include <io.h>
 #include <fcntl.h>
 #include <iostream>
 #include <direct.h>
+#include <malloc.h>
 
 #include <csignal>
 #include <cstdio>
@@ -283,11 +285,13 @@ void loadLibraries(const TCHAR* libraryPattern) {
    FindClose(hFind);
 }
 
-bool loadJNIFunctions(const dropt_char* jrePath, GetDefaultJavaVMInitArgs *getDefaultJavaVMInitArgs, CreateJavaVM *createJavaVM) {
+bool loadJNIFunctions(const dropt_char* jrePath, const char* vmType, GetDefaultJavaVMInitArgs *getDefaultJavaVMInitArgs, CreateJavaVM *createJavaVM) {
    wstring backslashedJrePath = wstring(jrePath);
    std::replace(backslashedJrePath.begin(), backslashedJrePath.end(), L'/', L'\\');
+   wstring_convert<codecvt_utf8_utf16<wchar_t>> converter;
+   wstring vmDirectory = backslashedJrePath + L"\\bin\\" + converter.from_bytes(vmType);
    addDllDirectory((backslashedJrePath + L"\\bin").c_str());
-   addDllDirectory((backslashedJrePath + L"\\bin\\server").c_str());
+   addDllDirectory(vmDirectory.c_str());
 
    // Load every shared library in jre/bin because awt.dll doesn't load its dependent libraries using the correct search paths
    wstring allDllsWstring = backslashedJrePath + L"\\bin\\*.dll";
@@ -295,7 +299,7 @@ bool loadJNIFunctions(const dropt_char* jrePath, GetDefaultJavaVMInitArgs *getDe
    loadLibraries(allDlls);
 
    TCHAR jvmDllFullPath[FULL_PATH_SIZE] = TEXT("");
-   if (GetFullPathName((backslashedJrePath + L"\\bin\\server\\jvm.dll").c_str(), FULL_PATH_SIZE, jvmDllFullPath, nullptr) == 0) {
+   if (GetFullPathName((vmDirectory + L"\\jvm.dll").c_str(), FULL_PATH_SIZE, jvmDllFullPath, nullptr) == 0) {
       printLastError(TEXT("get the jvm.dll absolute path"));
       return false;
    }
@@ -333,6 +337,49 @@ bool changeWorkingDir(const dropt_char *directory) {
     return currentDirectory != 0;
 }
 
+bool createDirectory(const dropt_char *directory) {
+    return CreateDirectory(directory, nullptr) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+unsigned long getProcessId() {
+    return GetCurrentProcessId();
+}
+
+bool mapFile(const dropt_char *path, bool copyOnWrite, MappedFile *mapping) {
+    HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    // a copy-on-write view never writes back to the file
+    HANDLE fileMapping = CreateFileMapping(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (fileMapping == nullptr) {
+        return false;
+    }
+    void *data = MapViewOfFile(fileMapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    // the view keeps the mapping alive
+    CloseHandle(fileMapping);
+    if (data == nullptr) {
+        return false;
+    }
+    mapping->data = (char *) data;
+    mapping->length = (size_t) size.QuadPart;
+    return true;
+}
+
+void unmapFile(MappedFile *mapping) {
+    if (mapping->data != nullptr) {
+        UnmapViewOfFile(mapping->data);
+    }
+    mapping->data = nullptr;
+    mapping->length = 0;
+}
+
 /**
  * In Java 14, Windows 10 1803 is required for ZGC, see https://wiki.openjdk.java.net/display/zgc/Main#Main-SupportedPlatforms
  * for more information. Windows 10 1803 is build 17134.
@@ -369,4 +416,116 @@ bool isZgcSupported() {
     return false;
 }
 
+unsigned long long getPhysicalMemorySize() {
+    MEMORYSTATUSEX memoryStatus;
+    memoryStatus.dwLength = sizeof(memoryStatus);
+    if (!GlobalMemoryStatusEx(&memoryStatus)) {
+        return 0;
+    }
+    return memoryStatus.ullTotalPhys;
+}
+
+// Older SDKs don't define all of the processor feature constants
+#ifndef PF_SSSE3_INSTRUCTIONS_AVAILABLE
+#define PF_SSSE3_INSTRUCTIONS_AVAILABLE 36
+#endif
+#ifndef PF_SSE4_1_INSTRUCTIONS_AVAILABLE
+#define PF_SSE4_1_INSTRUCTIONS_AVAILABLE 37
+#endif
+#ifndef PF_SSE4_2_INSTRUCTIONS_AVAILABLE
+#define PF_SSE4_2_INSTRUCTIONS_AVAILABLE 38
+#endif
+#ifndef PF_AVX_INSTRUCTIONS_AVAILABLE
+#define PF_AVX_INSTRUCTIONS_AVAILABLE 39
+#endif
+#ifndef PF_AVX2_INSTRUCTIONS_AVAILABLE
+#define PF_AVX2_INSTRUCTIONS_AVAILABLE 40
+#endif
+#ifndef PF_AVX512F_INSTRUCTIONS_AVAILABLE
+#define PF_AVX512F_INSTRUCTIONS_AVAILABLE 41
+#endif
+
+bool hasCpuFeature(const char* feature) {
+    // the feature names match the flags in Linux /proc/cpuinfo
+    static const struct {
+        const char* name;
+        DWORD processorFeature;
+    } processorFeatures[] = {{"sse2",    PF_XMMI64_INSTRUCTIONS_AVAILABLE},
+                             {"pni",     PF_SSE3_INSTRUCTIONS_AVAILABLE},
+                             {"ssse3",   PF_SSSE3_INSTRUCTIONS_AVAILABLE},
+                             {"sse4_1",  PF_SSE4_1_INSTRUCTIONS_AVAILABLE},
+                             {"sse4_2",  PF_SSE4_2_INSTRUCTIONS_AVAILABLE},
+                             {"avx",     PF_AVX_INSTRUCTIONS_AVAILABLE},
+                             {"avx2",    PF_AVX2_INSTRUCTIONS_AVAILABLE},
+                             {"avx512f", PF_AVX512F_INSTRUCTIONS_AVAILABLE},
+                             {"neon",    PF_ARM_NEON_INSTRUCTIONS_AVAILABLE}};
+    for (const auto& processorFeature : processorFeatures) {
+        if (_stricmp(processorFeature.name, feature) == 0) {
+            return IsProcessorFeaturePresent(processorFeature.processorFeature) != 0;
+        }
+    }
+    if (verbose) {
+        cout << "Unknown CPU feature " << feature << " on Windows" << endl;
+    }
+    return false;
+}
+
+bool superviseChildProcesses(const SupervisedChildDelegate& child, bool useStandby, int* exitCode) {
+    return false;
+}
+
+bool startControlSocket(const char *path, const ControlRequestDelegate &handleRequest) {
+    return false;
+}
+
+void stopControlSocket() {
+}
+
+void setNativeStackCapturable(bool capturable) {
+}
+
+bool writeNativeStacks(ostream& out) {
+    return false;
+}
+
+bool readMemoryPressure(MemoryPressure* pressure) {
+    return false;
+}
+
+void applyProcessPriority(const ProcessPriority& priority) {
+    if (priority.ioClass == "idle") {
+        // background mode lowers the CPU, I/O, and memory priorities together
+        if (!SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN)) {
+            cerr << "Warning: failed to enter background mode, error " << GetLastError() << endl;
+        }
+    } else if (priority.hasNice) {
+        DWORD priorityClass = priority.nice >= 15 ? IDLE_PRIORITY_CLASS
+                            : priority.nice > 0 ? BELOW_NORMAL_PRIORITY_CLASS
+                            : priority.nice < 0 ? ABOVE_NORMAL_PRIORITY_CLASS : NORMAL_PRIORITY_CLASS;
+        if (!SetPriorityClass(GetCurrentProcess(), priorityClass)) {
+            cerr << "Warning: failed to set the priority class, error " << GetLastError() << endl;
+        }
+    }
+    if (!priority.scheduler.empty() || priority.hasOomScoreAdjust || (!priority.ioClass.empty() && priority.ioClass != "idle")) {
+        cerr << "Warning: only the nice value and the idle I/O class are supported on Windows" << endl;
+    }
+}
+
+bool remapJvmTextOntoHugePages() {
+    return false;
+}
+
+unsigned long long getResidentMemorySize() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+}
+
+void releaseFreeHeapMemory() {
+    // decommits the free pages of the C runtime heap
+    _heapmin();
+}
+
 #endif
@@ -18,7 +18,9 @@
 #include <functional>
 #include <jni.h>
 #include <dropt.h>
+#include <ostream>
 #include <string>
+#include <vector>
 
 #if !defined(JNI_VERSION_1_8)
 # define JNI_VERSION_1_8 0x00010008
@@ -30,25 +32,123 @@ typedef jint(JNICALL *CreateJavaVM)(JavaVM**, void**, void*);
 typedef std::function<void* (void*)> LaunchJavaVMDelegate;
 typedef std::function<void (LaunchJavaVMDelegate delegate, const JavaVMInitArgs& args)> LaunchJavaVMCallback;
 
+/* blocks a standby process until it becomes the active one, returns false if it should exit instead */
+typedef std::function<bool ()> WaitForReleaseDelegate;
+typedef std::function<void (const WaitForReleaseDelegate& waitForRelease)> SupervisedChildDelegate;
+
+/* a whole file mapped into memory by mapFile() */
+struct MappedFile {
+	char* data;
+	size_t length;
+};
+
+/* memory pressure of the system or the cgroup the process runs in */
+struct MemoryPressure {
+	/* percent of the last 10 seconds some tasks stalled waiting for memory */
+	double someAvg10;
+	/* percent of the last 10 seconds all tasks stalled waiting for memory */
+	double fullAvg10;
+	/* times the cgroup hit its memory.high or memory.max limit or ran out of memory, 0 outside a cgroup v2 */
+	unsigned long long limitEvents;
+};
+
+/* scheduling settings the launcher applies before it creates the JVM, whose threads inherit them */
+struct ProcessPriority {
+	/* nice value from -20 to 19, applied if hasNice is set */
+	bool hasNice;
+	int nice;
+	/* "other", "batch", or "idle", empty to keep the scheduling policy */
+	std::string scheduler;
+	/* "realtime", "best-effort", or "idle", empty to keep the I/O scheduling class */
+	std::string ioClass;
+	/* I/O priority within the class from 0, the highest, to 7 */
+	int ioPriority;
+	/* adjustment of the score the out of memory killer picks processes by, from -1000 to 1000, applied if hasOomScoreAdjust is set */
+	bool hasOomScoreAdjust;
+	int oomScoreAdjust;
+};
+
+/* answers one request line of the control socket with one response line, without the newline */
+typedef std::function<std::string (const std::string& request)> ControlRequestDelegate;
+
 #define defaultLaunchVMDelegate \
 	[](LaunchJavaVMDelegate delegate, const JavaVMInitArgs&) { delegate(nullptr); }
 
 extern "C" {
 	/* configuration */
 	extern bool verbose;
+	extern bool tracing;
 
 	/* platform-dependent constants */
 	extern const char __CLASS_PATH_DELIM;
 
 	/* platform-dependent functions */
-	bool loadJNIFunctions(const dropt_char* jrePath, GetDefaultJavaVMInitArgs* getDefaultJavaVMInitArgs, CreateJavaVM* createJavaVM);
+	bool loadJNIFunctions(const dropt_char* jrePath, const char* vmType, GetDefaultJavaVMInitArgs* getDefaultJavaVMInitArgs, CreateJavaVM* createJavaVM);
 	const dropt_char* getExecutablePath(const dropt_char* argv0);
 
 	bool changeWorkingDir(const dropt_char* directory);
 
-	/* entry point for all platforms - called from main()/WinMain() */
+	/* creates a directory, returns true if it exists afterwards */
+	bool createDirectory(const dropt_char* directory);
+	unsigned long getProcessId();
+
+	/* maps a file read-only, or writable without writing changes back to the file if copyOnWrite is set */
+	bool mapFile(const dropt_char* path, bool copyOnWrite, MappedFile* mapping);
+	void unmapFile(MappedFile* mapping);
+
+	/* entry point for all platforms - called from main()/WinMain(), argv must stay valid until launchJavaVM() returns */
 	bool setCmdLineArguments(int argc, dropt_char** argv);
 	void launchJavaVM(const LaunchJavaVMCallback& callback);
 
+	/* prints a startup trace marker if tracing is enabled */
+	void tracePhase(const char* phase);
+
 	bool isZgcSupported();
+
+	/* hardware information for choosing among the "jreVariants" of the configuration */
+	unsigned long long getPhysicalMemorySize();
+	bool hasCpuFeature(const char* feature);
+
+	/* runs child in supervised processes until the active one exits cleanly, returns false if the platform can't supervise */
+	bool superviseChildProcesses(const SupervisedChildDelegate& child, bool useStandby, int* exitCode);
+
+	/* serves requests on a Unix domain socket at path from a background thread, returns false if the platform can't */
+	bool startControlSocket(const char* path, const ControlRequestDelegate& handleRequest);
+
+	/* stops accepting control connections and waits for the request being handled, no request is handled once it returns */
+	void stopControlSocket();
+
+	/* lets writeNativeStacks() capture the calling thread, which has to call it with false before it creates or attaches to the JVM */
+	void setNativeStackCapturable(bool capturable);
+
+	/* writes the native stacks of the other capturable threads, returns false if the platform can't capture them; best-effort, the stacks
+	 * are unwound in a signal handler, which isn't async-signal-safe, so a thread interrupted in the dynamic loader may hang or not respond */
+	bool writeNativeStacks(std::ostream& out);
+
+	/* reads the current memory pressure, returns false if the platform doesn't report it */
+	bool readMemoryPressure(MemoryPressure* pressure);
+
+	/* applies the settings to the calling thread, and to the process where they're per process, and warns about those that fail */
+	void applyProcessPriority(const ProcessPriority& priority);
+
+	/* copies the executable segment of the loaded JVM library onto transparent huge pages, must run before the JVM is created,
+	 * returns false if the platform, the kernel, or the library layout doesn't allow it, the code stays usable either way */
+	bool remapJvmTextOntoHugePages();
+
+	/* the bytes of physical memory the process uses, 0 if the platform doesn't report it */
+	unsigned long long getResidentMemorySize();
+
+	/* returns free memory of the C heap to the operating system where the allocator keeps it otherwise */
+	void releaseFreeHeapMemory();
 }
+
+/* appends the arguments of a UTF-8 encoded "@file" argument file path, the strings stay valid until the launcher exits,
+ * C++ linkage because it takes a std::vector */
+bool readArgumentFile(const char* path, std::vector<const char*>& arguments);
+
+/* drops VM options that a later option overrides, e.g. all but the last "-Xmx", C++ linkage because it returns a std::vector */
+std::vector<const char*> mergeVmOptions(const std::vector<const char*>& options);
+
+/* the VM options that record a diagnostics profile into the UTF-8 encoded runDirectory, empty if the JVM can't take the path,
+ * C++ linkage because it returns a std::vector */
+std::vector<std::string> getProfileVmOptions(const std::string& runDirectory, int maxRecordingSizeMb);
@@ -27,6 +27,7 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
 #include <limits.h>
@@ -45,6 +46,26 @@
 #define SAJSON_UNLIKELY(x) x
 #endif
 
+// Whitespace and strings are scanned 16 bytes at a time with SSE2 or NEON,
+// and 32 bytes at a time if the CPU supports AVX2. Defining SAJSON_NO_SIMD
+// restricts the parser to the scalar scanning loops.
+#ifndef SAJSON_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAJSON_SSE2
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SAJSON_AVX2
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) && (defined(__GNUC__) || defined(__clang__))
+#define SAJSON_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
 namespace sajson {
     enum type {
         TYPE_INTEGER = 0,
@@ -71,25 +92,238 @@ namespace sajson {
         }
     }
 
+    // One slot of the parsed structure. Defining SAJSON_32BIT_OFFSETS halves
+    // the structure footprint on 64-bit platforms, but limits the input to
+    // 4 GiB and the structure to 2^29 slots.
+#ifdef SAJSON_32BIT_OFFSETS
+    typedef uint32_t structure_word;
+#else
+    typedef size_t structure_word;
+#endif
+
     static const size_t TYPE_BITS = 3;
-    static const size_t TYPE_SHIFT = sizeof(size_t) * 8 - TYPE_BITS;
+    static const size_t TYPE_SHIFT = sizeof(structure_word) * 8 - TYPE_BITS;
     static const size_t TYPE_MASK = (1 << TYPE_BITS) - 1;
-    static const size_t VALUE_MASK = size_t(-1) >> TYPE_BITS;
+    static const structure_word VALUE_MASK = structure_word(-1) >> TYPE_BITS;
 
-    static const size_t ROOT_MARKER = size_t(-1) & VALUE_MASK;
+    static const structure_word ROOT_MARKER = structure_word(-1) & VALUE_MASK;
 
-    inline type get_element_type(size_t s) {
+    inline type get_element_type(structure_word s) {
         return static_cast<type>((s >> TYPE_SHIFT) & TYPE_MASK);
     }
 
-    inline size_t get_element_value(size_t s) {
+    inline structure_word get_element_value(structure_word s) {
         return s & VALUE_MASK;
     }
 
-    inline size_t make_element(type t, size_t value) {
+    inline structure_word make_element(type t, size_t value) {
         //assert(value & VALUE_MASK == 0);
         //value &= VALUE_MASK;
-        return value | (static_cast<size_t>(t) << TYPE_SHIFT);
+        return static_cast<structure_word>(value) | (static_cast<structure_word>(t) << TYPE_SHIFT);
+    }
+
+    // How the parser looks for the end of whitespace runs and of string
+    // contents that need no unescaping.
+    enum scan_mode {
+        SCAN_SCALAR,
+        SCAN_VECTOR, // SSE2 or NEON
+        SCAN_AVX2,
+    };
+
+    inline bool is_whitespace(char c) {
+        return c == 0x20 || c == 0x09 || c == 0x0A || c == 0x0D;
+    }
+
+    // Quotes, backslashes and control characters end the plain part of a string.
+    inline bool is_string_special(char c) {
+        return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+    }
+
+    inline size_t whitespace_length_scalar(const char* p, const char* end) {
+        const char* start = p;
+        while (p < end && is_whitespace(*p)) {
+            ++p;
+        }
+        return p - start;
+    }
+
+    inline size_t plain_string_length_scalar(const char* p, const char* end) {
+        const char* start = p;
+        while (p < end && !is_string_special(*p)) {
+            ++p;
+        }
+        return p - start;
+    }
+
+#if defined(SAJSON_SSE2) || defined(SAJSON_NEON)
+    inline unsigned first_set_bit(unsigned long long mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        // only the SSE2 masks of up to 32 bits are used with MSVC
+        unsigned long index;
+        _BitScanForward(&index, static_cast<unsigned long>(mask));
+        return index;
+#else
+        return __builtin_ctzll(mask);
+#endif
+    }
+#endif
+
+#ifdef SAJSON_SSE2
+    inline size_t whitespace_length_vector(const char* p, const char* end) {
+        const char* start = p;
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i whitespace = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x20)), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x09))),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x0A)), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x0D))));
+            unsigned other = ~static_cast<unsigned>(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+            if (other) {
+                return p - start + first_set_bit(other);
+            }
+            p += 16;
+        }
+        return p - start + whitespace_length_scalar(p, end);
+    }
+
+    inline size_t plain_string_length_vector(const char* p, const char* end) {
+        const char* start = p;
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            // unsigned chunk <= 0x1F
+            __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(chunk, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+            __m128i special = _mm_or_si128(control,
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+            if (mask) {
+                return p - start + first_set_bit(mask);
+            }
+            p += 16;
+        }
+        return p - start + plain_string_length_scalar(p, end);
+    }
+#endif
+
+#ifdef SAJSON_AVX2
+    __attribute__((target("avx2")))
+    inline size_t whitespace_length_avx2(const char* p, const char* end) {
+        const char* start = p;
+        while (end - p >= 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i whitespace = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(0x20)), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(0x09))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(0x0A)), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(0x0D))));
+            unsigned other = ~static_cast<unsigned>(_mm256_movemask_epi8(whitespace));
+            if (other) {
+                return p - start + first_set_bit(other);
+            }
+            p += 32;
+        }
+        return p - start + whitespace_length_vector(p, end);
+    }
+
+    __attribute__((target("avx2")))
+    inline size_t plain_string_length_avx2(const char* p, const char* end) {
+        const char* start = p;
+        while (end - p >= 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F));
+            __m256i special = _mm256_or_si256(control,
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(special));
+            if (mask) {
+                return p - start + first_set_bit(mask);
+            }
+            p += 32;
+        }
+        return p - start + plain_string_length_vector(p, end);
+    }
+#endif
+
+#ifdef SAJSON_NEON
+    // Narrows a byte mask to four bits per byte, the first set nibble marks the first match.
+    inline unsigned long long neon_nibble_mask(uint8x16_t matches) {
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+    }
+
+    inline size_t whitespace_length_vector(const char* p, const char* end) {
+        const char* start = p;
+        while (end - p >= 16) {
+            uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+            uint8x16_t whitespace = vorrq_u8(
+                vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(0x20)), vceqq_u8(chunk, vdupq_n_u8(0x09))),
+                vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(0x0A)), vceqq_u8(chunk, vdupq_n_u8(0x0D))));
+            unsigned long long other = ~neon_nibble_mask(whitespace);
+            if (other) {
+                return p - start + first_set_bit(other) / 4;
+            }
+            p += 16;
+        }
+        return p - start + whitespace_length_scalar(p, end);
+    }
+
+    inline size_t plain_string_length_vector(const char* p, const char* end) {
+        const char* start = p;
+        while (end - p >= 16) {
+            uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+            uint8x16_t special = vorrq_u8(vcltq_u8(chunk, vdupq_n_u8(0x20)),
+                vorrq_u8(vceqq_u8(chunk, vdupq_n_u8('"')), vceqq_u8(chunk, vdupq_n_u8('\\'))));
+            unsigned long long mask = neon_nibble_mask(special);
+            if (mask) {
+                return p - start + first_set_bit(mask) / 4;
+            }
+            p += 16;
+        }
+        return p - start + plain_string_length_scalar(p, end);
+    }
+#endif
+
+    // The fastest scan mode this build and CPU support.
+    inline scan_mode get_supported_scan_mode() {
+#if defined(SAJSON_AVX2)
+        static const bool has_avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+        return has_avx2 ? SCAN_AVX2 : SCAN_VECTOR;
+#elif defined(SAJSON_SSE2) || defined(SAJSON_NEON)
+        return SCAN_VECTOR;
+#else
+        return SCAN_SCALAR;
+#endif
+    }
+
+    // Modes this build doesn't support fall back to the next narrower one.
+    inline size_t whitespace_length(scan_mode mode, const char* p, const char* end) {
+        switch (mode) {
+#ifdef SAJSON_AVX2
+            case SCAN_AVX2:
+                return whitespace_length_avx2(p, end);
+#endif
+#if defined(SAJSON_SSE2) || defined(SAJSON_NEON)
+#ifndef SAJSON_AVX2
+            case SCAN_AVX2:
+#endif
+            case SCAN_VECTOR:
+                return whitespace_length_vector(p, end);
+#endif
+            default:
+                return whitespace_length_scalar(p, end);
+        }
+    }
+
+    inline size_t plain_string_length(scan_mode mode, const char* p, const char* end) {
+        switch (mode) {
+#ifdef SAJSON_AVX2
+            case SCAN_AVX2:
+                return plain_string_length_avx2(p, end);
+#endif
+#if defined(SAJSON_SSE2) || defined(SAJSON_NEON)
+#ifndef SAJSON_AVX2
+            case SCAN_AVX2:
+#endif
+            case SCAN_VECTOR:
+                return plain_string_length_vector(p, end);
+#endif
+            default:
+                return plain_string_length_scalar(p, end);
+        }
     }
 
     class string {
@@ -127,9 +361,9 @@ namespace sajson {
 
     struct object_key_record
     {
-        size_t key_start;
-        size_t key_end;
-        size_t value;
+        structure_word key_start;
+        structure_word key_end;
+        structure_word value;
     };
 
     struct object_key_comparator
@@ -204,10 +438,21 @@ namespace sajson {
         mutable_string_view()
             : length(0)
             , data(0)
+            , owns(false)
+        {}
+
+        // Views a caller-owned buffer without copying it. The parser
+        // writes into the buffer, and the buffer must outlive every
+        // document parsed from it.
+        mutable_string_view(size_t length, char* data)
+            : length(length)
+            , data(data)
+            , owns(false)
         {}
 
         mutable_string_view(const literal& s)
             : length(s.length())
+            , owns(true)
         {
             data = new char[length];
             memcpy(data, s.data(), length);
@@ -215,13 +460,14 @@ namespace sajson {
 
         mutable_string_view(const string& s)
             : length(s.length())
+            , owns(true)
         {
             data = new char[length];
             memcpy(data, s.data(), length);
         }
 
         ~mutable_string_view() {
-            if (uses.count() == 1) {
+            if (uses.count() == 1 && owns) {
                 delete[] data;
             }
         }
@@ -238,29 +484,30 @@ namespace sajson {
         refcount uses;
         size_t length;
         char* data;
+        bool owns;
     };
 
     union integer_storage {
         int i;
-        size_t u;
+        structure_word u;
     };
     // TODO: reinstate with c++03 implementation
     //static_assert(sizeof(integer_storage) == sizeof(size_t), "integer_storage must have same size as one structure slot");
 
     union double_storage {
         enum {
-            word_length = sizeof(double) / sizeof(size_t)
+            word_length = sizeof(double) / sizeof(structure_word)
         };
 
 #if defined(_M_IX86) || defined(__i386__) || defined(_X86_)
-        static double load(const size_t* location) {
+        static double load(const structure_word* location) {
             return *reinterpret_cast<const double*>(location);
         }
-        static void store(size_t* location, double value) {
+        static void store(structure_word* location, double value) {
             *reinterpret_cast<double*>(location) = value;
         }
 #else
-        static double load(const size_t* location) {
+        static double load(const structure_word* location) {
             double_storage s;
             for (unsigned i = 0; i < double_storage::word_length; ++i) {
                 s.u[i] = location[i];
@@ -268,7 +515,7 @@ namespace sajson {
             return s.d;
         }
 
-        static void store(size_t* location, double value) {
+        static void store(structure_word* location, double value) {
             double_storage ns;
             ns.d = value;
 
@@ -278,7 +525,7 @@ namespace sajson {
         }
 
         double d;
-        size_t u[word_length];
+        structure_word u[word_length];
 #endif
     };
     // TODO: reinstate with c++03 implementation
@@ -286,7 +533,7 @@ namespace sajson {
 
     class value {
     public:
-        explicit value(type value_type, const size_t* payload, const char* text)
+        explicit value(type value_type, const structure_word* payload, const char* text)
             : value_type(value_type)
             , payload(payload)
             , text(text)
@@ -305,21 +552,21 @@ namespace sajson {
         // valid iff get_type() is TYPE_ARRAY
         value get_array_element(size_t index) const {
             assert_type(TYPE_ARRAY);
-            size_t element = payload[1 + index];
+            structure_word element = payload[1 + index];
             return value(get_element_type(element), payload + get_element_value(element), text);
         }
 
         // valid iff get_type() is TYPE_OBJECT
         string get_object_key(size_t index) const {
             assert_type(TYPE_OBJECT);
-            const size_t* s = payload + 1 + index * 3;
+            const structure_word* s = payload + 1 + index * 3;
             return string(text + s[0], s[1] - s[0]);
         }
 
         // valid iff get_type() is TYPE_OBJECT
         value get_object_value(size_t index) const {
             assert_type(TYPE_OBJECT);
-            size_t element = payload[3 + index * 3];
+            structure_word element = payload[3 + index * 3];
             return value(get_element_type(element), payload + get_element_value(element), text);
         }
 
@@ -382,14 +629,14 @@ namespace sajson {
         }
 
         const type value_type;
-        const size_t* const payload;
+        const structure_word* const payload;
         const char* const text;
 
     };
 
     class document {
     public:
-        explicit document(mutable_string_view& input, const size_t* structure, type root_type, const size_t* root, size_t error_line, size_t error_column, const std::string& error_message)
+        explicit document(mutable_string_view& input, const structure_word* structure, type root_type, const structure_word* root, size_t error_line, size_t error_column, const std::string& error_message)
             : input(input)
             , structure(structure)
             , root_type(root_type)
@@ -441,9 +688,9 @@ namespace sajson {
 
     private:
         mutable_string_view input;
-        const size_t* structure;
+        const structure_word* structure;
         const type root_type;
-        const size_t* const root;
+        const structure_word* const root;
         const size_t error_line;
         const size_t error_column;
         const std::string error_message;
@@ -451,16 +698,17 @@ namespace sajson {
 
     class parser {
     public:
-        parser(const mutable_string_view& msv, size_t* structure)
+        parser(const mutable_string_view& msv, structure_word* structure, size_t structure_length, scan_mode mode)
             : input(msv)
             , input_end(input.get_data() + input.get_length())
             , structure(structure)
             , p(input.get_data())
             , temp(structure)
             , root_type(TYPE_NULL)
-            , out(structure + input.get_length())
+            , out(structure + structure_length)
             , error_line(0)
             , error_column(0)
+            , mode(mode)
         {}
 
         document get_document() {
@@ -502,22 +750,12 @@ namespace sajson {
         }
 
         char peek_structure() {
-            for (;;) {
-                if (p == input_end) {
-                    // 0 is never legal as a structural character in json text so treat it as eof
-                    return 0;
-                }
-                switch (*p) {
-                    case 0x20:
-                    case 0x09:
-                    case 0x0A:
-                    case 0x0D:
-                        ++p;
-                        continue;
-                    default:
-                        return *p;
-                }
+            p += whitespace_length(mode, p, input_end);
+            if (p == input_end) {
+                // 0 is never legal as a structural character in json text so treat it as eof
+                return 0;
             }
+            return *p;
         }
 
         error_result error(const char* format, ...) {
@@ -573,7 +811,7 @@ namespace sajson {
             }
             ++p;
 
-            size_t* current_base = temp;
+            structure_word* current_base = temp;
             *temp++ = make_element(current_structure_type, ROOT_MARKER);
 
             parse_result result = error_result();
@@ -610,7 +848,7 @@ namespace sajson {
 
                 switch (peek_structure()) {
                     type next_type;
-                    parse_result (parser::*structure_installer)(size_t* base);
+                    parse_result (parser::*structure_installer)(structure_word* base);
 
                     case 0:
                         return error("unexpected end of input");
@@ -648,7 +886,7 @@ namespace sajson {
                         goto push;
                     push: {
                         ++p;
-                        size_t* previous_base = current_base;
+                        structure_word* previous_base = current_base;
                         current_base = temp;
                         *temp++ = make_element(current_structure_type, previous_base - structure);
                         current_structure_type = next_type;
@@ -671,9 +909,9 @@ namespace sajson {
                         }
                     pop: {
                         ++p;
-                        size_t element = *current_base;
+                        structure_word element = *current_base;
                         result = (this->*structure_installer)(current_base + 1);
-                        size_t parent = get_element_value(element);
+                        structure_word parent = get_element_value(element);
                         if (parent == ROOT_MARKER) {
                             root_type = result.value_type;
                             goto done;
@@ -948,9 +1186,9 @@ namespace sajson {
             }
         }
 
-        parse_result install_array(size_t* array_base) {
+        parse_result install_array(structure_word* array_base) {
             const size_t length = temp - array_base;
-            size_t* const new_base = out - length - 1;
+            structure_word* const new_base = out - length - 1;
             while (temp > array_base) {
                 // I think this addition is legal because the tag bits are at the top?
                 *(--out) = *(--temp) + (array_base - new_base);
@@ -960,7 +1198,7 @@ namespace sajson {
             return TYPE_ARRAY;
         }
 
-        parse_result install_object(size_t* object_base) {
+        parse_result install_object(structure_word* object_base) {
             const size_t length = (temp - object_base) / 3;
             object_key_record* oir = reinterpret_cast<object_key_record*>(object_base);
             std::sort(
@@ -968,7 +1206,7 @@ namespace sajson {
                 oir + length,
                 object_key_comparator(input.get_data()));
 
-            size_t* const new_base = out - length * 3 - 1;
+            structure_word* const new_base = out - length * 3 - 1;
             size_t i = length;
             while (i--) {
                 // I think this addition is legal because the tag bits are at the top?
@@ -981,7 +1219,7 @@ namespace sajson {
             return TYPE_OBJECT;
         }
 
-        parse_result parse_string(size_t* tag = 0) {
+        parse_result parse_string(structure_word* tag = 0) {
             if (!tag) {
                 out -= 2;
                 tag = out;
@@ -989,30 +1227,22 @@ namespace sajson {
 
             ++p; // "
             size_t start = p - input.get_data();
-            for (;;) {
-                if (SAJSON_UNLIKELY(p >= input_end)) {
-                    return error("unexpected end of input");
-                }
-
-                if (SAJSON_UNLIKELY(*p >= 0 && *p < 0x20)) {
-                    return error("illegal unprintable codepoint in string: %d", static_cast<int>(*p));
-                }
-
-                switch (*p) {
-                    case '"':
-                        tag[0] = start;
-                        tag[1] = p - input.get_data();
-                        ++p;
-                        return TYPE_STRING;
+            p += plain_string_length(mode, p, input_end);
+            if (SAJSON_UNLIKELY(p >= input_end)) {
+                return error("unexpected end of input");
+            }
 
-                    case '\\':
-                        return parse_string_slow(tag, start);
+            if (SAJSON_UNLIKELY(*p >= 0 && *p < 0x20)) {
+                return error("illegal unprintable codepoint in string: %d", static_cast<int>(*p));
+            }
 
-                    default:
-                        ++p;
-                        break;
-                }
+            if (*p == '"') {
+                tag[0] = start;
+                tag[1] = p - input.get_data();
+                ++p;
+                return TYPE_STRING;
             }
+            return parse_string_slow(tag, start);
         }
 
         parse_result read_hex(unsigned& u) {
@@ -1055,10 +1285,17 @@ namespace sajson {
             }
         }
 
-        parse_result parse_string_slow(size_t* tag, size_t start) {
+        parse_result parse_string_slow(structure_word* tag, size_t start) {
             char* end = p;
 
             for (;;) {
+                size_t plain_length = plain_string_length(mode, p, input_end);
+                if (plain_length) {
+                    memmove(end, p, plain_length);
+                    end += plain_length;
+                    p += plain_length;
+                }
+
                 if (SAJSON_UNLIKELY(p >= input_end)) {
                     return error("unexpected end of input");
                 }
@@ -1142,24 +1379,74 @@ namespace sajson {
 
         mutable_string_view input;
         char* const input_end;
-        size_t* const structure;
+        structure_word* const structure;
 
         char* p;
-        size_t* temp;
+        structure_word* temp;
         type root_type;
-        size_t* out;
+        structure_word* out;
         size_t error_line;
         size_t error_column;
         std::string error_message;
+        const scan_mode mode;
     };
 
-    template<typename StringType>
-    document parse(const StringType& string) {
-        mutable_string_view ms(string);
+    // Bounds the number of structure slots needed to parse the input. Every
+    // element is the first one of its array or object or follows a comma. It
+    // takes at most three slots in its parent (key and value of an object
+    // member) and at most two for its payload, except for arrays and objects
+    // which take one slot for their length. The input length bounds it too,
+    // and is the tighter bound for long lists of short numbers.
+    inline size_t get_structure_length(const char* data, size_t length) {
+        size_t commas = 0;
+        size_t containers = 0;
+        bool in_string = false;
+        const char* const end = data + length;
+        for (const char* p = data; p < end; ++p) {
+            if (in_string) {
+                if (*p == '\\') {
+                    ++p;
+                } else if (*p == '"') {
+                    in_string = false;
+                }
+                continue;
+            }
+            switch (*p) {
+                case '"':
+                    in_string = true;
+                    break;
+                case ',':
+                    ++commas;
+                    break;
+                case '[':
+                case '{':
+                    ++containers;
+                    break;
+                default:
+                    break;
+            }
+        }
+        size_t elements = commas + containers;
+        return std::min(length, containers + 5 * elements);
+    }
 
-        size_t length = string.length();
-        size_t* structure = new size_t[length];
+    // Parses in situ: strings are unescaped inside the viewed buffer, so a
+    // read-only input has to be mapped copy-on-write.
+    inline document parse(const mutable_string_view& input, scan_mode mode = get_supported_scan_mode()) {
+        size_t structure_length = get_structure_length(input.get_data(), input.get_length());
+#ifdef SAJSON_32BIT_OFFSETS
+        if (input.get_length() > UINT32_MAX || structure_length >= VALUE_MASK) {
+            mutable_string_view view(input);
+            return document(view, 0, TYPE_NULL, 0, 1, 1, "input too large for 32-bit offsets");
+        }
+#endif
+        structure_word* structure = new structure_word[structure_length];
 
-        return parser(ms, structure).get_document();
+        return parser(input, structure, structure_length, mode).get_document();
+    }
+
+    template<typename StringType>
+    document parse(const StringType& string, scan_mode mode = get_supported_scan_mode()) {
+        return parse(mutable_string_view(string), mode);
     }
 }
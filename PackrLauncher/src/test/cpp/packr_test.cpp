@@ -2,6 +2,16 @@
 #include "packr.h"
 #include "dropt_string.h"
 
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
 #ifdef _WIN32
 
 #include <Windows.h>
@@ -215,4 +225,162 @@ TEST(PackrLauncherTest, test_setCmdLineArguments) {
         delete[](commandLineArguments[argumentIndex]);
     }
     delete[](commandLineArguments);
-}
\ No newline at end of file
+}
+
+/**
+ * Writes content to an argument file and reads it back.
+ */
+static vector<string> readArgumentFileContent(const string &content, bool *success) {
+    const char *fileName = "packr_test_arguments.txt";
+    {
+        ofstream out(fileName, ios::out | ios::binary | ios::trunc);
+        out.write(content.data(), content.size());
+    }
+    vector<const char *> arguments;
+    *success = readArgumentFile(fileName, arguments);
+    remove(fileName);
+    return vector<string>(arguments.begin(), arguments.end());
+}
+
+TEST(PackrLauncherTest, test_readArgumentFile) {
+    bool success = false;
+    vector<string> arguments = readArgumentFileContent(
+            "# a comment line\n"
+            "plain  -Dname=\"quoted value\"\t'single \"quoted\"'\r\n"
+            "C:\\unquoted\\backslash \"escapes \\\" \\\\ \\n\" \"\" not#comment\n"
+            "\"continued \\\n    line\"", &success);
+    ASSERT_TRUE(success);
+    vector<string> expected = {"plain", "-Dname=quoted value", "single \"quoted\"", "C:\\unquoted\\backslash", "escapes \" \\ \n", "",
+                               "not#comment", "continued line"};
+    EXPECT_EQ(expected, arguments);
+
+    readArgumentFileContent("\"unterminated", &success);
+    EXPECT_FALSE(success);
+
+    vector<const char *> missing;
+    EXPECT_FALSE(readArgumentFile("packr_test_missing_arguments.txt", missing));
+}
+
+TEST(PackrLauncherTest, test_readArgumentFile_spanning_chunks) {
+    // several times the read chunk size, so arguments, quotes, and escapes span chunks at many offsets
+    vector<string> expected;
+    string content;
+    for (int index = 0; index < 30000; index++) {
+        string path = "/data/batch/input-" + to_string(index) + ".csv";
+        if (index % 3 == 0) {
+            expected.push_back(path + " with\ttab");
+            content.append("\"").append(path).append(" with\\ttab\"\n");
+        } else {
+            expected.push_back(path);
+            content.append(path).append(index % 2 == 0 ? " " : "\r\n");
+        }
+    }
+    expected.push_back(string(100000, 'x'));
+    content.append(expected.back());
+
+    bool success = false;
+    vector<string> arguments = readArgumentFileContent(content, &success);
+    ASSERT_TRUE(success);
+    EXPECT_EQ(expected, arguments);
+}
+
+TEST(PackrLauncherTest, test_mergeVmOptions) {
+    vector<const char *> options = {"-XX:+UnlockExperimentalVMOptions", "-XX:+UseZGC", "-Xmx1G", "-Dapp.mode=release", "-XX:+AlwaysPreTouch",
+                                    "-XX:MaxMetaspaceSize=256m", "-Xlog:gc", "-Dapp.name=packr", "-Xmx4G", "-XX:+UseG1GC", "-XX:-AlwaysPreTouch",
+                                    "-Dapp.mode=debug", "-XX:MaxMetaspaceSize=512m", "-Xlog:gc", "-Xlog:safepoint", "-Xms64m"};
+    vector<const char *> merged = mergeVmOptions(options);
+    vector<string> expected = {"-XX:+UnlockExperimentalVMOptions", "-Dapp.name=packr", "-Xmx4G", "-XX:+UseG1GC", "-XX:-AlwaysPreTouch",
+                               "-Dapp.mode=debug", "-XX:MaxMetaspaceSize=512m", "-Xlog:gc", "-Xlog:safepoint", "-Xms64m"};
+    EXPECT_EQ(expected, vector<string>(merged.begin(), merged.end()));
+
+    EXPECT_TRUE(mergeVmOptions({}).empty());
+}
+
+TEST(PackrLauncherTest, test_getProfileVmOptions_with_comma) {
+    vector<string> options = getProfileVmOptions("/tmp/profiles,a=b/app", 80);
+    ASSERT_EQ(6u, options.size());
+    EXPECT_EQ("-Xlog:class+load=info:file=\"/tmp/profiles,a=b/app/class-load.log\":uptime,tid:filecount=5,filesize=10m", options[0]);
+    EXPECT_EQ("-XX:FlightRecorderOptions=repository=\"/tmp/profiles,a=b/app/jfr\",maxchunksize=10m", options[3]);
+    EXPECT_EQ("-XX:StartFlightRecording=name=packr-profile,settings=default,disk=true,dumponexit=true,maxsize=80m,"
+              "filename=\"/tmp/profiles,a=b/app/recording.jfr\"", options[4]);
+    EXPECT_EQ("-XX:ErrorFile=/tmp/profiles,a=b/app/hs_err.log", options[5]);
+
+    EXPECT_TRUE(getProfileVmOptions("/tmp/profiles\"/app", 80).empty());
+    EXPECT_TRUE(getProfileVmOptions("/tmp/profiles%p/app", 80).empty());
+}
+
+TEST(PackrLauncherTest, test_writeNativeStacks) {
+    mutex waitMutex;
+    condition_variable stop;
+    bool started = false;
+    bool stopped = false;
+    thread waiting([&]() {
+        setNativeStackCapturable(true);
+        unique_lock<mutex> lock(waitMutex);
+        started = true;
+        stop.notify_all();
+        stop.wait(lock, [&]() { return stopped; });
+        setNativeStackCapturable(false);
+    });
+    {
+        unique_lock<mutex> lock(waitMutex);
+        stop.wait(lock, [&]() { return started; });
+    }
+
+    ostringstream stacks;
+    bool written = writeNativeStacks(stacks);
+    {
+        lock_guard<mutex> lock(waitMutex);
+        stopped = true;
+    }
+    stop.notify_all();
+    waiting.join();
+
+#ifdef __linux__
+    ASSERT_TRUE(written);
+    EXPECT_NE(string::npos, stacks.str().find("Thread ")) << stacks.str();
+    EXPECT_NE(string::npos, stacks.str().find("  #0 ")) << stacks.str();
+    EXPECT_EQ(string::npos, stacks.str().find("didn't respond")) << stacks.str();
+#else
+    EXPECT_FALSE(written);
+#endif
+}
+
+TEST(PackrLauncherTest, test_readMemoryPressure) {
+    MemoryPressure pressure;
+    if (!readMemoryPressure(&pressure)) {
+        // kernels before 4.20, or built without CONFIG_PSI, don't report it
+        return;
+    }
+    EXPECT_GE(pressure.someAvg10, 0.0);
+    EXPECT_LE(pressure.someAvg10, 100.0);
+    EXPECT_GE(pressure.fullAvg10, 0.0);
+    EXPECT_LE(pressure.fullAvg10, pressure.someAvg10);
+}
+
+TEST(PackrLauncherTest, test_releaseFreeHeapMemory) {
+    // small blocks come from the heap instead of their own mappings, the last one stays allocated so the heap can't just shrink from the top
+    const size_t blockSize = 4096;
+    const size_t blockCount = 16 * 1024;
+    vector<char *> blocks;
+    for (size_t blockIndex = 0; blockIndex <= blockCount; blockIndex++) {
+        blocks.push_back(new char[blockSize]);
+        memset(blocks.back(), 1, blockSize);
+    }
+    for (size_t blockIndex = 0; blockIndex < blockCount; blockIndex++) {
+        delete[] blocks[blockIndex];
+    }
+
+    unsigned long long residentBefore = getResidentMemorySize();
+    releaseFreeHeapMemory();
+    unsigned long long residentAfter = getResidentMemorySize();
+    delete[] blocks.back();
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+    // the freed 64 MB, less whatever glibc kept for the next allocations
+    EXPECT_GE(residentBefore, residentAfter + 32 * 1024 * 1024) << "before " << residentBefore << ", after " << residentAfter;
+#else
+    // other allocators, and the address sanitizer's, decide on their own when to give memory back
+    EXPECT_GT(residentBefore, 0u);
+#endif
+}
@@ -0,0 +1,227 @@
+#include "gtest/gtest.h"
+#include "packr.h"
+#include "sajson.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Documents covering every value type, escapes that sajson rewrites in place, and invalid input.
+ */
+static const char *const sajsonTestCorpus[] = {
+        "{}",
+        "[]",
+        "0",
+        "\"plain\"",
+        "[0, -1, 2147483647, -2147483648, 2147483648, 1.5, -0.25, 1e300, 6.02e-23, true, false, null]",
+        "{\"jrePath\": \"jre\", \"classPath\": [\"a.jar\", \"b.jar\"], \"mainClass\": \"com.my.App\", \"useZgcIfSupportedOs\": true}",
+        "{\"escapes\": \"quote \\\" backslash \\\\ slash \\/ controls \\b\\f\\n\\r\\t\", \"unicode\": \"\\u00e4\\u20ac\\ud83d\\ude00\"}",
+        "{\"nested\": {\"deeper\": [[[]], {\"a\": {\"b\": [1, {\"c\": \"\\u0041\"}]}}]}, \"after\": \"\\n\"}",
+        "  \n\t{ \"whitespace\" :\r\n [ 1 , 2 ] }  ",
+        "{\"vmArgs\": [\"-Xmx1G\", \"-Dpath=C:\\\\Program Files\\\\app\", \"-Dname=\\u00c4pp\"]}",
+        "[\"a,b[c{\", \"\\\"],{\", \"\\\\\", {\":\": [1.5,0.,1e1]}, [], {}]",
+        "[0,1,2,3,4,5,6,7,8,9,1.,2.,3.,\"\",\"\",\"\",{\"\":1.},{\"\":\"\"},[[[[]]]],[{}],-0.]",
+        "{\"unterminated\": \"string",
+        "{\"missingValue\": }",
+        "[1, 2,]",
+        "",
+};
+
+/**
+ * Asserts that two values have the same type and structure, and that strings and numbers have identical bytes.
+ */
+static void expectSameValue(const sajson::value &expected, const sajson::value &actual) {
+    ASSERT_EQ(expected.get_type(), actual.get_type());
+    switch (expected.get_type()) {
+        case sajson::TYPE_INTEGER:
+            EXPECT_EQ(expected.get_integer_value(), actual.get_integer_value());
+            break;
+        case sajson::TYPE_DOUBLE: {
+            double expectedDouble = expected.get_double_value();
+            double actualDouble = actual.get_double_value();
+            EXPECT_EQ(0, memcmp(&expectedDouble, &actualDouble, sizeof(double)));
+            break;
+        }
+        case sajson::TYPE_STRING:
+            ASSERT_EQ(expected.get_string_length(), actual.get_string_length());
+            EXPECT_EQ(expected.as_string(), actual.as_string());
+            break;
+        case sajson::TYPE_ARRAY:
+            ASSERT_EQ(expected.get_length(), actual.get_length());
+            for (size_t index = 0; index < expected.get_length(); index++) {
+                expectSameValue(expected.get_array_element(index), actual.get_array_element(index));
+            }
+            break;
+        case sajson::TYPE_OBJECT:
+            ASSERT_EQ(expected.get_length(), actual.get_length());
+            for (size_t index = 0; index < expected.get_length(); index++) {
+                EXPECT_EQ(expected.get_object_key(index).as_string(), actual.get_object_key(index).as_string());
+                expectSameValue(expected.get_object_value(index), actual.get_object_value(index));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void expectSameDocument(const sajson::document &expected, const sajson::document &actual) {
+    ASSERT_EQ(expected.is_valid(), actual.is_valid());
+    if (!expected.is_valid()) {
+        EXPECT_EQ(expected.get_error_line(), actual.get_error_line());
+        EXPECT_EQ(expected.get_error_column(), actual.get_error_column());
+        EXPECT_EQ(expected.get_error_message(), actual.get_error_message());
+        return;
+    }
+    expectSameValue(expected.get_root(), actual.get_root());
+}
+
+TEST(SajsonTests, in_situ_parse_matches_copying_parse) {
+    for (const char *json : sajsonTestCorpus) {
+        SCOPED_TRACE(json);
+        sajson::document copied = sajson::parse(sajson::string(json, strlen(json)));
+
+        vector<char> buffer(json, json + strlen(json));
+        sajson::document inSitu = sajson::parse(sajson::mutable_string_view(buffer.size(), buffer.data()));
+
+        expectSameDocument(copied, inSitu);
+    }
+}
+
+TEST(SajsonTests, structure_length_fits_dense_documents) {
+    // the documents needing the most structure slots per input byte
+    for (const char *element : {"0", "1.", "\"\"", "[]", "{}", "{\"\":0}", "{\"\":1.}", "{\"\":\"\"}", "[[]]"}) {
+        SCOPED_TRACE(element);
+        string json = "[";
+        for (int index = 0; index < 1000; index++) {
+            json.append(index == 0 ? "" : ",").append(element);
+        }
+        json.append("]");
+
+        sajson::document document = sajson::parse(sajson::string(json.data(), json.length()));
+        ASSERT_TRUE(document.is_valid()) << document.get_error_message();
+        sajson::value root = document.get_root();
+        ASSERT_EQ(1000u, root.get_length());
+        sajson::document expected = sajson::parse(sajson::literal((string("[") + element + "]").c_str()));
+        for (size_t index = 0; index < root.get_length(); index++) {
+            expectSameValue(expected.get_root().get_array_element(0), root.get_array_element(index));
+        }
+    }
+}
+
+TEST(SajsonTests, structure_length_is_proportional_to_element_count) {
+    const char *json = "{\"jrePath\": \"jre\", \"mainClass\": \"com.my.App\", "
+                       "\"classPath\": [\"lib/application.jar\", \"lib/dependency.jar\"], \"vmArgs\": [\"-Xmx1G\"]}";
+    size_t length = strlen(json);
+    // 3 containers and 4 commas
+    EXPECT_EQ(3u + 5u * (3u + 4u), sajson::get_structure_length(json, length));
+    EXPECT_LT(sajson::get_structure_length(json, length), length / 2);
+
+    // commas and brackets inside strings don't count
+    const char *strings = "[\"[,{,\\\",\", \"\\\\\"]";
+    EXPECT_EQ(1u + 5u * (1u + 1u), sajson::get_structure_length(strings, strlen(strings)));
+}
+
+/**
+ * The scan modes the CPU running the tests supports, besides SCAN_SCALAR.
+ */
+static vector<sajson::scan_mode> getVectorScanModes() {
+    vector<sajson::scan_mode> modes;
+    for (sajson::scan_mode mode : {sajson::SCAN_VECTOR, sajson::SCAN_AVX2}) {
+        if (mode <= sajson::get_supported_scan_mode()) {
+            modes.push_back(mode);
+        }
+    }
+    return modes;
+}
+
+TEST(SajsonTests, vector_scanning_matches_scalar_scanning) {
+    const char alphabet[] = {' ', '\t', '\n', '\r', '"', '\\', 'a', '/', '\x01', '\x1f', '\x7f', '\x80', '\xff', '\0'};
+    mt19937 random(33);
+    uniform_int_distribution<size_t> letter(0, sizeof(alphabet) - 1);
+    uniform_int_distribution<size_t> runLength(0, 70);
+
+    for (int iteration = 0; iteration < 2000; iteration++) {
+        // a run of whitespace or plain characters, followed by random characters
+        string text(runLength(random), iteration % 2 == 0 ? ' ' : 'a');
+        for (size_t index = 0; index < 40; index++) {
+            text.push_back(alphabet[letter(random)]);
+        }
+        const char *end = text.data() + text.size();
+        for (size_t offset = 0; offset < text.size(); offset++) {
+            const char *start = text.data() + offset;
+            size_t whitespaceLength = sajson::whitespace_length(sajson::SCAN_SCALAR, start, end);
+            size_t plainStringLength = sajson::plain_string_length(sajson::SCAN_SCALAR, start, end);
+            for (sajson::scan_mode mode : getVectorScanModes()) {
+                ASSERT_EQ(whitespaceLength, sajson::whitespace_length(mode, start, end)) << "mode " << mode << " offset " << offset;
+                ASSERT_EQ(plainStringLength, sajson::plain_string_length(mode, start, end)) << "mode " << mode << " offset " << offset;
+            }
+        }
+    }
+}
+
+TEST(SajsonTests, vector_parse_matches_scalar_parse) {
+    vector<string> documents(begin(sajsonTestCorpus), end(sajsonTestCorpus));
+
+    // a generated configuration with large, indented vmArgs and classPath arrays
+    string configuration = "{\n    \"vmArgs\": [";
+    for (int index = 0; index < 200; index++) {
+        configuration.append(index == 0 ? "\n" : ",\n").append(index % 8, ' ').append("        \"-Dproperty.number")
+                .append(to_string(index)).append(index % 3 == 0 ? "=C:\\\\Program Files\\\\app \\u00e4\"" : "=value\"");
+    }
+    configuration.append("\n    ],\n    \"classPath\": [");
+    for (int index = 0; index < 200; index++) {
+        configuration.append(index == 0 ? "" : ", ").append("\"lib/dependency-with-a-long-name-").append(to_string(index)).append(".jar\"");
+    }
+    configuration.append("]\n}\n");
+    ASSERT_TRUE(sajson::parse(sajson::string(configuration.data(), configuration.length())).is_valid());
+    documents.push_back(configuration);
+    documents.push_back(configuration.substr(0, configuration.size() / 2));
+    documents.push_back(configuration.substr(0, configuration.size() / 2) + "\x01\"]}");
+
+    for (const string &json : documents) {
+        SCOPED_TRACE(json.substr(0, 100));
+        sajson::document scalar = sajson::parse(sajson::string(json.data(), json.length()), sajson::SCAN_SCALAR);
+        for (sajson::scan_mode mode : getVectorScanModes()) {
+            sajson::document vector = sajson::parse(sajson::string(json.data(), json.length()), mode);
+            expectSameDocument(scalar, vector);
+        }
+    }
+}
+
+TEST(SajsonTests, in_situ_parse_over_copy_on_write_mapping) {
+    const char *fileName = "sajson_test_mapping.json";
+    for (const char *json : sajsonTestCorpus) {
+        SCOPED_TRACE(json);
+        size_t length = strlen(json);
+        if (length == 0) {
+            // empty files can't be mapped
+            continue;
+        }
+        {
+            ofstream out(fileName, ios::out | ios::binary | ios::trunc);
+            out.write(json, length);
+        }
+
+        MappedFile mapping = {};
+        ASSERT_TRUE(mapFile(DROPT_TEXT_LITERAL("sajson_test_mapping.json"), true, &mapping));
+        ASSERT_EQ(length, mapping.length);
+        {
+            sajson::document copied = sajson::parse(sajson::string(json, length));
+            sajson::document mapped = sajson::parse(sajson::mutable_string_view(mapping.length, mapping.data));
+            expectSameDocument(copied, mapped);
+        }
+        unmapFile(&mapping);
+
+        // parsing in place must not write through to the file
+        ifstream in(fileName, ios::in | ios::binary);
+        string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        EXPECT_EQ(string(json, length), content);
+    }
+    remove(fileName);
+}